@@ -152,43 +152,80 @@ FORMS   += beautydialog.ui \
 
 # --- 核心图像/视频处理逻辑 (Processors) ---
 SOURCES += beautyprocessor.cpp \
+           beautyrenderer.cpp \
            cannyprocessor.cpp \
            coloradjustprocessor.cpp \
+           faceanalyzer.cpp \
            gammaprocessor.cpp \
            grayscaleprocessor.cpp \
            imageblendprocessor.cpp \
            imagestitcherprocessor.cpp \
            imagetexturetransferprocessor.cpp \
            imageprocessor.cpp \
-           videoprocessor.cpp
+           videodecoder.cpp \
+           videoeffectstage.cpp \
+           videoexporter.cpp \
+           videoprocessor.cpp \
+           videorecorder.cpp
 HEADERS += beautyprocessor.h \
+           beautyrenderer.h \
            cannyprocessor.h \
            coloradjustprocessor.h \
+           faceanalyzer.h \
            gammaprocessor.h \
            grayscaleprocessor.h \
            imageblendprocessor.h \
            imagestitcherprocessor.h \
            imagetexturetransferprocessor.h \
            imageprocessor.h \
-           videoprocessor.h
+           videodecoder.h \
+           videoeffectstage.h \
+           videoexporter.h \
+           videoprocessor.h \
+           videorecorder.h
 
 # --- 自定义UI控件与模型 (Custom UI & Models) ---
 SOURCES += draggableitemmodel.cpp \
            droppablegraphicsview.cpp \
            histogramwidget.cpp \
-           interactivepixmapitem.cpp
+           interactivepixmapitem.cpp \
+           videoframeitem.cpp \
+           videotelemetrypanel.cpp
 HEADERS += draggableitemmodel.h \
            droppablegraphicsview.h \
            histogramwidget.h \
-           interactivepixmapitem.h
+           interactivepixmapitem.h \
+           videoframeitem.h \
+           videotelemetrypanel.h
 
 # --- 工具与管理器 (Utilities & Managers) ---
-SOURCES += imageconverter.cpp \
+SOURCES += audiopulldevice.cpp \
+           decodedgopcache.cpp \
+           decoderprefetcher.cpp \
+           framebufferpool.cpp \
+           imageconverter.cpp \
+           keyframeindex.cpp \
+           packetqueue.cpp \
+           pcmringbuffer.cpp \
+           presentationscheduler.cpp \
            processcommand.cpp \
-           stagingareamanager.cpp
-HEADERS += imageconverter.h \
+           stagingareamanager.cpp \
+           thumbnailtrack.cpp \
+           videotelemetry.cpp
+HEADERS += audiopulldevice.h \
+           decodedgopcache.h \
+           decoderprefetcher.h \
+           framebufferpool.h \
+           imageconverter.h \
+           keyframeindex.h \
+           packetqueue.h \
+           pcmringbuffer.h \
+           presentationscheduler.h \
            processcommand.h \
-           stagingareamanager.h
+           spscringbuffer.h \
+           stagingareamanager.h \
+           thumbnailtrack.h \
+           videotelemetry.h
 
 
 #------------------------------------------------------------------------------
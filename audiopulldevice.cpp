@@ -0,0 +1,76 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+// =============================================================================
+// File: audiopulldevice.cpp
+//
+// Description:
+// AudioPullDevice 类的实现文件。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include "audiopulldevice.h"
+#include "videodecoder.h"
+
+/**
+ * @brief AudioPullDevice 构造函数。
+ *
+ * 以无缓冲方式打开：QIODevice 自身不再缓存一份数据，读取直接落到调用者的缓冲区。
+ */
+AudioPullDevice::AudioPullDevice(QObject *parent)
+    : QIODevice(parent)
+{
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+}
+
+/**
+ * @brief 设置数据来源。
+ */
+void AudioPullDevice::setSource(VideoDecoder *decoder)
+{
+    source = decoder;
+}
+
+/**
+ * @brief 可读取的字节数（近似值）。
+ */
+qint64 AudioPullDevice::bytesAvailable() const
+{
+    return (source ? source->bufferedAudioBytes() : 0) + QIODevice::bytesAvailable();
+}
+
+/**
+ * @brief 从解码器的 PCM 环形缓冲区读取数据。
+ */
+qint64 AudioPullDevice::readData(char *data, qint64 maxSize)
+{
+    return source ? source->readAudio(data, maxSize) : 0;
+}
+
+/**
+ * @brief 只读设备，不支持写入。
+ */
+qint64 AudioPullDevice::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
+}
@@ -0,0 +1,74 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+#ifndef AUDIOPULLDEVICE_H
+#define AUDIOPULLDEVICE_H
+
+// =============================================================================
+// File: audiopulldevice.h
+//
+// Description:
+// 该文件定义了 AudioPullDevice 类，QAudioSink 以拉取模式从中读取解码好的 PCM 数据。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include <QIODevice>
+
+class VideoDecoder;
+
+/**
+ * @class AudioPullDevice
+ * @brief 供 QAudioSink 拉取音频的只读顺序设备。
+ *
+ * 以前由主线程在每次视频刷新时把音频块写入 AudioSink，音频只能按视频的节奏补充，
+ * 主线程一忙就会欠载。现在 AudioSink 按它自己的回调节奏调用 readData()，
+ * 数据直接从解码器的 PCM 环形缓冲区拷贝到 AudioSink 提供的缓冲区中，中间不分配内存。
+ *
+ * [线程约定]
+ * readData() 在 AudioSink 的工作线程（取决于后端，也可能是主线程）中调用；
+ * setSource() 只能在 AudioSink 停止时调用。
+ */
+class AudioPullDevice : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    explicit AudioPullDevice(QObject *parent = nullptr);
+
+    /**
+     * @brief 设置数据来源。只能在 AudioSink 停止时调用，传入nullptr表示没有来源。
+     */
+    void setSource(VideoDecoder *decoder);
+
+    bool isSequential() const override { return true; }
+    qint64 bytesAvailable() const override;
+
+protected:
+    // 从解码器的 PCM 环形缓冲区读取数据，暂时没有数据时返回0
+    qint64 readData(char *data, qint64 maxSize) override;
+    // 只读设备，不支持写入
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    VideoDecoder *source = nullptr;
+};
+
+#endif // AUDIOPULLDEVICE_H
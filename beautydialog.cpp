@@ -22,8 +22,8 @@
 //
 // Description:
 // BeautyDialog 类的实现文件。该文件包含了美颜设置对话框的所有逻辑，
-// 包括UI初始化、响应用户输入（如拖动滑块）以及调用 BeautyProcessor
-// 来执行实际的图像处理。
+// 包括UI初始化、响应用户输入（如拖动滑块）以及通过 BeautyRenderer
+// 在后台执行实际的图像处理。
 //
 // Author: g64
 // Date: 2025-07-25
@@ -31,14 +31,14 @@
 
 #include "beautydialog.h"
 #include "ui_beautydialog.h"
-#include "beautyprocessor.h"
+#include "beautyrenderer.h"
 
 #include <QPushButton>
 
 /**
  * @brief BeautyDialog 构造函数。
  *
- * 负责初始化UI，创建美颜处理器，设置滑块范围和默认值，
+ * 负责初始化UI，启动后台渲染线程（加载模型并检测人脸），设置滑块范围和默认值，
  * 并显示初始的“处理前”预览图像。
  * @param initialPixmap 需要进行美颜处理的原始图像。
  * @param parent 父窗口部件。
@@ -52,8 +52,19 @@ BeautyDialog::BeautyDialog(const QPixmap &initialPixmap, QWidget *parent) :
     ui->setupUi(this);
     setWindowTitle(tr("美颜工作室"));
 
-    // --- 2. 处理器和预览设置 ---
-    processor = new BeautyProcessor();
+    // --- 2. 渲染线程和预览设置 ---
+    // 渲染线程先检测人脸，在此之前提交的请求会在检测完成后处理。
+    // 不设父对象：对话框关闭时线程可能还在检测，由析构函数安排在线程结束后释放
+    renderer = new BeautyRenderer(originalPixmap.toImage());
+    connect(renderer, &BeautyRenderer::rendered, this, &BeautyDialog::onRendered);
+    connect(renderer, &BeautyRenderer::facesDetected, this, [this](int faceCount) {
+        if (faceCount > 0) return;
+        // 没有人脸时效果不会改变图像，保留提示，不再用预览覆盖它
+        noFaces = true;
+        ui->labelAfter->setText(tr("未检测到人脸"));
+    });
+    ui->labelAfter->setText(tr("正在检测人脸…"));
+    renderer->start();
     // 在 "Before" 标签中显示原始图像的缩略图
     ui->labelBefore->setPixmap(originalPixmap.scaled(ui->labelBefore->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
 
@@ -64,13 +75,17 @@ BeautyDialog::BeautyDialog(const QPixmap &initialPixmap, QWidget *parent) :
     // 设置瘦脸滑块的范围和初始值
     ui->sliderThin->setRange(0, 100);
     ui->sliderThin->setValue(0);
+    // 磨皮算法：顺序与 BeautyProcessor::SmoothingFilter 一致
+    ui->smoothFilterComboBox->addItems({tr("快速（导向滤波）"), tr("精细（双边滤波）")});
+    ui->smoothFilterComboBox->setCurrentIndex(BeautyProcessor::GuidedFilter);
+    connect(ui->smoothFilterComboBox, &QComboBox::currentIndexChanged, this, &BeautyDialog::applyBeautyFilter);
 
     // --- 4. 按钮连接 ---
-    // 将对话框按钮盒中的 "Apply" 按钮（如果存在）连接到 accept() 槽
-    // accept() 会关闭对话框并返回 QDialog::Accepted
+    // 将对话框按钮盒中的 "Apply" 按钮（如果存在）连接到 applyAndAccept()：
+    // 先在原图上生成最终结果，完成后再 accept() 关闭对话框
     QPushButton *applyButton = ui->buttonBox->button(QDialogButtonBox::Apply);
     if (applyButton) {
-        connect(applyButton, &QPushButton::clicked, this, &BeautyDialog::accept);
+        connect(applyButton, &QPushButton::clicked, this, &BeautyDialog::applyAndAccept);
     }
 
     // --- 5. 初始处理 ---
@@ -81,12 +96,15 @@ BeautyDialog::BeautyDialog(const QPixmap &initialPixmap, QWidget *parent) :
 /**
  * @brief BeautyDialog 析构函数。
  *
- * 清理UI对象和美颜处理器实例。
+ * 人脸检测和原图渲染可能需要数秒，这里不等待渲染线程：断开它的信号并请求停止，
+ * 线程结束后它会自行释放。
  */
 BeautyDialog::~BeautyDialog()
 {
+    disconnect(renderer, nullptr, this, nullptr);
+    connect(renderer, &QThread::finished, renderer, &QObject::deleteLater);
+    renderer->requestStop();
     delete ui;
-    delete processor;
 }
 
 /**
@@ -128,24 +146,64 @@ void BeautyDialog::on_sliderThin_valueChanged(int value)
 /**
  * @brief 应用当前滑块设置的美颜滤镜。
  *
- * 这是实现实时预览的核心函数。它从UI读取参数，调用处理器，
- * 并将结果显示在 "After" 标签中。
+ * 这是实现实时预览的核心函数。它从UI读取参数，向渲染线程提交一次预览请求；
+ * 拖动滑块时连续的请求会被合并，渲染线程总是处理最新的参数，结果在 onRendered() 中显示。
  */
 void BeautyDialog::applyBeautyFilter()
 {
+    // 已经在生成最终结果，不再更新预览
+    if (finalSerial != 0) return;
+
     // 1. 从UI获取当前的参数值
-    int smoothLevel = ui->sliderSmooth->value();
-    int thinLevel = ui->sliderThin->value();
-
-    // 2. 调用处理器执行美颜算法
-    // 注意：每次都从 originalPixmap 开始处理，以避免效果叠加
-    QImage result = processor->process(originalPixmap.toImage(), smoothLevel, thinLevel);
-
-    // 3. 更新结果图像和UI预览
-    if (!result.isNull()) {
-        resultPixmap = QPixmap::fromImage(result);
-        // 在 "After" 标签中显示处理后的图像缩略图
-        // Qt::SmoothTransformation 提供了更高质量的缩放效果
-        ui->labelAfter->setPixmap(resultPixmap.scaled(ui->labelAfter->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
+    BeautyRenderer::Request request;
+    request.smoothLevel = ui->sliderSmooth->value();
+    request.thinLevel = ui->sliderThin->value();
+    request.filter = static_cast<BeautyProcessor::SmoothingFilter>(ui->smoothFilterComboBox->currentIndex());
+    request.preview = true;
+
+    // 2. 提交给渲染线程（总是从原图开始处理，以避免效果叠加）
+    renderer->requestRender(request);
+}
+
+/**
+ * @brief 槽函数：响应“应用”按钮。
+ *
+ * 预览是在缩小的图像上生成的，这里以当前参数在原图上重新渲染一次，完成后关闭对话框。
+ */
+void BeautyDialog::applyAndAccept()
+{
+    if (finalSerial != 0) return;
+    BeautyRenderer::Request request;
+    request.smoothLevel = ui->sliderSmooth->value();
+    request.thinLevel = ui->sliderThin->value();
+    request.filter = static_cast<BeautyProcessor::SmoothingFilter>(ui->smoothFilterComboBox->currentIndex());
+    request.preview = false;
+    finalSerial = renderer->requestRender(request);
+
+    // 生成最终结果期间禁止再次操作
+    ui->buttonBox->setEnabled(false);
+    ui->sliderSmooth->setEnabled(false);
+    ui->sliderThin->setEnabled(false);
+    ui->smoothFilterComboBox->setEnabled(false);
+}
+
+/**
+ * @brief 槽函数：后台渲染完成。
+ *
+ * 预览结果显示在 "After" 标签中；最终结果保存后关闭对话框。
+ */
+void BeautyDialog::onRendered(const QImage &image, bool preview, quint64 serial)
+{
+    if (!preview) {
+        if (serial != finalSerial) return;
+        if (!image.isNull()) resultPixmap = QPixmap::fromImage(image);
+        accept();
+        return;
     }
+    // 已经在生成最终结果时忽略迟到的预览；没有人脸时保留提示文字
+    if (finalSerial != 0 || noFaces || image.isNull()) return;
+    // 在 "After" 标签中显示处理后的图像缩略图
+    // Qt::SmoothTransformation 提供了更高质量的缩放效果
+    const QPixmap previewPixmap = QPixmap::fromImage(image);
+    ui->labelAfter->setPixmap(previewPixmap.scaled(ui->labelAfter->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
 }
@@ -38,7 +38,7 @@
 namespace Ui {
 class BeautyDialog;
 }
-class BeautyProcessor; // 美颜算法的核心处理类
+class BeautyRenderer; // 在后台检测人脸并应用美颜效果
 
 /**
  * @class BeautyDialog
@@ -46,6 +46,9 @@ class BeautyProcessor; // 美颜算法的核心处理类
  *
  * 该对话框允许用户通过UI控件（滑块）来调整美颜滤镜的参数，
  * 如磨皮程度和瘦脸强度，并实时显示处理后的图像。
+ *
+ * 人脸检测只在打开对话框时进行一次，调整参数时只重新应用滤镜；处理在 BeautyRenderer 的
+ * 后台线程中进行，预览使用缩小的图像，点击“应用”时才在原图上生成最终结果。
  */
 class BeautyDialog : public QDialog
 {
@@ -83,20 +86,32 @@ private slots:
      */
     void on_sliderThin_valueChanged(int value);
 
+    /**
+     * @brief 槽函数：响应“应用”按钮，在原图上生成最终结果后关闭对话框。
+     */
+    void applyAndAccept();
+
+    /**
+     * @brief 槽函数：后台渲染完成。
+     */
+    void onRendered(const QImage &image, bool preview, quint64 serial);
+
 private:
     /**
      * @brief 应用当前滑块设置的美颜滤镜。
      *
-     * 该函数会获取所有滑块的当前值，并调用 BeautyProcessor 来处理图像，
-     * 然后更新UI以显示结果。
+     * 该函数会获取所有控件的当前值，向后台渲染线程提交一次预览请求，
+     * 结果就绪后更新预览。
      */
     void applyBeautyFilter();
 
     // --- 成员变量 ---
     Ui::BeautyDialog *ui;          // Qt Designer生成的UI类实例
-    BeautyProcessor *processor;    // 负责执行美颜算法的处理对象
+    BeautyRenderer *renderer;      // 在后台执行美颜算法的渲染线程
     QPixmap originalPixmap;        // 存储传入的原始图像，用于每次重新计算效果
     QPixmap resultPixmap;          // 存储当前处理后的结果图像
+    quint64 finalSerial = 0;       // 原图渲染请求的序号，0 表示尚未请求
+    bool noFaces = false;          // 渲染线程报告没有检测到人脸
 };
 
 #endif // BEAUTYDIALOG_H
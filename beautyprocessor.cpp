@@ -35,8 +35,13 @@
 #include <QDebug>
 #include <QFile>
 #include <QDir>
+#include <algorithm>
+#include <cmath>
 #include <vector>
 
+// 缓存的瘦脸位移场个数（每张脸一个）
+static const size_t maxCachedThinningFields = 8;
+
 /**
  * @brief 从Qt资源文件中提取数据并保存到临时文件中。
  *
@@ -97,43 +102,47 @@ BeautyProcessor::BeautyProcessor()
 }
 
 /**
- * @brief 对源图像执行美颜处理。
+ * @brief 把 QImage 转换为美颜处理使用的3通道BGR图像。
+ */
+cv::Mat BeautyProcessor::toBgr(const QImage &image)
+{
+    if (image.isNull()) return cv::Mat();
+    cv::Mat mat = ImageConverter::qImageToMat(image);
+    // 确保图像是3通道BGR格式，dlib需要这种格式
+    if (mat.channels() == 4) {
+        cv::cvtColor(mat, mat, cv::COLOR_BGRA2BGR);
+    }
+    return mat;
+}
+
+/**
+ * @brief 检测图像中的人脸并定位每张脸的68个关键点。
  *
- * 这是该类的主要公共接口。它按顺序执行人脸检测、关键点定位、
- * 瘦脸和磨皮操作。
- * @param sourceImage 待处理的原始 QImage 图像。
- * @param smoothLevel 磨皮等级 (0-100)。
- * @param thinLevel 瘦脸等级 (0-100)。
- * @return 返回处理后的 QImage 图像。如果未检测到人脸或初始化失败，则返回原始图像。
+ * 这是美颜处理中最耗时的一步，而结果只取决于图像本身：调整参数时应缓存结果，
+ * 不必重新检测。
+ * @param image 3通道BGR图像。
+ * @return 每张脸的关键点（图像坐标）；模型未加载或未检测到人脸时为空。
  */
-QImage BeautyProcessor::process(const QImage &sourceImage, int smoothLevel, int thinLevel)
+std::vector<dlib::full_object_detection> BeautyProcessor::detectLandmarks(const cv::Mat &image)
 {
     // --- 1. 有效性检查 ---
-    if (sourceImage.isNull() || landmark_predictor.num_parts() == 0) {
+    if (image.empty() || landmark_predictor.num_parts() == 0) {
         qWarning() << "Beauty processor not initialized or models failed to load, skipping.";
-        return sourceImage;
+        return {};
     }
 
-    // --- 2. 格式转换 ---
-    cv::Mat originalMat = ImageConverter::qImageToMat(sourceImage);
-    if (originalMat.empty()) return sourceImage;
-    // 确保图像是3通道BGR格式，dlib需要这种格式
-    if (originalMat.channels() == 4) {
-        cv::cvtColor(originalMat, originalMat, cv::COLOR_BGRA2BGR);
-    }
-
-    // --- 3. 图像预处理与人脸检测 ---
+    // --- 2. 图像预处理与人脸检测 ---
     // 将cv::Mat封装为dlib可以处理的图像类型
-    dlib::cv_image<dlib::bgr_pixel> dlib_img(originalMat);
+    dlib::cv_image<dlib::bgr_pixel> dlib_img(image);
     dlib::cv_image<dlib::bgr_pixel> detection_img = dlib_img;
 
     // 对于尺寸过小的图片，先放大再进行检测可以提高准确率
     float scale = 1.0f;
     const int min_size_for_detection = 250;
-    if (originalMat.cols < min_size_for_detection || originalMat.rows < min_size_for_detection) {
-        scale = std::max(2.0f, min_size_for_detection / static_cast<float>(std::min(originalMat.cols, originalMat.rows)));
-        cv::Mat upscaled_mat;
-        cv::resize(originalMat, upscaled_mat, cv::Size(), scale, scale, cv::INTER_CUBIC);
+    cv::Mat upscaled_mat;
+    if (image.cols < min_size_for_detection || image.rows < min_size_for_detection) {
+        scale = std::max(2.0f, min_size_for_detection / static_cast<float>(std::min(image.cols, image.rows)));
+        cv::resize(image, upscaled_mat, cv::Size(), scale, scale, cv::INTER_CUBIC);
         detection_img = dlib::cv_image<dlib::bgr_pixel>(upscaled_mat);
         qDebug() << "Image is small, upscaling by" << scale << "for detection.";
     }
@@ -141,13 +150,8 @@ QImage BeautyProcessor::process(const QImage &sourceImage, int smoothLevel, int
     std::vector<dlib::rectangle> faces = face_detector(detection_img);
     qDebug() << "Detected" << faces.size() << "face(s).";
 
-    if (faces.empty()) {
-        return sourceImage; // 未检测到人脸，返回原图
-    }
-
-    cv::Mat processedMat = originalMat.clone();
-
-    // --- 4. 迭代处理每个检测到的人脸 ---
+    // --- 3. 在原始尺寸的图像上定位每张脸的关键点 ---
+    std::vector<dlib::full_object_detection> result;
     for (const auto& face_upscaled : faces) {
         // 如果图像被放大了，需要将检测到的脸部矩形缩放回原始尺寸
         dlib::rectangle face;
@@ -161,85 +165,266 @@ QImage BeautyProcessor::process(const QImage &sourceImage, int smoothLevel, int
         } else {
             face = face_upscaled;
         }
+        result.push_back(landmark_predictor(dlib_img, face));
+    }
+    return result;
+}
 
-        // 在原始尺寸的图像上定位面部关键点
-        dlib::full_object_detection landmarks = landmark_predictor(dlib_img, face);
+/**
+ * @brief 把关键点缩放到另一尺寸的图像上（例如缩小的预览图）。
+ */
+std::vector<dlib::full_object_detection> BeautyProcessor::scaleLandmarks(const std::vector<dlib::full_object_detection> &faces, double scale)
+{
+    std::vector<dlib::full_object_detection> scaled;
+    scaled.reserve(faces.size());
+    for (const auto &face : faces) {
+        const dlib::rectangle &rect = face.get_rect();
+        std::vector<dlib::point> parts;
+        parts.reserve(face.num_parts());
+        for (unsigned long i = 0; i < face.num_parts(); ++i) {
+            parts.emplace_back(std::lround(face.part(i).x() * scale), std::lround(face.part(i).y() * scale));
+        }
+        scaled.emplace_back(dlib::rectangle(std::lround(rect.left() * scale), std::lround(rect.top() * scale),
+                                            std::lround(rect.right() * scale), std::lround(rect.bottom() * scale)),
+                            parts);
+    }
+    return scaled;
+}
 
-        // --- 5. 应用美颜效果 ---
-        // 先应用瘦脸（结构变形），再应用磨皮（纹理处理）
+/**
+ * @brief 按已检测到的关键点应用美颜效果。
+ *
+ * 先应用瘦脸（结构变形），再应用磨皮（纹理处理）。
+ * @param image [in, out] 3通道BGR图像，效果直接应用在此图像上。
+ * @param faces detectLandmarks() 的结果（与 image 同一坐标系）。
+ * @param smoothLevel 磨皮等级 (0-100)。
+ * @param thinLevel 瘦脸等级 (0-100)。
+ * @param filter 磨皮使用的保边滤波器。
+ */
+void BeautyProcessor::applyEffects(cv::Mat &image, const std::vector<dlib::full_object_detection> &faces,
+                                   int smoothLevel, int thinLevel, SmoothingFilter filter)
+{
+    // 迭代处理每个检测到的人脸
+    for (const auto& landmarks : faces) {
         if (thinLevel > 0) {
             qDebug() << "--- Applying face thinning with level:" << thinLevel;
-            applyFaceThinning(processedMat, landmarks, thinLevel);
+            applyFaceThinning(image, landmarks, thinLevel);
         }
         if (smoothLevel > 0) {
             qDebug() << "--- Applying skin smoothing with level:" << smoothLevel;
-            applySkinSmoothing(processedMat, landmarks, smoothLevel);
+            applySkinSmoothing(image, landmarks, smoothLevel, filter);
         }
     }
+}
 
-    // --- 6. 返回结果 ---
-    return ImageConverter::matToQImage(processedMat);
+/**
+ * @brief 自引导的导向滤波 (He et al.)，逐通道进行。
+ *
+ * 只由若干次盒式滤波组成，每个像素的代价与半径无关；方差小的平坦区域被平滑，
+ * 方差远大于 eps 的边缘保持不变。
+ * @param src 输入图像 (CV_8UC3)。
+ * @param dst 输出图像，类型与 src 相同。
+ * @param radius 窗口半径。
+ * @param eps 正则化参数（按 [0, 1] 归一化的灰度计）。
+ */
+static void guidedSmooth(const cv::Mat &src, cv::Mat &dst, int radius, double eps)
+{
+    const cv::Size window(2 * radius + 1, 2 * radius + 1);
+    cv::Mat guide, mean_i, mean_ii, a, b;
+    src.convertTo(guide, CV_32F, 1.0 / 255.0);
+    cv::boxFilter(guide, mean_i, CV_32F, window);
+    cv::boxFilter(guide.mul(guide), mean_ii, CV_32F, window);
+    cv::Mat variance = mean_ii - mean_i.mul(mean_i);
+    cv::divide(variance, variance + eps, a);
+    b = mean_i - a.mul(mean_i);
+    cv::boxFilter(a, a, CV_32F, window);
+    cv::boxFilter(b, b, CV_32F, window);
+    cv::Mat smoothed = a.mul(guide) + b;
+    smoothed.convertTo(dst, src.type(), 255.0);
 }
 
 /**
  * @brief 应用皮肤平滑（磨皮）效果。
  *
- * 使用高低频分离和双边滤波技术，在平滑皮肤的同时保留边缘细节。
+ * 使用高低频分离和保边滤波（导向滤波或双边滤波），在平滑皮肤的同时保留边缘细节。
+ * 所有滤波只在这张脸的外接矩形（加上各级滤波的半径）内进行，多张脸时不会把整幅图像滤波多次。
  * @param image [in, out] 要处理的 cv::Mat 图像，效果将直接应用在此图像上。
  * @param landmarks 检测到的68个面部关键点。
  * @param level 磨皮强度 (0-100)。
+ * @param filter 保边滤波器。
  */
-void BeautyProcessor::applySkinSmoothing(cv::Mat &image, const dlib::full_object_detection& landmarks, int level)
+void BeautyProcessor::applySkinSmoothing(cv::Mat &image, const dlib::full_object_detection& landmarks, int level, SmoothingFilter filter)
 {
     if (level <= 0 || landmarks.num_parts() != 68) return;
 
-    // 1. 创建皮肤区域的掩码(mask)
+    // 1. 确定处理范围
     // a. 使用面部外轮廓(0-16)和下巴(17-26)关键点创建一个凸包，作为初始皮肤区域
     std::vector<cv::Point> face_hull;
     for (unsigned long i = 0; i <= 16; ++i) face_hull.push_back(cv::Point(landmarks.part(i).x(), landmarks.part(i).y()));
     for (unsigned long i = 26; i >= 17; --i) face_hull.push_back(cv::Point(landmarks.part(i).x(), landmarks.part(i).y()));
 
-    cv::Mat skin_mask = cv::Mat::zeros(image.size(), CV_8UC1);
+    // b. 掩码的范围：凸包外接矩形加上掩码羽化的半径
+    const int mask_blur = 15;
+    const cv::Rect bounds(0, 0, image.cols, image.rows);
+    const int mask_pad = mask_blur / 2 + 1;
+    cv::Rect face_rect = cv::boundingRect(face_hull);
+    face_rect = cv::Rect(face_rect.x - mask_pad, face_rect.y - mask_pad, face_rect.width + 2 * mask_pad, face_rect.height + 2 * mask_pad) & bounds;
+    if (face_rect.empty()) return;
+
+    // c. 滤波的范围：再加上高斯模糊和保边滤波的作用范围（导向滤波两次盒式滤波，共 d），
+    //    掩码范围内的结果与整幅图像滤波时相同
+    int kernel_size = (level / 10) * 2 + 1; // 磨皮等级越高，模糊半径越大
+    int d = level / 10 + 5;                 // 保边滤波的邻域直径
+    const int filter_pad = kernel_size / 2 + d + 1;
+    const cv::Rect work_rect = cv::Rect(face_rect.x - filter_pad, face_rect.y - filter_pad,
+                                        face_rect.width + 2 * filter_pad, face_rect.height + 2 * filter_pad) & bounds;
+    const cv::Point origin = work_rect.tl();
+
+    // 2. 创建皮肤区域的掩码(mask)（work_rect 坐标）
+    for (cv::Point &pt : face_hull) pt -= origin;
+    cv::Mat skin_mask = cv::Mat::zeros(work_rect.size(), CV_8UC1);
     cv::fillConvexPoly(skin_mask, face_hull, 255);
 
-    // b. 从掩码中排除眼睛、眉毛和嘴巴区域，因为这些区域不需要磨皮
+    // a. 从掩码中排除眼睛、眉毛和嘴巴区域，因为这些区域不需要磨皮
     std::vector<cv::Point> left_eye, right_eye, mouth;
-    for (unsigned long i = 36; i <= 41; ++i) left_eye.push_back(cv::Point(landmarks.part(i).x(), landmarks.part(i).y()));
-    for (unsigned long i = 42; i <= 47; ++i) right_eye.push_back(cv::Point(landmarks.part(i).x(), landmarks.part(i).y()));
-    for (unsigned long i = 48; i <= 59; ++i) mouth.push_back(cv::Point(landmarks.part(i).x(), landmarks.part(i).y()));
+    for (unsigned long i = 36; i <= 41; ++i) left_eye.push_back(cv::Point(landmarks.part(i).x(), landmarks.part(i).y()) - origin);
+    for (unsigned long i = 42; i <= 47; ++i) right_eye.push_back(cv::Point(landmarks.part(i).x(), landmarks.part(i).y()) - origin);
+    for (unsigned long i = 48; i <= 59; ++i) mouth.push_back(cv::Point(landmarks.part(i).x(), landmarks.part(i).y()) - origin);
     cv::fillConvexPoly(skin_mask, left_eye, 0);
     cv::fillConvexPoly(skin_mask, right_eye, 0);
     cv::fillConvexPoly(skin_mask, mouth, 0);
 
-    // c. 轻微模糊掩码边缘，使最终效果过渡更自然
-    cv::GaussianBlur(skin_mask, skin_mask, cv::Size(15, 15), 0, 0);
+    // b. 轻微模糊掩码边缘，使最终效果过渡更自然
+    cv::GaussianBlur(skin_mask, skin_mask, cv::Size(mask_blur, mask_blur), 0, 0);
 
-    // 2. 应用高级表面模糊算法
+    // 3. 应用高级表面模糊算法
     qDebug() << "Applying advanced surface blur with level:" << level;
+    cv::Mat work = image(work_rect);
     // a. 高斯模糊得到低频分量（模糊的背景）
-    int kernel_size = (level / 10) * 2 + 1; // 磨皮等级越高，模糊半径越大
     cv::Mat low_freq;
-    cv::GaussianBlur(image, low_freq, cv::Size(kernel_size, kernel_size), 0, 0);
+    cv::GaussianBlur(work, low_freq, cv::Size(kernel_size, kernel_size), 0, 0);
 
     // b. 原图减去低频得到高频分量（细节、纹理）
-    cv::Mat high_freq = image - low_freq;
+    cv::Mat high_freq = work - low_freq;
 
-    // c. 对低频分量使用双边滤波，这是一种保边滤波器，可以在平滑颜色的同时保留边缘
+    // c. 对低频分量使用保边滤波，可以在平滑颜色的同时保留边缘
     cv::Mat enhanced_low_freq;
-    int d = level / 10 + 5; // 双边滤波的邻域直径
-    cv::bilateralFilter(low_freq, enhanced_low_freq, d, 150, 150);
+    if (filter == BilateralFilter) {
+        cv::bilateralFilter(low_freq, enhanced_low_freq, d, 150, 150);
+    } else {
+        guidedSmooth(low_freq, enhanced_low_freq, d / 2, 0.02);
+    }
 
     // d. 将处理过的低频和原始高频重新组合
     cv::Mat result = enhanced_low_freq + high_freq;
 
-    // 3. 使用掩码将处理结果合成回原图
-    result.copyTo(image, skin_mask);
+    // 4. 使用掩码将处理结果合成回原图，只写回掩码的范围
+    const cv::Rect local_face(face_rect.tl() - origin, face_rect.size());
+    result(local_face).copyTo(work(local_face), skin_mask(local_face));
+}
+
+/**
+ * @brief 取得一张脸的瘦脸位移场（强度为1）。
+ *
+ * 像素按在鼻梁的左侧还是右侧选择对应的下颌点，只有到该点的距离小于半径（鼻梁到下巴的距离）的像素
+ * 才会移动：位移方向为垂直于鼻梁—下巴中轴线向外，大小按 (1 - 距离/半径)² 衰减。
+ * 因此只需在两个下颌点各自的影响圆的外接矩形内计算，按行并行，每行的左右两段各是一个
+ * 没有分支的单精度循环，便于编译器向量化。
+ * @param imageSize 图像尺寸。
+ * @param landmarks 检测到的68个面部关键点。
+ */
+const BeautyProcessor::ThinningField &BeautyProcessor::thinningField(const cv::Size &imageSize, const dlib::full_object_detection& landmarks)
+{
+    const std::vector<cv::Point> anchors = {
+        cv::Point(landmarks.part(3).x(), landmarks.part(3).y()),   // 左下颌
+        cv::Point(landmarks.part(13).x(), landmarks.part(13).y()), // 右下颌
+        cv::Point(landmarks.part(8).x(), landmarks.part(8).y()),   // 下巴
+        cv::Point(landmarks.part(27).x(), landmarks.part(27).y())  // 鼻梁
+    };
+    for (auto it = thinningCache.begin(); it != thinningCache.end(); ++it) {
+        if (it->imageSize == imageSize && it->anchors == anchors) {
+            if (it != thinningCache.begin()) {
+                ThinningField hit = std::move(*it);
+                thinningCache.erase(it);
+                thinningCache.push_front(std::move(hit));
+            }
+            return thinningCache.front();
+        }
+    }
+
+    ThinningField field;
+    field.imageSize = imageSize;
+    field.anchors = anchors;
+
+    // 1. 中轴线（鼻梁→下巴）和影响半径（鼻梁到下巴的距离）
+    const cv::Point2f left_jaw(anchors[0]), right_jaw(anchors[1]), chin(anchors[2]), nose(anchors[3]);
+    const cv::Point2f axis = chin - nose;
+    const float axis_len2 = axis.dot(axis);
+    const float radius = std::sqrt(axis_len2);
+
+    // 2. 受影响的区域：两个下颌点影响圆的外接矩形
+    auto disc = [&](const cv::Point2f &c) {
+        return cv::Rect(cv::Point(cvFloor(c.x - radius), cvFloor(c.y - radius)), cv::Point(cvCeil(c.x + radius) + 1, cvCeil(c.y + radius) + 1));
+    };
+    field.roi = (disc(left_jaw) | disc(right_jaw)) & cv::Rect(cv::Point(0, 0), imageSize);
+    if (field.roi.empty() || axis_len2 <= 0.0f) {
+        field.roi = cv::Rect();
+    } else {
+        field.shiftX.create(field.roi.size(), CV_32FC1);
+        field.shiftY.create(field.roi.size(), CV_32FC1);
+        // 鼻梁左侧的像素使用左下颌点，右侧的使用右下颌点
+        const int split = std::clamp(cvCeil(nose.x) - field.roi.x, 0, field.roi.width);
+        const float inv_axis_len2 = 1.0f / axis_len2;
+        const float inv_radius = 1.0f / radius;
+        const cv::Rect roi = field.roi;
+        cv::Mat &shift_x = field.shiftX;
+        cv::Mat &shift_y = field.shiftY;
+
+        // 3. 按行并行计算位移
+        auto fillSpan = [&](float *sx, float *sy, int y, int begin, int end, const cv::Point2f &jaw) {
+            const float fy = static_cast<float>(roi.y + y);
+            const float jy = fy - jaw.y;
+            const float ny = fy - nose.y;
+            for (int i = begin; i < end; ++i) {
+                const float fx = static_cast<float>(roi.x + i);
+                const float jx = fx - jaw.x;
+                const float dist = std::sqrt(jx * jx + jy * jy);
+                // 当前点到中轴线的垂直分量 (dx, dy)
+                const float nx = fx - nose.x;
+                const float proj = (nx * axis.x + ny * axis.y) * inv_axis_len2;
+                const float dx = nx - proj * axis.x;
+                const float dy = ny - proj * axis.y;
+                // 离下颌点越远效果越弱，半径之外为0
+                const float falloff = std::max(0.0f, 1.0f - dist * inv_radius);
+                sx[i] = dx * falloff * falloff;
+                sy[i] = dy * falloff * falloff;
+            }
+        };
+        cv::parallel_for_(cv::Range(0, roi.height), [&](const cv::Range &rows) {
+            for (int y = rows.start; y < rows.end; ++y) {
+                float *sx = shift_x.ptr<float>(y);
+                float *sy = shift_y.ptr<float>(y);
+                fillSpan(sx, sy, y, 0, split, left_jaw);
+                fillSpan(sx, sy, y, split, roi.width, right_jaw);
+            }
+        });
+
+        double min_x, max_x, min_y, max_y;
+        cv::minMaxLoc(shift_x, &min_x, &max_x);
+        cv::minMaxLoc(shift_y, &min_y, &max_y);
+        field.maxShift = static_cast<float>(std::max({-min_x, max_x, -min_y, max_y}));
+    }
+
+    thinningCache.push_front(std::move(field));
+    if (thinningCache.size() > maxCachedThinningFields) thinningCache.pop_back();
+    return thinningCache.front();
 }
 
 /**
  * @brief 应用瘦脸效果。
  *
- * 通过计算像素位移并使用cv::remap实现液化效果。
+ * 通过位移场和 cv::remap 实现液化效果。位移场按关键点缓存，这里只按强度缩放，
+ * 并且只在受影响的区域内重映射，其余像素保持不变。
  * @param image [in, out] 要处理的 cv::Mat 图像，效果将直接应用在此图像上。
  * @param landmarks 检测到的68个面部关键点。
  * @param level 瘦脸强度 (0-100)。
@@ -248,69 +433,39 @@ void BeautyProcessor::applyFaceThinning(cv::Mat &image, const dlib::full_object_
 {
     if (level <= 0 || landmarks.num_parts() != 68) return;
 
-    cv::Mat tempImage = image.clone();
-    cv::Mat map_x = cv::Mat(image.size(), CV_32FC1);
-    cv::Mat map_y = cv::Mat(image.size(), CV_32FC1);
-
-    // 1. 定义关键点和参数
-    dlib::point p_left_jaw = landmarks.part(3);
-    dlib::point p_right_jaw = landmarks.part(13);
-    dlib::point p_chin = landmarks.part(8);
-    dlib::point p_nose_bridge = landmarks.part(27);
-
-    // 2. 定义脸部中轴线和变形参数
-    // 将dlib点转换为OpenCV浮点数点，以进行精确的向量计算
-    cv::Point2f chin_pt(p_chin.x(), p_chin.y());
-    cv::Point2f nose_pt(p_nose_bridge.x(), p_nose_bridge.y());
-
-    // 计算从鼻子到下巴的中轴线向量
-    cv::Point2f central_axis_vec = chin_pt - nose_pt;
-
-    // 定义变形效果的影响半径，大致为鼻子到下巴的距离
-    double radius = dlib::length(p_chin - landmarks.part(27));
-
-    // 将UI的level (0-100) 映射到一个合适的变形强度
-    double strength = level / 100.0 * 0.15;
-
-    // 3. 生成重映射查找表 (remap maps)
-    for (int y = 0; y < tempImage.rows; y++) {
-        for (int x = 0; x < tempImage.cols; x++) {
-            // 默认情况下，像素不移动
-            map_x.at<float>(y, x) = static_cast<float>(x);
-            map_y.at<float>(y, x) = static_cast<float>(y);
-
-            // 判断当前像素在左脸还是右脸，并获取对应的脸颊关键点
-            dlib::point jaw_pt = (x < nose_pt.x) ? p_left_jaw : p_right_jaw;
-
-            double dist_to_jaw = dlib::length(dlib::point(x, y) - jaw_pt);
-
-            // 只处理脸颊附近半径内的点
-            if (dist_to_jaw < radius) {
-                cv::Point2f current_pt_f(x, y);
-
-                // 计算从鼻子到当前点的向量
-                cv::Point2f vec_to_pt = current_pt_f - nose_pt;
-
-                // 将 vec_to_pt 投影到中轴线 central_axis_vec 上
-                float proj = vec_to_pt.dot(central_axis_vec) / (central_axis_vec.x*central_axis_vec.x + central_axis_vec.y*central_axis_vec.y);
-
-                // 找到中轴线上与当前点最近的点
-                cv::Point2f pt_on_axis = nose_pt + proj * central_axis_vec;
-
-                // 计算从投影点到当前点的向量 (dx, dy)，这个向量大致垂直于中轴线
-                float dx = x - pt_on_axis.x;
-                float dy = y - pt_on_axis.y;
-
-                // 计算位移缩放因子。离脸颊越远，效果越弱
-                float scale = strength * std::pow(1.0 - dist_to_jaw / radius, 2);
-
-                // 根据原始算法，计算新的像素坐标
-                map_x.at<float>(y, x) = static_cast<float>(x + dx * scale);
-                map_y.at<float>(y, x) = static_cast<float>(y + dy * scale);
+    const ThinningField &field = thinningField(image.size(), landmarks);
+    if (field.roi.empty()) return;
+
+    // 1. 将UI的level (0-100) 映射到一个合适的变形强度
+    const float strength = level / 100.0f * 0.15f;
+
+    // 2. 采样范围：ROI 向外扩展最大位移（加上双线性插值的一个像素），
+    //    只复制这一块作为 remap 的源图，坐标超出图像时仍按边界复制处理
+    const int margin = cvCeil(field.maxShift * strength) + 2;
+    const cv::Rect roi = field.roi;
+    const cv::Rect window = cv::Rect(roi.x - margin, roi.y - margin, roi.width + 2 * margin, roi.height + 2 * margin)
+                            & cv::Rect(0, 0, image.cols, image.rows);
+    cv::Mat source = image(window).clone();
+
+    // 3. 按强度缩放位移，得到相对于源图的重映射查找表
+    cv::Mat map_x(roi.size(), CV_32FC1), map_y(roi.size(), CV_32FC1);
+    const float offset_x = static_cast<float>(roi.x - window.x);
+    const float offset_y = static_cast<float>(roi.y - window.y);
+    cv::parallel_for_(cv::Range(0, roi.height), [&](const cv::Range &rows) {
+        for (int y = rows.start; y < rows.end; ++y) {
+            const float *sx = field.shiftX.ptr<float>(y);
+            const float *sy = field.shiftY.ptr<float>(y);
+            float *mx = map_x.ptr<float>(y);
+            float *my = map_y.ptr<float>(y);
+            const float fy = offset_y + static_cast<float>(y);
+            for (int x = 0; x < roi.width; ++x) {
+                mx[x] = offset_x + static_cast<float>(x) + strength * sx[x];
+                my[x] = fy + strength * sy[x];
             }
         }
-    }
+    });
 
-    // 4. 应用重映射
-    cv::remap(tempImage, image, map_x, map_y, cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+    // 4. 只对受影响的区域应用重映射
+    cv::Mat target = image(roi);
+    cv::remap(source, target, map_x, map_y, cv::INTER_LINEAR, cv::BORDER_REPLICATE);
 }
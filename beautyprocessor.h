@@ -34,6 +34,7 @@
 
 #include <QImage>
 #include <QTemporaryFile>
+#include <deque>
 #include <memory>
 
 // --- 第三方库包含 ---
@@ -47,8 +48,8 @@
  * @class BeautyProcessor
  * @brief 封装了美颜处理算法的核心逻辑。
  *
- * 该类初始化所需的人脸检测和特征点预测模型，并提供一个统一的
- * process 接口，用于对输入的图像应用磨皮和瘦脸效果。
+ * 该类初始化所需的人脸检测和特征点预测模型。detectLandmarks() 检测人脸并定位关键点，
+ * applyEffects() 按关键点对图像应用磨皮和瘦脸效果；调整参数时只需重复后者。
  */
 class BeautyProcessor
 {
@@ -62,13 +63,36 @@ public:
     BeautyProcessor();
 
     /**
-     * @brief 对源图像执行美颜处理。
-     * @param sourceImage 待处理的原始 QImage 图像。
+     * @enum SmoothingFilter
+     * @brief 磨皮使用的保边滤波器。
+     */
+    enum SmoothingFilter {
+        GuidedFilter,   // 导向滤波：每个像素的代价与半径无关，适合拖动滑块时实时预览大图
+        BilateralFilter // 双边滤波：原来的算法，半径越大越慢
+    };
+
+    /**
+     * @brief 检测人脸并定位每张脸的68个关键点（最耗时的一步，结果只取决于图像）。
+     * @param image 3通道BGR图像。
+     * @return 每张脸的关键点；模型未加载或未检测到人脸时为空。
+     */
+    std::vector<dlib::full_object_detection> detectLandmarks(const cv::Mat &image);
+
+    /**
+     * @brief 按已检测到的关键点应用瘦脸和磨皮。
+     * @param image [in, out] 3通道BGR图像。
+     * @param faces detectLandmarks() 的结果（与 image 同一坐标系）。
      * @param smoothLevel 磨皮等级 (0-100)。
      * @param thinLevel 瘦脸等级 (0-100)。
-     * @return 返回处理后的 QImage 图像。如果未检测到人脸，则返回原始图像。
+     * @param filter 磨皮使用的保边滤波器。
      */
-    QImage process(const QImage &sourceImage, int smoothLevel, int thinLevel);
+    void applyEffects(cv::Mat &image, const std::vector<dlib::full_object_detection> &faces,
+                      int smoothLevel, int thinLevel, SmoothingFilter filter);
+
+    // 把 QImage 转换为3通道BGR图像
+    static cv::Mat toBgr(const QImage &image);
+    // 把关键点缩放到另一尺寸的图像上（例如缩小的预览图）
+    static std::vector<dlib::full_object_detection> scaleLandmarks(const std::vector<dlib::full_object_detection> &faces, double scale);
 
 private:
     /**
@@ -76,8 +100,9 @@ private:
      * @param image [in, out] 要处理的 cv::Mat 图像。
      * @param landmarks 检测到的面部关键点。
      * @param level 磨皮强度。
+     * @param filter 保边滤波器。
      */
-    void applySkinSmoothing(cv::Mat &image, const dlib::full_object_detection& landmarks, int level);
+    void applySkinSmoothing(cv::Mat &image, const dlib::full_object_detection& landmarks, int level, SmoothingFilter filter);
 
     /**
      * @brief 应用瘦脸效果。
@@ -87,6 +112,27 @@ private:
      */
     void applyFaceThinning(cv::Mat &image, const dlib::full_object_detection& landmarks, int level);
 
+    /**
+     * @struct ThinningField
+     * @brief 一张脸在强度为1时的瘦脸位移场，只覆盖会移动的像素所在的区域。
+     *
+     * 位移场只取决于关键点，强度只是整体缩放，所以按关键点缓存：
+     * 拖动瘦脸滑块时不必重新计算，只需按新强度缩放位移。
+     */
+    struct ThinningField {
+        cv::Size imageSize;
+        std::vector<cv::Point> anchors; // 生成位移场所用的关键点（两侧下颌、下巴、鼻梁），作为缓存的键
+        cv::Rect roi;                   // 受影响的区域（图像坐标）
+        cv::Mat shiftX;                 // ROI 内每个像素的位移 (CV_32FC1)
+        cv::Mat shiftY;
+        float maxShift = 0.0f;          // 位移分量的最大绝对值，用于确定采样范围
+    };
+
+    /**
+     * @brief 取得一张脸的瘦脸位移场，关键点不变时直接使用缓存。
+     */
+    const ThinningField &thinningField(const cv::Size &imageSize, const dlib::full_object_detection& landmarks);
+
     // --- 成员变量 ---
 
     // dlib的人脸检测器，用于在图像中定位人脸。
@@ -100,6 +146,9 @@ private:
     // 提取到一个临时文件中，然后加载它。
     // unique_ptr 会在 BeautyProcessor 对象销毁时自动删除该临时文件。
     std::unique_ptr<QTemporaryFile> tempModelFile;
+
+    // 最近用过的瘦脸位移场，最新的在前
+    std::deque<ThinningField> thinningCache;
 };
 
 #endif // BEAUTYPROCESSOR_H
@@ -0,0 +1,133 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+// =============================================================================
+// File: beautyrenderer.cpp
+//
+// Description:
+// BeautyRenderer 类的实现文件。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include "beautyrenderer.h"
+#include "imageconverter.h"
+#include <algorithm>
+
+/**
+ * @brief BeautyRenderer 构造函数。
+ */
+BeautyRenderer::BeautyRenderer(const QImage &source, QObject *parent)
+    : QThread(parent), sourceImage(source)
+{
+}
+
+/**
+ * @brief BeautyRenderer 析构函数：停止并等待线程。
+ */
+BeautyRenderer::~BeautyRenderer()
+{
+    stop();
+}
+
+/**
+ * @brief 提交渲染请求，替换尚未开始的旧请求。
+ */
+quint64 BeautyRenderer::requestRender(const Request &request)
+{
+    QMutexLocker locker(&mutex);
+    pendingRequest = request;
+    requestPending = true;
+    wake.wakeOne();
+    return ++pendingSerial;
+}
+
+/**
+ * @brief 请求停止，不等待线程结束。
+ */
+void BeautyRenderer::requestStop()
+{
+    QMutexLocker locker(&mutex);
+    stopping = true;
+    wake.wakeOne();
+}
+
+/**
+ * @brief 停止并等待线程结束。正在进行的检测或渲染完成后线程即退出。
+ */
+void BeautyRenderer::stop()
+{
+    requestStop();
+    wait();
+}
+
+/**
+ * @brief 渲染线程的主函数。
+ *
+ * 1. 加载模型，检测人脸并定位关键点，准备预览尺寸的图像和关键点。
+ * 2. 循环等待请求，每次只取最新的一个，在对应尺寸的图像副本上应用美颜效果。
+ */
+void BeautyRenderer::run()
+{
+    // --- 1. 一次性的检测 ---
+    // 模型也在这个线程中加载，打开对话框时界面不会卡住
+    BeautyProcessor processor;
+    const cv::Mat full = BeautyProcessor::toBgr(sourceImage);
+    const std::vector<dlib::full_object_detection> faces = processor.detectLandmarks(full);
+    {
+        // 检测期间对话框可能已经关闭
+        QMutexLocker locker(&mutex);
+        if (stopping) return;
+    }
+
+    cv::Mat preview = full;
+    std::vector<dlib::full_object_detection> previewFaces = faces;
+    const int longSide = std::max(full.cols, full.rows);
+    if (longSide > previewMaxSide) {
+        const double scale = previewMaxSide / static_cast<double>(longSide);
+        cv::resize(full, preview, cv::Size(), scale, scale, cv::INTER_AREA);
+        previewFaces = BeautyProcessor::scaleLandmarks(faces, scale);
+    }
+    emit facesDetected(static_cast<int>(faces.size()));
+
+    // --- 2. 按最新的请求反复应用效果 ---
+    while (true) {
+        Request request;
+        quint64 serial = 0;
+        {
+            QMutexLocker locker(&mutex);
+            while (!stopping && !requestPending) wake.wait(&mutex);
+            if (stopping) break;
+            request = pendingRequest;
+            serial = pendingSerial;
+            requestPending = false;
+        }
+
+        const cv::Mat &base = request.preview ? preview : full;
+        if (base.empty()) {
+            emit rendered(QImage(), request.preview, serial);
+            continue;
+        }
+        cv::Mat image = base.clone();
+        processor.applyEffects(image, request.preview ? previewFaces : faces,
+                               request.smoothLevel, request.thinLevel, request.filter);
+        emit rendered(ImageConverter::matToQImage(image), request.preview, serial);
+    }
+}
@@ -0,0 +1,133 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+#ifndef BEAUTYRENDERER_H
+#define BEAUTYRENDERER_H
+
+// =============================================================================
+// File: beautyrenderer.h
+//
+// Description:
+// 该文件定义了 BeautyRenderer 类，在后台线程中为美颜对话框检测人脸并应用美颜效果。
+// 人脸和关键点对每张源图像只检测一次，之后调整参数时只重新应用滤镜。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QImage>
+#include <vector>
+#include <opencv2/core.hpp>
+#include "beautyprocessor.h"
+
+/**
+ * @class BeautyRenderer
+ * @brief 美颜的后台渲染线程：一次检测，反复应用。
+ *
+ * [检测]
+ * 线程启动后先加载模型、检测人脸并定位关键点，结果（以及缩放到预览尺寸的副本）
+ * 在对话框打开期间一直复用，拖动滑块不会再运行 HOG 检测器和关键点预测器。
+ *
+ * [渲染请求]
+ * requestRender() 只保留最新的一个请求：线程正在渲染时到来的多个请求被合并，
+ * 渲染完当前这一帧后直接处理最新的参数，结果不会落后于滑块。
+ * 预览请求在长边不超过 previewMaxSide 的缩小图像上进行，最终结果在原图上进行。
+ *
+ * [停止]
+ * 检测和一次渲染都无法中途打断。关闭对话框时应调用 requestStop() 并在 finished() 后释放，
+ * 而不是在界面线程中 stop() 等待。
+ */
+class BeautyRenderer : public QThread
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @struct Request
+     * @brief 一次渲染的参数。
+     */
+    struct Request {
+        int smoothLevel = 0;
+        int thinLevel = 0;
+        BeautyProcessor::SmoothingFilter filter = BeautyProcessor::GuidedFilter;
+        bool preview = true; // true：在预览尺寸上渲染；false：在原图上渲染
+    };
+
+    // 预览图像长边的上限（像素）
+    static const int previewMaxSide = 1280;
+
+    /**
+     * @brief 构造函数。
+     * @param source 源图像，线程启动后在其上检测人脸。
+     * @param parent 父对象。
+     */
+    explicit BeautyRenderer(const QImage &source, QObject *parent = nullptr);
+    ~BeautyRenderer();
+
+    /**
+     * @brief 提交渲染请求（任意线程），替换尚未开始的旧请求。
+     * @return 请求的序号，与 rendered() 中的序号对应。
+     */
+    quint64 requestRender(const Request &request);
+
+    /**
+     * @brief 请求停止（不等待）。人脸检测或正在进行的渲染完成后线程即退出，不再处理其余请求。
+     */
+    void requestStop();
+
+    /**
+     * @brief 停止并等待线程结束。
+     */
+    void stop();
+
+signals:
+    /**
+     * @brief 人脸检测完成。
+     * @param faceCount 检测到的人脸数。
+     */
+    void facesDetected(int faceCount);
+
+    /**
+     * @brief 一个请求渲染完成。
+     * @param image 渲染结果（预览请求为缩小的图像）。
+     * @param preview 是否为预览请求。
+     * @param serial 请求的序号。
+     */
+    void rendered(const QImage &image, bool preview, quint64 serial);
+
+protected:
+    // 渲染线程的主函数
+    void run() override;
+
+private:
+    QImage sourceImage;
+
+    // --- 线程间共享状态（由 mutex 保护） ---
+    QMutex mutex;
+    QWaitCondition wake;          // 有新请求或停止请求
+    Request pendingRequest;
+    quint64 pendingSerial = 0;    // 最新请求的序号
+    bool requestPending = false;
+    bool stopping = false;
+};
+
+#endif // BEAUTYRENDERER_H
@@ -0,0 +1,151 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+// =============================================================================
+// File: main.cpp (texturetransferbench)
+//
+// Description:
+// 纹理迁移的计时程序。用固定种子生成的内容图（正弦图案）和纹理图（模糊噪声叠加条纹），
+// 在几种固定尺寸上运行 ImageTextureTransferProcessor::process，输出每层金字塔的耗时。
+// 层的分界取自处理器输出的 "--- Processing Pyramid Level N ---" 调试信息，新旧版本都有这条信息，
+// 因此同一个程序可以编译旧版本的源文件做对比（见 texturetransferbench.pro）。
+//
+// 用法：texturetransferbench [--threads N] [--save 目录] [尺寸...]
+//   默认尺寸为 256 512 1024，线程数为1（只比较单线程的算法耗时）。
+//   --save 把结果保存为 PNG，便于比较新旧版本的合成质量。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include "imagetexturetransferprocessor.h"
+#include "imageconverter.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QRegularExpression>
+#include <QStringList>
+#include <opencv2/opencv.hpp>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+/**
+ * @struct LevelMark
+ * @brief 处理器开始某一层时的时间点。
+ */
+struct LevelMark {
+    int level;
+    qint64 startNs;
+};
+
+static QElapsedTimer benchClock;
+static std::vector<LevelMark> levelMarks;
+
+/**
+ * @brief 记录每层开始的时间，其余调试信息丢弃，避免输出影响计时。
+ */
+static void levelMessageHandler(QtMsgType, const QMessageLogContext &, const QString &message)
+{
+    static const QRegularExpression levelPattern("Processing Pyramid Level\\s+(\\d+)");
+    const QRegularExpressionMatch match = levelPattern.match(message);
+    if (match.hasMatch()) levelMarks.push_back({match.captured(1).toInt(), benchClock.nsecsElapsed()});
+}
+
+/**
+ * @brief 生成固定的测试输入（BGR，size×size），同样的尺寸每次得到同样的图像。
+ */
+static void makeInputs(int size, cv::Mat &content, cv::Mat &texture)
+{
+    content.create(size, size, CV_8UC3);
+    for (int y = 0; y < size; ++y) {
+        cv::Vec3b *row = content.ptr<cv::Vec3b>(y);
+        for (int x = 0; x < size; ++x) {
+            for (int c = 0; c < 3; ++c) {
+                const double v = 127.0 + 100.0 * std::sin(6.0 * x / size + c) * std::cos(4.0 * y / size);
+                row[x][c] = cv::saturate_cast<uchar>(v);
+            }
+        }
+    }
+
+    cv::Mat noise(size, size, CV_8UC3);
+    cv::RNG rng(7);
+    rng.fill(noise, cv::RNG::UNIFORM, 0, 256);
+    cv::GaussianBlur(noise, texture, cv::Size(0, 0), 2.0);
+    cv::normalize(texture, texture, 0, 255, cv::NORM_MINMAX);
+    cv::Mat stripes(size, size, CV_8UC3);
+    for (int y = 0; y < size; ++y) {
+        cv::Vec3b *row = stripes.ptr<cv::Vec3b>(y);
+        for (int x = 0; x < size; ++x) {
+            const uchar v = static_cast<uchar>(127.0 + 80.0 * std::sin((x + y) / 7.0));
+            row[x] = cv::Vec3b(v, v, v);
+        }
+    }
+    cv::addWeighted(texture, 0.6, stripes, 0.4, 0.0, texture);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    // --- 1. 解析参数 ---
+    int threads = 1;
+    QString saveDir;
+    std::vector<int> sizes;
+    const QStringList args = app.arguments();
+    for (int i = 1; i < args.size(); ++i) {
+        if (args[i] == "--threads" && i + 1 < args.size()) threads = args[++i].toInt();
+        else if (args[i] == "--save" && i + 1 < args.size()) saveDir = args[++i];
+        else if (args[i].toInt() > 0) sizes.push_back(args[i].toInt());
+    }
+    if (sizes.empty()) sizes = {256, 512, 1024};
+    cv::setNumThreads(threads); // 处理器的并行合成也走 OpenCV 的线程池
+    if (!saveDir.isEmpty()) QDir().mkpath(saveDir);
+
+    qInstallMessageHandler(levelMessageHandler);
+    benchClock.start();
+
+    // --- 2. 逐个尺寸计时 ---
+    std::printf("threads: %d\n", threads);
+    for (int size : sizes) {
+        cv::Mat content, texture;
+        makeInputs(size, content, texture);
+        const QImage contentImage = ImageConverter::matToQImage(content);
+        const QImage textureImage = ImageConverter::matToQImage(texture);
+
+        levelMarks.clear();
+        const qint64 startNs = benchClock.nsecsElapsed();
+        const QImage result = ImageTextureTransferProcessor::process(contentImage, textureImage);
+        const qint64 endNs = benchClock.nsecsElapsed();
+
+        // 每层的耗时到下一层开始为止，最后一层包含之后的颜色处理
+        std::printf("size %d:\n", size);
+        if (!levelMarks.empty()) std::printf("  setup    %9.1f ms\n", (levelMarks.front().startNs - startNs) / 1e6);
+        for (size_t i = 0; i < levelMarks.size(); ++i) {
+            const qint64 until = i + 1 < levelMarks.size() ? levelMarks[i + 1].startNs : endNs;
+            std::printf("  level %d  %9.1f ms\n", levelMarks[i].level, (until - levelMarks[i].startNs) / 1e6);
+        }
+        std::printf("  total    %9.1f ms\n", (endNs - startNs) / 1e6);
+
+        if (!saveDir.isEmpty() && !result.isNull()) result.save(QDir(saveDir).filePath(QString("result_%1.png").arg(size)));
+    }
+    return 0;
+}
@@ -0,0 +1,39 @@
+# =============================================================================
+# texturetransferbench.pro
+#
+# 纹理迁移的计时程序（独立的控制台程序，不参与主程序的构建）。
+# 用固定的合成输入运行 ImageTextureTransferProcessor::process，输出每层金字塔的耗时。
+#
+# 默认编译本仓库中的处理器源文件；要与旧版本对比，把 BENCH_SOURCE_DIR 指向旧版本的检出目录：
+#   git worktree add ../tt-old <旧的提交>
+#   qmake BENCH_SOURCE_DIR=/绝对路径/tt-old texturetransferbench.pro
+#
+# 项目维护者：g64
+# 最后更新日期：2025-07-25
+# =============================================================================
+
+QT += core gui
+CONFIG += c++17 console
+CONFIG -= app_bundle
+TARGET = texturetransferbench
+
+isEmpty(BENCH_SOURCE_DIR): BENCH_SOURCE_DIR = $$PWD/../..
+
+# 第三方库的路径与主程序 (Qt_Image_Processor.pro) 相同
+VCPKG_ROOT_PATH = "C:/vcpkg/vcpkg/installed/x64-windows"
+QMAKE_CXXFLAGS += -I$$VCPKG_ROOT_PATH/include/opencv4
+INCLUDEPATH += $$VCPKG_ROOT_PATH/include $$BENCH_SOURCE_DIR
+LIBS += -L$$VCPKG_ROOT_PATH/lib
+
+# 旧版本的处理器用到了 saliency 模块
+CONFIG(debug, debug|release) {
+    LIBS += -lopencv_core4d -lopencv_imgproc4d -lopencv_imgcodecs4d -lopencv_saliency4d
+} else {
+    LIBS += -lopencv_core4 -lopencv_imgproc4 -lopencv_imgcodecs4 -lopencv_saliency4
+}
+
+SOURCES += main.cpp \
+           $$BENCH_SOURCE_DIR/imageconverter.cpp \
+           $$BENCH_SOURCE_DIR/imagetexturetransferprocessor.cpp
+HEADERS += $$BENCH_SOURCE_DIR/imageconverter.h \
+           $$BENCH_SOURCE_DIR/imagetexturetransferprocessor.h
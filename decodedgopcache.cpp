@@ -0,0 +1,177 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+// =============================================================================
+// File: decodedgopcache.cpp
+//
+// Description:
+// DecodedGopCache 类的实现文件。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include "decodedgopcache.h"
+#include <opencv2/imgproc.hpp>
+
+/**
+ * @brief DecodedGopCache 构造函数。
+ * @param budgetBytes 缓存的总字节数上限。
+ */
+DecodedGopCache::DecodedGopCache(size_t budgetBytes)
+    : budgetBytes(budgetBytes)
+{
+}
+
+/**
+ * @brief 在关键帧处开始收集新的 GOP。
+ * @param keyMs 关键帧的时间戳（毫秒）。
+ */
+void DecodedGopCache::beginGop(qint64 keyMs)
+{
+    finishGop(keyMs);
+    if (budget() == 0) return;
+    building.keyMs = keyMs;
+    collecting = true;
+}
+
+/**
+ * @brief 结束当前 GOP 并存入缓存。
+ *
+ * 同一个关键帧已有条目时，保留起点更早（覆盖范围更大）的那一个。
+ * @param endMs GOP 的终点（下一个关键帧的时间戳）。
+ */
+void DecodedGopCache::finishGop(qint64 endMs)
+{
+    if (!collecting) return;
+    collecting = false;
+    Gop gop = std::move(building);
+    building = Gop();
+    if (gop.frames.empty() || endMs <= gop.frames.back().pts) return;
+    gop.endMs = endMs;
+
+    QMutexLocker locker(&mutex);
+    auto it = gops.find(gop.keyMs);
+    if (it != gops.end()) {
+        if (it->second.frames.front().pts <= gop.frames.front().pts) {
+            it->second.lastUse = ++useCounter;
+            return;
+        }
+        used.fetch_sub(it->second.bytes, std::memory_order_relaxed);
+        gops.erase(it);
+    }
+    gop.lastUse = ++useCounter;
+    used.fetch_add(gop.bytes, std::memory_order_relaxed);
+    gops.emplace(gop.keyMs, std::move(gop));
+    evictLocked();
+}
+
+/**
+ * @brief 丢弃收集到一半的 GOP。
+ */
+void DecodedGopCache::abandonGop()
+{
+    collecting = false;
+    building = Gop();
+}
+
+/**
+ * @brief 追加一帧画面，转换为 I420 后保存。
+ * @param bgr BGR24 画面。
+ * @param pts 显示时间戳（毫秒）。
+ */
+void DecodedGopCache::append(const cv::Mat &bgr, qint64 pts)
+{
+    if (!collecting) return;
+    // I420 要求宽高都是偶数；尺寸中途变化（切换呈现尺寸或录制）的 GOP 不再完整
+    if ((bgr.cols & 1) || (bgr.rows & 1)
+        || (!building.frames.empty() && (bgr.size() != building.size || pts <= building.frames.back().pts))) {
+        abandonGop();
+        return;
+    }
+    Frame frame;
+    frame.pts = pts;
+    cv::cvtColor(bgr, frame.yuv, cv::COLOR_BGR2YUV_I420);
+    building.size = bgr.size();
+    building.bytes += frame.yuv.total() * frame.yuv.elemSize();
+    // 单个 GOP 就超出限额，存不下
+    if (building.bytes > budget()) {
+        abandonGop();
+        return;
+    }
+    building.frames.push_back(std::move(frame));
+}
+
+/**
+ * @brief 查找覆盖指定时间点的 GOP。
+ */
+bool DecodedGopCache::lookup(qint64 ms, const cv::Size &size, qint64 toleranceMs, std::vector<Frame> &frames, qint64 &endMs) const
+{
+    QMutexLocker locker(&mutex);
+    auto it = gops.upper_bound(ms + toleranceMs);
+    if (it == gops.begin()) return false;
+    --it;
+    const Gop &gop = it->second;
+    if (gop.size != size || ms >= gop.endMs || gop.frames.front().pts > ms + toleranceMs) return false;
+    frames.clear();
+    for (const Frame &frame : gop.frames) {
+        if (frame.pts + toleranceMs >= ms) frames.push_back(frame);
+    }
+    if (frames.empty()) return false;
+    endMs = gop.endMs;
+    gop.lastUse = ++useCounter;
+    return true;
+}
+
+/**
+ * @brief 修改字节限额。
+ * @param budgetBytes 新的字节上限，0 表示不缓存。
+ */
+void DecodedGopCache::setBudget(size_t budgetBytes)
+{
+    this->budgetBytes.store(budgetBytes, std::memory_order_relaxed);
+    QMutexLocker locker(&mutex);
+    evictLocked();
+}
+
+/**
+ * @brief 清空缓存。
+ */
+void DecodedGopCache::clear()
+{
+    QMutexLocker locker(&mutex);
+    gops.clear();
+    used.store(0, std::memory_order_relaxed);
+}
+
+/**
+ * @brief 淘汰最近最少使用的 GOP。
+ */
+void DecodedGopCache::evictLocked()
+{
+    const size_t limit = budget();
+    while (!gops.empty() && used.load(std::memory_order_relaxed) > limit) {
+        auto oldest = gops.begin();
+        for (auto it = gops.begin(); it != gops.end(); ++it) {
+            if (it->second.lastUse < oldest->second.lastUse) oldest = it;
+        }
+        used.fetch_sub(oldest->second.bytes, std::memory_order_relaxed);
+        gops.erase(oldest);
+    }
+}
@@ -0,0 +1,140 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+#ifndef DECODEDGOPCACHE_H
+#define DECODEDGOPCACHE_H
+
+// =============================================================================
+// File: decodedgopcache.h
+//
+// Description:
+// 该文件定义了 DecodedGopCache 类，按关键帧时间戳缓存最近解码过的 GOP，
+// 逐帧后退、A-B 循环和反复拖动到同一区域时直接从缓存取帧，不再经过解码器。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include <QMutex>
+#include <opencv2/core.hpp>
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <vector>
+
+/**
+ * @class DecodedGopCache
+ * @brief 按字节限额的已解码 GOP 缓存。
+ *
+ * [内容]
+ * 每个条目是一个 GOP 中从某一帧（通常就是关键帧）起直到下一个关键帧之前的连续画面，
+ * 以关键帧的时间戳为键。画面按呈现尺寸（已经缩小过）转换为 YUV420 (I420) 保存，
+ * 每像素1.5字节，只有BGR24的一半。跳转目标落在某个条目覆盖的范围内时，
+ * 解码器直接把缓存中的画面转回BGR输出，这个 GOP 的视频数据包不再解码。
+ *
+ * [收集]
+ * 视频解码线程在每个关键帧处调用 beginGop()，之后逐帧 append()；
+ * 下一个关键帧到来（或文件结束）时，前一个 GOP 才算完整并存入缓存。
+ * 跳转时 abandonGop() 丢弃收集到一半的 GOP。
+ *
+ * [淘汰]
+ * 总字节数超过限额时按最近最少使用的顺序淘汰整个 GOP；限额为0时不缓存。
+ *
+ * [线程约定]
+ * 收集接口只能由视频解码线程调用；查询、限额和统计接口可以由任意线程调用。
+ */
+class DecodedGopCache
+{
+public:
+    /**
+     * @struct Frame
+     * @brief 缓存中的一帧。
+     */
+    struct Frame {
+        qint64 pts = 0; // 显示时间戳（毫秒）
+        cv::Mat yuv;    // I420 数据（高度为画面的1.5倍的单通道图像）
+    };
+
+    /**
+     * @brief 构造函数。
+     * @param budgetBytes 缓存的总字节数上限，0 表示不缓存。
+     */
+    explicit DecodedGopCache(size_t budgetBytes);
+
+    DecodedGopCache(const DecodedGopCache&) = delete;
+    DecodedGopCache& operator=(const DecodedGopCache&) = delete;
+
+    // --- 收集（视频解码线程） ---
+    // 在关键帧处开始收集新的 GOP，上一个 GOP 以该关键帧为终点存入缓存
+    void beginGop(qint64 keyMs);
+    // 以指定时间为终点结束当前 GOP 并存入缓存（文件结束时传入 qint64 的最大值）
+    void finishGop(qint64 endMs);
+    // 丢弃收集到一半的 GOP（跳转时）
+    void abandonGop();
+    // 追加一帧BGR24画面。尺寸变化、时间戳不递增或超出限额时放弃当前 GOP。
+    void append(const cv::Mat &bgr, qint64 pts);
+    // 是否正在收集（没有在收集时 append() 直接返回，调用者可以省掉准备画面的开销）
+    bool isCollecting() const { return collecting; }
+
+    // --- 查询（任意线程） ---
+    /**
+     * @brief 查找覆盖指定时间点的 GOP，取出从该时间点起到 GOP 结尾的画面。
+     * @param ms 目标时间点（毫秒）。
+     * @param size 需要的画面尺寸，与缓存尺寸不同时视为未命中。
+     * @param toleranceMs 时间戳的容差（通常为半帧）。
+     * @param frames [out] 从目标帧起的画面（共享缓存数据，不拷贝像素）。
+     * @param endMs [out] 该 GOP 的终点，即下一个关键帧的时间戳。
+     * @return 命中返回true。
+     */
+    bool lookup(qint64 ms, const cv::Size &size, qint64 toleranceMs, std::vector<Frame> &frames, qint64 &endMs) const;
+
+    // 修改字节限额，超出部分立即淘汰
+    void setBudget(size_t budgetBytes);
+    // 清空缓存
+    void clear();
+
+    // --- 统计信息（任意线程） ---
+    size_t budget() const { return budgetBytes.load(std::memory_order_relaxed); }
+    size_t usedBytes() const { return used.load(std::memory_order_relaxed); }
+
+private:
+    struct Gop {
+        qint64 keyMs = 0;     // 关键帧的时间戳
+        qint64 endMs = 0;     // 下一个关键帧的时间戳
+        cv::Size size;        // 画面尺寸（BGR）
+        std::vector<Frame> frames;
+        size_t bytes = 0;
+        mutable quint64 lastUse = 0; // 最近一次存入或命中的顺序号，用于淘汰
+    };
+
+    // 淘汰最近最少使用的 GOP，直到总字节数不超过限额（调用者需持有锁）
+    void evictLocked();
+
+    mutable QMutex mutex;
+    std::map<qint64, Gop> gops;        // 以关键帧时间戳为键（由 mutex 保护）
+    mutable quint64 useCounter = 0;    // 使用顺序号（由 mutex 保护）
+    std::atomic<size_t> budgetBytes;   // 字节限额
+    std::atomic<size_t> used{0};       // 当前占用的字节数
+
+    // 正在收集的 GOP（只由视频解码线程访问）
+    Gop building;
+    bool collecting = false;
+};
+
+#endif // DECODEDGOPCACHE_H
@@ -0,0 +1,144 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+// =============================================================================
+// File: decoderprefetcher.cpp
+//
+// Description:
+// DecoderPrefetcher 类的实现文件。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include "decoderprefetcher.h"
+#include "videodecoder.h"
+#include <algorithm>
+
+/**
+ * @brief DecoderPrefetcher 构造函数。
+ */
+DecoderPrefetcher::DecoderPrefetcher(QObject *parent)
+    : QObject(parent)
+{
+}
+
+/**
+ * @brief DecoderPrefetcher 析构函数。
+ *
+ * 先让所有解码器同时开始停止，子对象随后逐个销毁时各自的等待就很短。
+ */
+DecoderPrefetcher::~DecoderPrefetcher()
+{
+    for (VideoDecoder *decoder : findChildren<VideoDecoder*>(Qt::FindDirectChildrenOnly)) decoder->stop();
+}
+
+/**
+ * @brief 取出指定文件的解码器。
+ * @param filePath 视频文件路径。
+ * @return 解码器（以预取池为父对象）。
+ */
+VideoDecoder *DecoderPrefetcher::take(const QString &filePath)
+{
+    auto it = std::find_if(warmDecoders.begin(), warmDecoders.end(),
+                           [&](VideoDecoder *decoder) { return decoder->sourceFile() == filePath; });
+    if (it == warmDecoders.end()) {
+        VideoDecoder *decoder = new VideoDecoder(this);
+        decoder->startDecodingAsync(filePath);
+        return decoder;
+    }
+    VideoDecoder *decoder = *it;
+    warmDecoders.erase(it);
+    disconnect(decoder, nullptr, this, nullptr);
+    decoder->setPrefetchMode(false);
+    return decoder;
+}
+
+/**
+ * @brief 交还一个不再播放的解码器：清除回调，跳回开头并转入预取模式。
+ */
+void DecoderPrefetcher::recycle(VideoDecoder *decoder)
+{
+    if (!decoder) return;
+    // 播放端已经等到过打开结果，这里不会阻塞
+    if (!decoder->isRunning() || !decoder->waitForOpened()) {
+        retire(decoder);
+        return;
+    }
+    decoder->setFrameTap(nullptr);
+    decoder->setAudioTap(nullptr);
+    decoder->setTelemetry(nullptr);
+    decoder->setFullResolution(false);
+    decoder->setAudioOutputEnabled(true);
+    decoder->setSkipMode(VideoDecoder::DecodeAllFrames);
+    decoder->setPrefetchMode(true);
+    decoder->seek(0);
+    // 没有播放端取帧，跳转完成后由这里清掉待显示缓冲区中的旧帧，开头的几帧才能解码出来
+    connect(decoder, &VideoDecoder::seekFinished, this, [decoder]() { decoder->discardStaleFrames(); });
+    warmDecoders.push_back(decoder);
+}
+
+/**
+ * @brief 预热指定的文件。
+ * @param filePaths 需要预热的文件路径。
+ * @param targetSize 呈现尺寸（物理像素）。
+ */
+void DecoderPrefetcher::prefetch(const QStringList &filePaths, const QSize &targetSize)
+{
+    std::vector<VideoDecoder*> kept;
+    for (const QString &path : filePaths) {
+        if (path.isEmpty()) continue;
+        auto it = std::find_if(warmDecoders.begin(), warmDecoders.end(),
+                               [&](VideoDecoder *decoder) { return decoder->sourceFile() == path; });
+        if (it != warmDecoders.end()) {
+            kept.push_back(*it);
+            warmDecoders.erase(it);
+            continue;
+        }
+        VideoDecoder *decoder = new VideoDecoder(this);
+        decoder->setTargetSize(targetSize.width(), targetSize.height());
+        decoder->setPrefetchMode(true);
+        decoder->startDecodingAsync(path);
+        kept.push_back(decoder);
+    }
+    for (VideoDecoder *decoder : warmDecoders) retire(decoder);
+    warmDecoders = std::move(kept);
+    for (VideoDecoder *decoder : warmDecoders) decoder->setTargetSize(targetSize.width(), targetSize.height());
+}
+
+/**
+ * @brief 异步停止并销毁池中所有的解码器。
+ */
+void DecoderPrefetcher::clear()
+{
+    for (VideoDecoder *decoder : warmDecoders) retire(decoder);
+    warmDecoders.clear();
+}
+
+/**
+ * @brief 停止解码器，线程退出后再删除。
+ */
+void DecoderPrefetcher::retire(VideoDecoder *decoder)
+{
+    disconnect(decoder, nullptr, this, nullptr);
+    decoder->stop();
+    connect(decoder, &QThread::finished, decoder, &QObject::deleteLater);
+    // 线程已经退出（或从未启动）时不会再有 finished 信号；重复调用 deleteLater 是安全的
+    if (!decoder->isRunning()) decoder->deleteLater();
+}
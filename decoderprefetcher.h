@@ -0,0 +1,98 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+#ifndef DECODERPREFETCHER_H
+#define DECODERPREFETCHER_H
+
+// =============================================================================
+// File: decoderprefetcher.h
+//
+// Description:
+// 该文件定义了 DecoderPrefetcher 类，在后台预先打开播放列表中的相邻视频，
+// 切换视频时直接取用已经打开并解码好开头几帧的解码器。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include <QObject>
+#include <QSize>
+#include <QStringList>
+#include <vector>
+
+class VideoDecoder;
+
+/**
+ * @class DecoderPrefetcher
+ * @brief 播放列表的解码器预取池（主线程）。
+ *
+ * [预热]
+ * prefetch() 为给定的文件（通常是当前项的前后两项）各准备一个预取模式的解码器：
+ * 后台解析流信息、打开解码器，并解码开头的几帧和约2秒音频后停下等待，
+ * 切换到这些视频时不再需要探测文件和等待首帧。
+ *
+ * [复用]
+ * 播放结束（切换到别的视频）的解码器通过 recycle() 交还：清除所有回调，跳回开头并转入预取模式，
+ * 而不是销毁；下一次 prefetch() 时如果它仍是相邻项就被保留，否则才异步停止并销毁。
+ * 不再需要的解码器在后台线程退出后才真正删除，主线程不会因等待它们而卡住。
+ *
+ * [所有权]
+ * 所有解码器都以预取池为父对象，take() 取出的解码器也不例外；用完后应交还 recycle()。
+ */
+class DecoderPrefetcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DecoderPrefetcher(QObject *parent = nullptr);
+    ~DecoderPrefetcher();
+
+    /**
+     * @brief 取出指定文件的解码器：有预热好的就直接取出，否则新建一个并开始打开。
+     *
+     * 返回的解码器已退出预取模式，调用者随后用 VideoDecoder::waitForOpened() 确认打开结果。
+     * @param filePath 视频文件路径。
+     */
+    VideoDecoder *take(const QString &filePath);
+
+    /**
+     * @brief 交还一个不再播放的解码器。打开失败或已经停止的解码器直接销毁。
+     */
+    void recycle(VideoDecoder *decoder);
+
+    /**
+     * @brief 预热指定的文件，池中其他的解码器被异步停止和销毁。
+     * @param filePaths 需要预热的文件路径，空字符串被忽略。
+     * @param targetSize 呈现尺寸（物理像素），预热的帧直接按此尺寸输出。
+     */
+    void prefetch(const QStringList &filePaths, const QSize &targetSize);
+
+    /**
+     * @brief 异步停止并销毁池中所有的解码器。
+     */
+    void clear();
+
+private:
+    // 停止解码器，线程退出后再删除
+    void retire(VideoDecoder *decoder);
+
+    std::vector<VideoDecoder*> warmDecoders; // 预取模式下闲置的解码器
+};
+
+#endif // DECODERPREFETCHER_H
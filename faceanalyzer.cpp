@@ -0,0 +1,386 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+// =============================================================================
+// File: faceanalyzer.cpp
+//
+// Description:
+// FaceAnalyzer 类的实现文件。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include "faceanalyzer.h"
+#include <QDebug>
+#include <algorithm>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/video/tracking.hpp>
+#include <dlib/opencv.h>
+
+// 分析用小图的最大宽度（像素）
+static const int analysisWidth = 640;
+// 输入队列与历史帧的长度上限
+static const size_t maxQueuedFrames = 8;
+static const size_t maxHistoryFrames = 60;
+// 保留的已发布结果个数
+static const size_t maxResults = 120;
+// 取结果时允许的最大时间差（毫秒）
+static const qint64 maxResultAgeMs = 200;
+// 时间戳跳变超过该值视为跳转，清空跟踪状态
+static const qint64 discontinuityMs = 1000;
+// 每个人脸框的特征点个数与跟踪失败的下限
+static const int maxPointsPerFace = 40;
+static const size_t minPointsPerFace = 6;
+
+/**
+ * @brief FaceAnalyzer 构造函数，加载 dlib 人脸检测器。
+ */
+FaceAnalyzer::FaceAnalyzer(QObject *parent)
+    : QThread(parent)
+{
+    try {
+        detector = dlib::get_frontal_face_detector();
+    } catch (const std::exception &e) {
+        qWarning() << "Failed to load dlib face detector:" << e.what();
+    }
+}
+
+/**
+ * @brief FaceAnalyzer 析构函数。
+ */
+FaceAnalyzer::~FaceAnalyzer()
+{
+    stopAnalysis();
+}
+
+/**
+ * @brief 启动跟踪线程和检测线程。
+ */
+void FaceAnalyzer::startAnalysis()
+{
+    if (isRunning()) return;
+    {
+        QMutexLocker locker(&mutex);
+        stopping = false;
+        resetRequested = true;
+    }
+    detectorThread = QThread::create([this] { detectorLoop(); });
+    detectorThread->start(QThread::LowPriority);
+    start();
+}
+
+/**
+ * @brief 停止并等待两个线程，清空所有状态。
+ */
+void FaceAnalyzer::stopAnalysis()
+{
+    {
+        QMutexLocker locker(&mutex);
+        stopping = true;
+        trackerWake.wakeAll();
+        detectorWake.wakeAll();
+    }
+    wait();
+    if (detectorThread) {
+        detectorThread->wait();
+        delete detectorThread;
+        detectorThread = nullptr;
+    }
+    {
+        QMutexLocker locker(&mutex);
+        inputQueue.clear();
+        detectPending = detectBusy = detectionReady = false;
+    }
+    reset();
+}
+
+/**
+ * @brief 清空跟踪状态与已发布的结果。
+ */
+void FaceAnalyzer::reset()
+{
+    {
+        QMutexLocker locker(&resultMutex);
+        results.clear();
+    }
+    // 跟踪线程在下一次循环时清空自己的状态
+    QMutexLocker locker(&mutex);
+    inputQueue.clear();
+    resetRequested = true;
+}
+
+/**
+ * @brief 提交一帧待分析的画面。
+ */
+void FaceAnalyzer::submitFrame(const cv::Mat &frame, qint64 pts)
+{
+    if (frame.empty()) return;
+    Sample sample;
+    sample.pts = pts;
+    sample.frameSize = frame.size();
+    // 先缩小再灰度化，调用者线程只付出小图的开销
+    cv::Mat small;
+    if (frame.cols > analysisWidth) {
+        const double scale = static_cast<double>(analysisWidth) / frame.cols;
+        cv::resize(frame, small, cv::Size(), scale, scale, cv::INTER_AREA);
+    } else {
+        small = frame;
+    }
+    cv::cvtColor(small, sample.gray, cv::COLOR_BGR2GRAY);
+
+    QMutexLocker locker(&mutex);
+    if (stopping) return;
+    if (inputQueue.size() >= maxQueuedFrames) inputQueue.pop_front();
+    inputQueue.push_back(std::move(sample));
+    trackerWake.wakeOne();
+}
+
+/**
+ * @brief 取出与时间戳匹配的分析结果。
+ */
+bool FaceAnalyzer::resultAt(qint64 pts, Result &result) const
+{
+    QMutexLocker locker(&resultMutex);
+    for (auto it = results.rbegin(); it != results.rend(); ++it) {
+        if (it->pts > pts) continue;
+        if (pts - it->pts > maxResultAgeMs) return false;
+        result = *it;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief 跟踪线程主函数。
+ */
+void FaceAnalyzer::run()
+{
+    std::deque<Sample> history; // 最近的小图，用于按时间戳重新锚定检测结果
+    std::vector<Track> tracks;
+    int framesSinceDetection = detectionInterval.load(std::memory_order_relaxed);
+
+    while (true) {
+        Sample sample;
+        Detection detection;
+        bool haveSample = false, haveDetection = false;
+        {
+            QMutexLocker locker(&mutex);
+            while (!stopping && inputQueue.empty() && !detectionReady) {
+                trackerWake.wait(&mutex);
+            }
+            if (stopping) break;
+            if (resetRequested) {
+                resetRequested = false;
+                history.clear();
+                tracks.clear();
+                detectionReady = false;
+                framesSinceDetection = detectionInterval.load(std::memory_order_relaxed);
+            }
+            if (detectionReady) {
+                detection = std::move(detectionResult);
+                detectionReady = false;
+                haveDetection = true;
+            }
+            if (!inputQueue.empty()) {
+                sample = std::move(inputQueue.front());
+                inputQueue.pop_front();
+                haveSample = true;
+            }
+        }
+
+        if (haveDetection) anchorDetection(detection, history, tracks);
+        if (!haveSample) continue;
+
+        // 时间戳倒退或大幅跳变（跳转）、分辨率变化时，旧的跟踪状态作废
+        if (!history.empty()) {
+            const Sample &last = history.back();
+            if (sample.pts < last.pts || sample.pts - last.pts > discontinuityMs || sample.gray.size() != last.gray.size()) {
+                history.clear();
+                tracks.clear();
+                framesSinceDetection = detectionInterval.load(std::memory_order_relaxed);
+            }
+        }
+        if (!history.empty()) trackTracks(tracks, history.back().gray, sample.gray);
+        history.push_back(sample);
+        if (history.size() > maxHistoryFrames) history.pop_front();
+
+        // 到了检测间隔（或检测线程空闲且当前没有人脸）时请求重新检测：
+        // 跟踪丢失或刚跳转后不必等满一个间隔，检测线程忙时 requestDetection() 直接返回false
+        ++framesSinceDetection;
+        const bool detectionDue = framesSinceDetection >= detectionInterval.load(std::memory_order_relaxed) || tracks.empty();
+        if (detectionDue && requestDetection(sample)) {
+            framesSinceDetection = 0;
+        }
+        publish(sample, tracks);
+    }
+}
+
+/**
+ * @brief [跟踪线程] 尝试把一帧交给检测线程。
+ * @return 检测线程空闲并接受了请求时返回true。
+ */
+bool FaceAnalyzer::requestDetection(const Sample &sample)
+{
+    QMutexLocker locker(&mutex);
+    if (detectBusy || detectPending) return false;
+    detectRequest = sample; // 小图只读共享，不拷贝像素
+    detectPending = true;
+    detectorWake.wakeOne();
+    return true;
+}
+
+/**
+ * @brief 检测线程主函数：在小图上运行 dlib HOG 检测器。
+ */
+void FaceAnalyzer::detectorLoop()
+{
+    while (true) {
+        Sample request;
+        {
+            QMutexLocker locker(&mutex);
+            while (!stopping && !detectPending) {
+                detectorWake.wait(&mutex);
+            }
+            if (stopping) break;
+            request = detectRequest;
+            detectPending = false;
+            detectBusy = true;
+        }
+
+        Detection detection;
+        detection.pts = request.pts;
+        detection.graySize = request.gray.size();
+        try {
+            dlib::cv_image<unsigned char> image(request.gray);
+            for (const dlib::rectangle &face : detector(image)) {
+                detection.faces.emplace_back(face.left(), face.top(), face.width(), face.height());
+            }
+        } catch (const std::exception &e) {
+            qWarning() << "dlib face detection failed:" << e.what();
+        }
+
+        QMutexLocker locker(&mutex);
+        detectBusy = false;
+        detectionResult = std::move(detection);
+        detectionReady = true;
+        trackerWake.wakeOne();
+    }
+}
+
+/**
+ * @brief [跟踪线程] 用检测结果重建跟踪。
+ *
+ * 检测结果对应的是几帧之前的小图：先在那一帧上为每个人脸选取特征点，
+ * 再沿历史帧逐帧跟踪到最新一帧，得到与当前时间对齐的人脸框。
+ * 对应的历史帧已被丢弃（例如刚刚跳转）时忽略这次检测。
+ */
+void FaceAnalyzer::anchorDetection(const Detection &detection, const std::deque<Sample> &history, std::vector<Track> &tracks)
+{
+    auto it = std::find_if(history.begin(), history.end(), [&](const Sample &s) { return s.pts == detection.pts; });
+    if (it == history.end() || it->gray.size() != detection.graySize) return;
+
+    std::vector<Track> anchored;
+    for (const cv::Rect &face : detection.faces) {
+        Track track;
+        track.box = cv::Rect2f(face & cv::Rect(0, 0, it->gray.cols, it->gray.rows));
+        if (track.box.area() <= 0) continue;
+        seedPoints(track, it->gray);
+        anchored.push_back(std::move(track));
+    }
+    for (auto next = it + 1; next != history.end(); ++next) {
+        trackTracks(anchored, (next - 1)->gray, next->gray);
+    }
+    tracks = std::move(anchored);
+}
+
+/**
+ * @brief 把所有人脸框从上一帧跟踪到当前帧。
+ *
+ * 用金字塔LK光流跟踪框内的特征点，人脸框按特征点位移的中位数平移；
+ * 存活的特征点太少时视为丢失，剩余点偏少时在新位置重新选点。
+ */
+void FaceAnalyzer::trackTracks(std::vector<Track> &tracks, const cv::Mat &prevGray, const cv::Mat &gray)
+{
+    const cv::Rect2f bounds(0, 0, static_cast<float>(gray.cols), static_cast<float>(gray.rows));
+    for (auto it = tracks.begin(); it != tracks.end();) {
+        Track &track = *it;
+        if (track.points.size() < minPointsPerFace) seedPoints(track, prevGray);
+        if (track.points.size() < minPointsPerFace) { it = tracks.erase(it); continue; }
+
+        std::vector<cv::Point2f> moved;
+        std::vector<uchar> status;
+        std::vector<float> error;
+        cv::calcOpticalFlowPyrLK(prevGray, gray, track.points, moved, status, error, cv::Size(15, 15), 2);
+
+        std::vector<float> dx, dy;
+        std::vector<cv::Point2f> kept;
+        for (size_t i = 0; i < moved.size(); ++i) {
+            if (!status[i]) continue;
+            dx.push_back(moved[i].x - track.points[i].x);
+            dy.push_back(moved[i].y - track.points[i].y);
+            kept.push_back(moved[i]);
+        }
+        if (kept.size() < minPointsPerFace) { it = tracks.erase(it); continue; }
+
+        std::nth_element(dx.begin(), dx.begin() + dx.size() / 2, dx.end());
+        std::nth_element(dy.begin(), dy.begin() + dy.size() / 2, dy.end());
+        track.box.x += dx[dx.size() / 2];
+        track.box.y += dy[dy.size() / 2];
+        track.box &= bounds;
+        if (track.box.area() <= 0) { it = tracks.erase(it); continue; }
+        track.points = std::move(kept);
+        if (track.points.size() < maxPointsPerFace / 2) seedPoints(track, gray);
+        ++it;
+    }
+}
+
+/**
+ * @brief 在人脸框内重新选取特征点。
+ */
+void FaceAnalyzer::seedPoints(Track &track, const cv::Mat &gray)
+{
+    const cv::Rect roi = cv::Rect(track.box) & cv::Rect(0, 0, gray.cols, gray.rows);
+    track.points.clear();
+    if (roi.width < 8 || roi.height < 8) return;
+    cv::goodFeaturesToTrack(gray(roi), track.points, maxPointsPerFace, 0.01, 3);
+    for (cv::Point2f &point : track.points) {
+        point.x += roi.x;
+        point.y += roi.y;
+    }
+}
+
+/**
+ * @brief [跟踪线程] 把小图坐标下的人脸框换算到原始帧坐标并发布。
+ */
+void FaceAnalyzer::publish(const Sample &sample, const std::vector<Track> &tracks)
+{
+    Result result;
+    result.pts = sample.pts;
+    result.frameSize = sample.frameSize;
+    const double sx = static_cast<double>(sample.frameSize.width) / sample.gray.cols;
+    const double sy = static_cast<double>(sample.frameSize.height) / sample.gray.rows;
+    for (const Track &track : tracks) {
+        result.faces.emplace_back(cvRound(track.box.x * sx), cvRound(track.box.y * sy),
+                                  cvRound(track.box.width * sx), cvRound(track.box.height * sy));
+    }
+    QMutexLocker locker(&resultMutex);
+    results.push_back(std::move(result));
+    if (results.size() > maxResults) results.pop_front();
+}
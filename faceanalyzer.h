@@ -0,0 +1,173 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+#ifndef FACEANALYZER_H
+#define FACEANALYZER_H
+
+// =============================================================================
+// File: faceanalyzer.h
+//
+// Description:
+// 该文件定义了 FaceAnalyzer 类，在后台线程中对视频帧做人脸检测与跟踪，
+// 按时间戳发布结果，播放端据此在对应的帧上绘制人脸框。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <dlib/image_processing/frontal_face_detector.h>
+
+/**
+ * @class FaceAnalyzer
+ * @brief 视频人脸分析：低频检测 + 逐帧光流跟踪。
+ *
+ * [流水线]
+ * 1. submitFrame() 在调用者线程（解码器的效果线程）中把帧缩小为灰度小图，放入输入队列。
+ * 2. 跟踪线程 (run) 逐帧用金字塔LK光流把人脸框从上一帧推到当前帧，开销只有几毫秒。
+ * 3. 每隔 N 帧把一张小图交给检测线程，用 dlib HOG 检测器重新检测；
+ *    检测结果带有所检测帧的时间戳，跟踪线程在保留的历史小图上
+ *    从该帧开始重新跟踪到最新一帧（按时间戳重新锚定），再替换当前的人脸框。
+ * 4. 每一帧的结果以时间戳为键发布，resultAt() 取出与显示帧匹配的结果。
+ *
+ * 由于效果线程领先显示若干帧，结果通常在帧显示之前就已经就绪，
+ * 检测本身的耗时不会影响播放帧率。
+ */
+class FaceAnalyzer : public QThread
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @struct Result
+     * @brief 一帧的分析结果。
+     */
+    struct Result {
+        qint64 pts = 0;             // 帧时间戳（毫秒）
+        cv::Size frameSize;         // 分析时帧的尺寸，绘制到其他尺寸的帧上时据此缩放
+        std::vector<cv::Rect> faces; // 帧坐标下的人脸框
+    };
+
+    explicit FaceAnalyzer(QObject *parent = nullptr);
+    ~FaceAnalyzer();
+
+    /**
+     * @brief 启动跟踪线程和检测线程。
+     */
+    void startAnalysis();
+
+    /**
+     * @brief 停止并等待两个线程，清空所有状态。
+     */
+    void stopAnalysis();
+
+    /**
+     * @brief 清空跟踪状态与已发布的结果（跳转后调用）。
+     */
+    void reset();
+
+    /**
+     * @brief 提交一帧待分析的画面（任意线程）。
+     *
+     * 在调用者线程中完成缩小和灰度化，不持有原始帧。输入队列满时丢弃最旧的帧。
+     * @param frame BGR24 帧。
+     * @param pts 帧时间戳（毫秒）。
+     */
+    void submitFrame(const cv::Mat &frame, qint64 pts);
+
+    /**
+     * @brief 取出与时间戳匹配的分析结果（任意线程）。
+     * @param pts 显示帧的时间戳（毫秒）。
+     * @param result [out] 时间戳相同的结果；没有时取之前最近且相差不大的结果。
+     * @return 找到结果时返回true。
+     */
+    bool resultAt(qint64 pts, Result &result) const;
+
+    /**
+     * @brief 设置检测间隔（帧数），间隔之间的帧只做跟踪。
+     */
+    void setDetectionInterval(int frames) { detectionInterval.store(std::max(1, frames), std::memory_order_relaxed); }
+
+protected:
+    // 跟踪线程的主函数
+    void run() override;
+
+private:
+    // 缩小后的灰度帧
+    struct Sample {
+        qint64 pts = 0;
+        cv::Mat gray;
+        cv::Size frameSize; // 原始帧尺寸
+    };
+    // 检测结果（小图坐标）
+    struct Detection {
+        qint64 pts = 0;
+        cv::Size graySize;
+        std::vector<cv::Rect> faces;
+    };
+    // 一个被跟踪的人脸
+    struct Track {
+        cv::Rect2f box;                  // 小图坐标下的人脸框
+        std::vector<cv::Point2f> points; // 框内的特征点
+    };
+
+    // 检测线程的主函数
+    void detectorLoop();
+    // [跟踪线程] 尝试把一帧交给检测线程，检测线程忙时返回false
+    bool requestDetection(const Sample &sample);
+    // [跟踪线程] 用检测结果重建跟踪，并沿历史帧跟踪到最新一帧
+    void anchorDetection(const Detection &detection, const std::deque<Sample> &history, std::vector<Track> &tracks);
+    // [跟踪线程] 发布一帧的结果
+    void publish(const Sample &sample, const std::vector<Track> &tracks);
+
+    // 把所有人脸框从上一帧跟踪到当前帧，丢失的人脸被移除
+    static void trackTracks(std::vector<Track> &tracks, const cv::Mat &prevGray, const cv::Mat &gray);
+    // 在框内重新选取特征点
+    static void seedPoints(Track &track, const cv::Mat &gray);
+
+    // --- 线程间共享状态（由 mutex 保护） ---
+    mutable QMutex mutex;
+    QWaitCondition trackerWake;   // 有新帧、检测结果或停止请求
+    QWaitCondition detectorWake;  // 有检测请求或停止请求
+    std::deque<Sample> inputQueue;
+    Sample detectRequest;
+    bool detectPending = false;   // 有尚未开始的检测请求
+    bool detectBusy = false;      // 检测线程正在检测
+    Detection detectionResult;
+    bool detectionReady = false;
+    bool resetRequested = false;
+    bool stopping = false;
+
+    // --- 已发布的结果 ---
+    mutable QMutex resultMutex;
+    std::deque<Result> results;
+
+    dlib::frontal_face_detector detector; // 只在检测线程中使用
+    QThread *detectorThread = nullptr;
+    std::atomic<int> detectionInterval{10};
+};
+
+#endif // FACEANALYZER_H
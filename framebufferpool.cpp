@@ -0,0 +1,129 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+// =============================================================================
+// File: framebufferpool.cpp
+//
+// Description:
+// FrameBufferPool 类的实现文件。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include "framebufferpool.h"
+
+/**
+ * @brief FrameBufferPool 构造函数。
+ * @param budgetBytes 池中缓冲的总字节数上限。
+ */
+FrameBufferPool::FrameBufferPool(size_t budgetBytes)
+    : budgetBytes(budgetBytes)
+{
+}
+
+/**
+ * @brief 判断缓冲是否空闲。
+ *
+ * cv::Mat 的引用计数在其内部的 UMatData 中，以原子方式增减。
+ * 这里用一次加0的原子操作读取它：值为1说明只剩池自身持有的引用。
+ * 使用者释放 Mat 时的原子递减与这里的原子读取构成先后关系，
+ * 保证使用者对像素的读取一定发生在解码线程再次写入之前。
+ */
+bool FrameBufferPool::isFree(const cv::Mat &buffer)
+{
+    return buffer.u && CV_XADD(&buffer.u->refcount, 0) == 1;
+}
+
+/**
+ * @brief 取出一个指定尺寸和类型的空闲缓冲。
+ * @param rows 行数（高度）。
+ * @param cols 列数（宽度）。
+ * @param type OpenCV 类型，例如 CV_8UC3。
+ * @return 可直接写入的 cv::Mat；限额已满且没有空闲缓冲时返回空 Mat。
+ */
+cv::Mat FrameBufferPool::acquire(int rows, int cols, int type)
+{
+    const size_t needed = static_cast<size_t>(rows) * cols * CV_ELEM_SIZE(type);
+
+    // 1. 查找尺寸和类型都相同的空闲缓冲，顺便统计占用情况
+    int inUse = 0;
+    const cv::Mat *match = nullptr;
+    for (const cv::Mat &buffer : buffers) {
+        if (!isFree(buffer)) { ++inUse; continue; }
+        if (!match && buffer.rows == rows && buffer.cols == cols && buffer.type() == type) match = &buffer;
+    }
+    inUseCount.store(inUse, std::memory_order_relaxed);
+    if (match) return *match; // 只复制 Mat 头，引用计数+1
+
+    // 2. 没有可复用的缓冲：在限额内分配新缓冲，必要时先释放尺寸不符的空闲缓冲
+    if (!releaseFreeBuffersFor(needed)) return cv::Mat();
+
+    buffers.emplace_back(rows, cols, type);
+    allocated.fetch_add(needed, std::memory_order_relaxed);
+    totalCount.store(static_cast<int>(buffers.size()), std::memory_order_relaxed);
+    inUseCount.store(inUse + 1, std::memory_order_relaxed);
+    return buffers.back();
+}
+
+/**
+ * @brief 释放空闲缓冲，直到总字节数加上 needed 不超过限额。
+ * @param needed 即将分配的字节数。
+ * @return 是否可以分配（满足限额，或缓冲个数仍少于 minBuffers）。
+ */
+bool FrameBufferPool::releaseFreeBuffersFor(size_t needed)
+{
+    const size_t limit = budgetBytes.load(std::memory_order_relaxed);
+    for (auto it = buffers.begin(); it != buffers.end() && allocated.load(std::memory_order_relaxed) + needed > limit;) {
+        if (isFree(*it)) {
+            allocated.fetch_sub(it->total() * it->elemSize(), std::memory_order_relaxed);
+            it = buffers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    totalCount.store(static_cast<int>(buffers.size()), std::memory_order_relaxed);
+    return allocated.load(std::memory_order_relaxed) + needed <= limit
+           || static_cast<int>(buffers.size()) < minBuffers;
+}
+
+/**
+ * @brief 修改字节限额。
+ * @param budgetBytes 新的字节上限。
+ */
+void FrameBufferPool::setBudget(size_t budgetBytes)
+{
+    this->budgetBytes.store(budgetBytes, std::memory_order_relaxed);
+}
+
+/**
+ * @brief 释放池中所有空闲缓冲。
+ */
+void FrameBufferPool::trim()
+{
+    for (auto it = buffers.begin(); it != buffers.end();) {
+        if (isFree(*it)) {
+            allocated.fetch_sub(it->total() * it->elemSize(), std::memory_order_relaxed);
+            it = buffers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    totalCount.store(static_cast<int>(buffers.size()), std::memory_order_relaxed);
+}
@@ -0,0 +1,122 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+#ifndef FRAMEBUFFERPOOL_H
+#define FRAMEBUFFERPOOL_H
+
+// =============================================================================
+// File: framebufferpool.h
+//
+// Description:
+// 该文件定义了 FrameBufferPool 类，一个按字节数限额的视频帧缓冲池。
+// 解码线程从池中取出可复用的 cv::Mat 并直接写入像素数据，
+// 播放端用完后缓冲自动回到池中。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include <opencv2/core.hpp>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @class FrameBufferPool
+ * @brief 按字节限额的可复用帧缓冲池。
+ *
+ * [回收机制]
+ * 池中的每个缓冲都是一个普通的 cv::Mat，池自身始终持有一份引用。
+ * acquire() 返回的是同一块内存的另一份 Mat 头（只增加引用计数，不分配内存）。
+ * 当所有使用者都释放了自己的 Mat 头之后，引用计数回到1，缓冲即视为空闲，
+ * 可以被下一次 acquire() 复用。因此使用者无需显式归还缓冲。
+ *
+ * [内存上限]
+ * 池中所有缓冲的总字节数不会超过 budget（至少保留 minBuffers 个缓冲以免死锁）。
+ * 达到上限且没有空闲缓冲时，acquire() 返回空 Mat，调用者应稍后重试。
+ *
+ * [线程约定]
+ * acquire() 和 setBudget() 只能由同一个线程（解码线程）调用；
+ * 统计接口可以由任意线程调用。
+ */
+class FrameBufferPool
+{
+public:
+    /**
+     * @brief 构造函数。
+     * @param budgetBytes 池中缓冲的总字节数上限。
+     */
+    explicit FrameBufferPool(size_t budgetBytes);
+
+    FrameBufferPool(const FrameBufferPool&) = delete;
+    FrameBufferPool& operator=(const FrameBufferPool&) = delete;
+
+    /**
+     * @brief 取出一个指定尺寸和类型的空闲缓冲。
+     *
+     * 优先复用尺寸相同的空闲缓冲；其次在限额内分配新缓冲；
+     * 再次释放尺寸不符的空闲缓冲以腾出限额。
+     * @param rows 行数（高度）。
+     * @param cols 列数（宽度）。
+     * @param type OpenCV 类型，例如 CV_8UC3。
+     * @return 可直接写入的 cv::Mat；限额已满且没有空闲缓冲时返回空 Mat。
+     */
+    cv::Mat acquire(int rows, int cols, int type);
+
+    /**
+     * @brief 修改字节限额。超出新限额的空闲缓冲会在下一次 acquire() 时释放。
+     * @param budgetBytes 新的字节上限。
+     */
+    void setBudget(size_t budgetBytes);
+
+    /**
+     * @brief 释放池中所有空闲缓冲（正在被使用的缓冲不受影响）。
+     */
+    void trim();
+
+    // --- 统计信息（任意线程） ---
+    size_t budget() const { return budgetBytes.load(std::memory_order_relaxed); }
+    size_t allocatedBytes() const { return allocated.load(std::memory_order_relaxed); }
+    int bufferCount() const { return totalCount.load(std::memory_order_relaxed); }
+    // 最近一次 acquire() 时正在被使用的缓冲个数
+    int buffersInUse() const { return inUseCount.load(std::memory_order_relaxed); }
+
+private:
+    /**
+     * @brief 判断缓冲是否空闲（只有池自身持有引用）。
+     */
+    static bool isFree(const cv::Mat &buffer);
+
+    /**
+     * @brief 释放空闲缓冲，直到总字节数加上 needed 不超过限额。
+     * @return 释放后是否满足限额。
+     */
+    bool releaseFreeBuffersFor(size_t needed);
+
+    // 无论限额多小，至少允许的缓冲个数（解码中的一帧、缓冲区中的一帧、正在显示的一帧）
+    static const int minBuffers = 3;
+
+    std::vector<cv::Mat> buffers;          // 池持有的全部缓冲
+    std::atomic<size_t> budgetBytes;       // 字节限额
+    std::atomic<size_t> allocated{0};      // 当前已分配的总字节数
+    std::atomic<int> totalCount{0};        // 当前缓冲总数
+    std::atomic<int> inUseCount{0};        // 正在被使用的缓冲个数
+};
+
+#endif // FRAMEBUFFERPOOL_H
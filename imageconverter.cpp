@@ -74,6 +74,30 @@ QImage ImageConverter::matToQImage(const cv::Mat &mat)
     return QImage();
 }
 
+/**
+ * @brief 不拷贝像素地把 cv::Mat 包装为 QImage。
+ *
+ * 在堆上保存一个 mat 的副本（只增加引用计数），QImage 释放像素时由清理函数删除它。
+ * @param mat 输入的 OpenCV Mat 对象。
+ * @return 共享 mat 像素的 QImage。如果格式不支持，则返回空的 QImage。
+ */
+QImage ImageConverter::wrapMat(const cv::Mat &mat)
+{
+    QImage::Format format;
+    switch (mat.type()) {
+    case CV_8UC1: format = QImage::Format_Grayscale8; break;
+    case CV_8UC3: format = QImage::Format_BGR888; break;
+    case CV_8UC4: format = QImage::Format_ARGB32; break;
+    default: return QImage();
+    }
+    if (mat.empty()) return QImage();
+
+    // 以只读方式构造：任何写操作都会让 QImage 先做深拷贝，不会改动共享的缓冲区
+    auto *holder = new cv::Mat(mat);
+    return QImage(static_cast<const uchar*>(holder->data), holder->cols, holder->rows, static_cast<qsizetype>(holder->step), format,
+                  [](void *info) { delete static_cast<cv::Mat*>(info); }, holder);
+}
+
 /**
  * @brief 将 QImage 转换为 cv::Mat。
  *
@@ -58,6 +58,17 @@ public:
      */
     static QImage matToQImage(const cv::Mat &mat);
 
+    /**
+     * @brief 不拷贝像素地把 cv::Mat 包装为 QImage。
+     *
+     * BGR 直接使用 QImage::Format_BGR888，不做通道交换。返回的 QImage 持有 mat 的一个引用，
+     * 在 QImage 的所有副本释放之前 mat 的缓冲区不会被释放，也不会被帧缓冲池复用；
+     * 调用者在此期间不能再修改 mat 的像素。
+     * @param mat 输入的 OpenCV Mat 对象 (必须是 CV_8UC1, CV_8UC3 或 CV_8UC4 类型)。
+     * @return 共享 mat 像素的 QImage。如果格式不支持，则返回空的 QImage。
+     */
+    static QImage wrapMat(const cv::Mat &mat);
+
     /**
      * @brief 将 QImage 转换为 cv::Mat。
      *
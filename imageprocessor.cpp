@@ -109,12 +109,13 @@ QImage ImageProcessor::blend(const QImage &imageA, const QImage &imageB, double
  * 直接调用 ImageTextureTransferProcessor 的静态方法。
  * @param contentImage 内容图像。
  * @param textureImage 纹理图像。
+ * @param seed 随机种子，种子相同时结果相同。
  * @return 带有新纹理的内容图像。
  */
-QImage ImageProcessor::textureTransfer(const QImage &contentImage, const QImage &textureImage)
+QImage ImageProcessor::textureTransfer(const QImage &contentImage, const QImage &textureImage, quint64 seed)
 {
     // 假设 ImageTextureTransferProcessor::process 存在
-    return ImageTextureTransferProcessor::process(contentImage, textureImage);
+    return ImageTextureTransferProcessor::process(contentImage, textureImage, seed);
 }
 
 /**
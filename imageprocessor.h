@@ -83,9 +83,10 @@ public:
      * @brief 执行纹理迁移。
      * @param contentImage 内容图像。
      * @param textureImage 纹理图像。
+     * @param seed 随机种子，种子相同时结果相同。
      * @return 带有新纹理的内容图像。
      */
-    static QImage textureTransfer(const QImage &contentImage, const QImage &textureImage);
+    static QImage textureTransfer(const QImage &contentImage, const QImage &textureImage, quint64 seed = 0);
 
     /**
      * @brief 应用伽马校正。
@@ -30,10 +30,20 @@
 
 #include "imagetexturetransferdialog.h"
 #include "ui_imagetexturetransferdialog.h"
-#include "imageprocessor.h" // 假设 ImageProcessor 提供了静态的 textureTransfer 方法
 #include <QFileDialog>
 #include <QPushButton>
-#include <QApplication>
+
+/**
+ * @brief 线程的入口点：逐层合成，每完成一层发出一次预览。
+ */
+void TextureTransferThread::run()
+{
+    QImage result = ImageTextureTransferProcessor::process(contentImage, textureImage, options,
+        [this](const QImage &preview, int finishedLevels, int totalLevels) {
+            emit previewReady(preview, finishedLevels, totalLevels);
+        }, &cancelled);
+    emit resultReady(result);
+}
 
 /**
  * @brief ImageTextureTransferDialog 构造函数。
@@ -65,6 +75,13 @@ ImageTextureTransferDialog::ImageTextureTransferDialog(const QPixmap &contentPix
     // --- 4. 进度条设置 ---
     // 初始时隐藏进度条
     ui->progressBar->setVisible(false);
+
+    // --- 5. 质量档位与时间预算 ---
+    // 档位顺序与 ImageTextureTransferProcessor::Quality 一致，默认与原来的参数相同
+    ui->qualityComboBox->addItems({tr("草稿"), tr("标准"), tr("精细")});
+    ui->qualityComboBox->setCurrentIndex(ImageTextureTransferProcessor::Best);
+    connect(ui->qualityComboBox, &QComboBox::activated, this, &ImageTextureTransferDialog::applyTextureTransfer);
+    ui->stopButton->setEnabled(false);
 }
 
 /**
@@ -72,6 +89,7 @@ ImageTextureTransferDialog::ImageTextureTransferDialog(const QPixmap &contentPix
  */
 ImageTextureTransferDialog::~ImageTextureTransferDialog()
 {
+    stopWorker();
     delete ui;
 }
 
@@ -102,32 +120,82 @@ void ImageTextureTransferDialog::on_buttonOpenTexture_clicked()
 }
 
 /**
- * @brief 应用纹理迁移算法并更新UI。
+ * @brief 槽函数：响应“停止”按钮。
  *
- * 这是一个耗时操作。为了防止UI冻结，在调用处理函数前后更新了UI状态，
- * 并使用 QApplication::processEvents() 来强制处理UI事件。
+ * 合成线程在当前这一波块完成后停止，并以已经合成到的结果发出 resultReady。
+ */
+void ImageTextureTransferDialog::on_stopButton_clicked()
+{
+    if (worker) worker->cancel();
+    ui->stopButton->setEnabled(false);
+}
+
+/**
+ * @brief 在后台开始纹理迁移。
+ *
+ * 合成从金字塔最粗的一层开始，每完成一层就显示一次放大的预览，进度条按层推进；
+ * 超出时间预算或点击“停止”时使用已经合成到的结果。
  */
 void ImageTextureTransferDialog::applyTextureTransfer()
 {
     if (contentPixmap.isNull() || texturePixmap.isNull()) return;
+    stopWorker(); // 重新开始时丢弃上一次尚未完成的合成
+
+    ImageTextureTransferProcessor::Options options =
+        ImageTextureTransferProcessor::optionsFor(static_cast<ImageTextureTransferProcessor::Quality>(ui->qualityComboBox->currentIndex()));
+    options.budgetMs = ui->budgetSpinBox->value() * 1000LL;
 
     // --- 准备处理：更新UI以提供反馈 ---
+    resultPixmap = QPixmap();
     ui->labelResult->setText(tr("正在处理中，请稍后！"));
     ui->progressBar->setVisible(true);
-    // 设置为不确定模式（滚动条）
+    // 第一层完成之前为不确定模式（滚动条）
     ui->progressBar->setRange(0, 0);
-    // 强制Qt处理挂起的事件，确保UI（标签文本和进度条）能够立即更新
-    QApplication::processEvents();
+    ui->stopButton->setEnabled(true);
 
-    // --- 执行耗时操作 ---
-    QImage result = ImageProcessor::textureTransfer(contentPixmap.toImage(), texturePixmap.toImage());
+    // --- 在后台线程中合成 ---
+    const int run = ++transferRun;
+    worker = new TextureTransferThread(contentPixmap.toImage(), texturePixmap.toImage(), options, this);
+    connect(worker, &TextureTransferThread::previewReady, this, [this, run](const QImage &preview, int finishedLevels, int totalLevels) {
+        if (run != transferRun) return;
+        showResult(preview);
+        ui->progressBar->setRange(0, totalLevels);
+        ui->progressBar->setValue(finishedLevels);
+    });
+    connect(worker, &TextureTransferThread::resultReady, this, [this, run](const QImage &result) {
+        if (run != transferRun) return;
+        // --- 处理完成：更新UI ---
+        ui->progressBar->setVisible(false);
+        ui->stopButton->setEnabled(false);
+        if (!result.isNull()) {
+            showResult(result);
+        } else {
+            ui->labelResult->setText(tr("处理失败"));
+        }
+    });
+    worker->start();
+}
 
-    // --- 处理完成：更新UI ---
-    ui->progressBar->setVisible(false);
-    if (!result.isNull()) {
-        resultPixmap = QPixmap::fromImage(result);
-        ui->labelResult->setPixmap(resultPixmap.scaled(ui->labelResult->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
-    } else {
-        ui->labelResult->setText(tr("处理失败"));
-    }
+/**
+ * @brief 停止并销毁正在进行的合成。
+ *
+ * 合成线程在当前这一波块完成后就会返回，等待时间很短。
+ */
+void ImageTextureTransferDialog::stopWorker()
+{
+    if (!worker) return;
+    ++transferRun;
+    worker->cancel();
+    worker->wait();
+    delete worker;
+    worker = nullptr;
+}
+
+/**
+ * @brief 显示结果（或预览），并把它作为当前结果。
+ */
+void ImageTextureTransferDialog::showResult(const QImage &image)
+{
+    resultPixmap = QPixmap::fromImage(image);
+    ui->labelResult->setPixmap(resultPixmap.scaled(ui->labelResult->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
 }
@@ -24,8 +24,9 @@
 // File: imagetexturetransferdialog.h
 //
 // Description:
-// 该文件定义了 ImageTextureTransferDialog 类，这是一个用于
-// 图像纹理迁移的对话框。
+// 该文件定义了 ImageTextureTransferDialog 类和一个辅助的 TextureTransferThread 类。
+// ImageTextureTransferDialog 是一个用于图像纹理迁移的对话框，
+// 而 TextureTransferThread 则在后台线程中逐层合成，并随时给出预览。
 //
 // Author: g64
 // Date: 2025-07-25
@@ -33,6 +34,57 @@
 
 #include <QDialog>
 #include <QPixmap>
+#include <QThread>
+#include <atomic>
+#include "imagetexturetransferprocessor.h"
+
+/**
+ * @class TextureTransferThread
+ * @brief 在后台执行纹理迁移的线程类。
+ *
+ * 每合成完一层金字塔发出一次 previewReady，结束时（包括超出时间预算或被 cancel()）
+ * 以已经合成到的结果发出 resultReady。
+ */
+class TextureTransferThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief 构造函数。
+     * @param content 内容图像。
+     * @param texture 纹理图像。
+     * @param options 合成参数（质量档位、时间预算等）。
+     * @param parent 父对象。
+     */
+    TextureTransferThread(const QImage &content, const QImage &texture,
+                          const ImageTextureTransferProcessor::Options &options, QObject *parent = nullptr)
+        : QThread(parent), contentImage(content), textureImage(texture), options(options) {}
+
+    /**
+     * @brief 请求停止（任意线程）。当前这一波块合成完后停止，随后照常发出 resultReady。
+     */
+    void cancel() { cancelled.store(true, std::memory_order_relaxed); }
+
+protected:
+    /**
+     * @brief 线程的入口点。
+     */
+    void run() override;
+
+signals:
+    // 合成完一层：放大到原图尺寸的预览、已完成的层数、总层数
+    void previewReady(const QImage &preview, int finishedLevels, int totalLevels);
+    // 合成结束，image 为最终结果或停止时已经合成到的结果；失败时为空
+    void resultReady(const QImage &image);
+
+private:
+    // --- 成员变量 ---
+    QImage contentImage;
+    QImage textureImage;
+    ImageTextureTransferProcessor::Options options;
+    std::atomic<bool> cancelled{false};
+};
 
 // --- 前置声明 ---
 namespace Ui {
@@ -45,7 +97,8 @@ class imagetexturetransferdialog;
  * @brief 提供图像纹理迁移功能的设置对话框。
  *
  * 该对话框允许用户加载一张纹理图像，并将其纹理应用到
- * 另一张内容图像上，预览并获取最终结果。
+ * 另一张内容图像上，预览并获取最终结果。合成在后台线程中进行，
+ * 每完成一层就更新预览；可以选择质量档位和时间预算，也可以随时停止并使用当前结果。
  */
 class ImageTextureTransferDialog : public QDialog
 {
@@ -76,18 +129,35 @@ private slots:
      */
     void on_buttonOpenTexture_clicked();
 
+    /**
+     * @brief 槽函数：响应“停止”按钮，保留已经合成到的结果。
+     */
+    void on_stopButton_clicked();
+
 private:
     /**
-     * @brief 应用纹理迁移算法并更新预览。
+     * @brief 在后台开始纹理迁移，结果和逐层预览随后显示。
      */
     void applyTextureTransfer();
 
+    /**
+     * @brief 停止并销毁正在进行的合成，丢弃它之后的结果。
+     */
+    void stopWorker();
+
+    /**
+     * @brief 显示结果（或预览），并把它作为当前结果。
+     */
+    void showResult(const QImage &image);
+
     // --- 成员变量 ---
     // [修正] ui指针的类型必须与Ui命名空间中声明的类完全匹配
     Ui::imagetexturetransferdialog *ui;
     QPixmap contentPixmap;
     QPixmap texturePixmap;
     QPixmap resultPixmap;
+    TextureTransferThread *worker = nullptr;
+    int transferRun = 0; // 每次开始合成时加1，旧的合成排队中的信号据此忽略
 };
 
 #endif // IMAGETEXTURETRANSFERDIALOG_H
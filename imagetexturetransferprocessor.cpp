@@ -23,7 +23,7 @@
 // Description:
 // ImageTextureTransferProcessor 类的实现文件。该文件实现了基于Efros和Freeman
 // 的 "Image Quilting" 思想的纹理迁移算法，并结合了图像金字塔、
-// 显著性检测和颜色统计匹配等多种技术。
+// 由粗到细的匹配搜索和颜色统计匹配等多种技术。
 //
 // Author: g64
 // Date: 2025-07-25
@@ -32,11 +32,14 @@
 #include "imagetexturetransferprocessor.h"
 #include "imageconverter.h"
 #include <opencv2/opencv.hpp>
-#include <opencv2/saliency.hpp>
 #include <vector>
 #include <limits>
 #include <QDebug>
+#include <QMutex>
+#include <QElapsedTimer>
 #include <algorithm>
+#include <memory>
+#include <numeric>
 
 // =============================================================================
 // 静态辅助函数 (Static Helper Functions)
@@ -122,134 +125,511 @@ static cv::Mat calculateMinErrorCut(const cv::Mat& overlap_new, const cv::Mat& o
     return mask;
 }
 
+// 粗搜索时块缩小到的最小边长（像素），块更小时不再缩小
+static const int minCoarsePatchSize = 8;
+// 粗搜索选出、逐级细化并最终用原误差比较的候选数
+static const int searchCandidates = 16;
+
+/**
+ * @struct SearchScale
+ * @brief 缩小 2^k 倍后的浮点数据，只用于估计误差、缩小候选范围。
+ */
+struct SearchScale {
+    cv::Mat source_lab;     // 纹理图 (CV_32FC3)
+    cv::Mat source_l;       // 纹理图亮度 (CV_32F)
+    cv::Mat source_grad_l;  // 纹理图亮度梯度 (CV_32F)
+    cv::Mat content_l;      // 内容图亮度 (CV_32F)
+    cv::Mat content_grad_l; // 内容图亮度梯度 (CV_32F)
+};
+
+/**
+ * @struct LevelData
+ * @brief 金字塔某一层的匹配数据，在开始合成这一层之前一次算好，逐块搜索时只读。
+ */
+struct LevelData {
+    cv::Mat content_l;               // 内容图亮度 (CV_8UC1)
+    cv::Mat source_lab;              // 纹理图 (CV_8UC3)
+    cv::Mat source_l;                // 纹理图亮度 (CV_8UC1)
+    cv::Mat source_grad_l;           // 纹理图亮度梯度 (CV_32F)
+    std::vector<SearchScale> scales; // scales[k] 缩小 2^k 倍，最后一级用于全局搜索
+    cv::Size dft_size;               // 全局搜索的 DFT 尺寸
+    cv::Mat spectra[4];              // 最后一级纹理图 L、a、b 和亮度梯度的频谱 (CCS)
+    cv::Mat sq_l;                    // 最后一级亮度平方的积分图 (CV_64F)
+    cv::Mat sq_grad;                 // 最后一级梯度平方的积分图 (CV_64F)
+    cv::Mat sq_lab;                  // 最后一级三通道平方和的积分图 (CV_64F)
+};
+
 /**
- * @brief 使用显著性引导采样和组合误差函数，从源纹理中找到最佳匹配块。
- * @return 返回从源纹理中裁剪出的最佳匹配图像块 (Lab格式)。
+ * @struct MatchWorkspace
+ * @brief 搜索用的临时图像和候选列表，反复复用，逐块搜索不再分配新的缓冲区。
  */
-static cv::Mat findBestMatch(const cv::Mat& target_patch_lab, const cv::Mat& overlap_mask, const cv::Mat& synthesized_region_lab,
-                             const cv::Mat& source_lab, const cv::Mat& source_grad_l, const cv::Mat& source_saliency,
-                             double alpha, double beta, int patch_size)
+struct MatchWorkspace {
+    cv::Mat synth_full;     // 已合成区域 (CV_32FC3)
+    cv::Mat synth;          // 缩小到当前级的已合成区域，L形重叠区以外为0
+    cv::Mat mask;           // 当前级的L形重叠区掩码
+    cv::Mat channel;        // 单通道临时图
+    cv::Mat templ;          // 补零到 DFT 尺寸的模板
+    cv::Mat templ_spectrum; // 模板的频谱
+    cv::Mat product;        // 单个通道的互相关频谱
+    cv::Mat accumulated;    // 各通道互相关频谱之和
+    cv::Mat correlation;    // 互相关
+    cv::Mat total;          // 最后一级每个位置的估计误差
+    cv::Mat target_grad;    // 目标块自身的亮度梯度
+    cv::Mat diff;           // 重叠区的逐像素平方差
+    std::vector<int> order;
+    std::vector<cv::Point> candidates;
+    std::vector<std::pair<double, cv::Point>> scored;
+    std::vector<cv::Point> tolerated;
+};
+
+/**
+ * @struct ScaledPatch
+ * @brief 目标块缩小到某一级后的位置、重叠宽度和各项误差的权重。
+ */
+struct ScaledPatch {
+    cv::Rect rect;
+    int overlap_left = 0;
+    int overlap_top = 0;
+    double lum_weight = 0.0;
+    double grad_weight = 0.0;
+    double overlap_weight = 0.0; // 没有重叠区时为0
+};
+
+static ScaledPatch scalePatch(const SearchScale& scale, int k, const cv::Rect& target_rect,
+                              int overlap_left, int overlap_top, double alpha, double beta)
 {
-    // 使用线程局部变量的随机数生成器，以支持多线程
-    static thread_local cv::RNG rng(cv::getTickCount());
-
-    int y_range = source_lab.rows - patch_size;
-    int x_range = source_lab.cols - patch_size;
-    if (y_range < 0 || x_range < 0) return cv::Mat();
-
-    // 预计算目标块的梯度
-    std::vector<cv::Mat> target_channels;
-    cv::split(target_patch_lab, target_channels);
-    cv::Mat target_grad_l;
-    cv::Sobel(target_channels[0], target_grad_l, CV_32F, 1, 1);
-
-    // 1. 候选块采样
-    int num_candidates = 500;
-    std::vector<cv::Rect> candidate_rects;
-    std::vector<double> candidate_errors;
-
-    // 准备显著性图用于引导采样
-    cv::Mat saliency_prob;
-    cv::normalize(source_saliency, saliency_prob, 1.0, 0.0, cv::NORM_MINMAX, CV_32F);
-    saliency_prob += 0.1; // 避免概率为0
-
-    for (int i = 0; i < num_candidates; ++i) {
-        // 混合采样策略：大部分随机采样，小部分由显著性图引导
-        cv::Point sample_point;
-        cv::minMaxLoc(saliency_prob, nullptr, nullptr, nullptr, &sample_point);
-        int y = rng.uniform(0, y_range);
-        int x = rng.uniform(0, x_range);
-        if (rng.uniform(0, 10) > 5) { // 有一定概率在最显著点附近采样
-            y = std::min(y_range - 1, std::max(0, sample_point.y - patch_size / 2));
-            x = std::min(x_range - 1, std::max(0, sample_point.x - patch_size / 2));
+    ScaledPatch patch;
+    // 边缘处很窄的块缩小后至少保留一个像素
+    const int x = std::min(target_rect.x >> k, scale.content_l.cols - 1);
+    const int y = std::min(target_rect.y >> k, scale.content_l.rows - 1);
+    patch.rect = cv::Rect(x, y, std::max(1, std::min(target_rect.width >> k, scale.content_l.cols - x)),
+                          std::max(1, std::min(target_rect.height >> k, scale.content_l.rows - y)));
+    // 重叠宽度向上取整，缩小后仍至少保留一个像素
+    patch.overlap_left = std::min(patch.rect.width, (overlap_left + (1 << k) - 1) >> k);
+    patch.overlap_top = std::min(patch.rect.height, (overlap_top + (1 << k) - 1) >> k);
+
+    const double area = patch.rect.area();
+    const double overlap_count = static_cast<double>(patch.overlap_left) * patch.rect.height
+                                 + static_cast<double>(patch.overlap_top) * patch.rect.width
+                                 - static_cast<double>(patch.overlap_left) * patch.overlap_top;
+    patch.lum_weight = (1.0 - alpha) * (1.0 - beta) / area;
+    patch.grad_weight = (1.0 - alpha) * beta / area;
+    patch.overlap_weight = overlap_count > 0 ? alpha / overlap_count : 0.0;
+    return patch;
+}
+
+/**
+ * @brief 把已合成区域缩小到当前级，并生成对应的L形重叠区掩码。
+ */
+static void prepareOverlap(const ScaledPatch& patch, int k, MatchWorkspace& ws)
+{
+    if (k == 0) ws.synth_full.copyTo(ws.synth);
+    else cv::resize(ws.synth_full, ws.synth, patch.rect.size(), 0, 0, cv::INTER_AREA);
+    const cv::Rect inner(patch.overlap_left, patch.overlap_top,
+                         patch.rect.width - patch.overlap_left, patch.rect.height - patch.overlap_top);
+    ws.mask.create(patch.rect.size(), CV_8UC1);
+    ws.mask.setTo(255);
+    if (!inner.empty()) {
+        ws.synth(inner).setTo(cv::Scalar::all(0));
+        ws.mask(inner).setTo(0);
+    }
+}
+
+/**
+ * @brief 在最后一级上估计每个位置的误差，选出互不相邻的 searchCandidates 个候选。
+ *
+ * 误差是各项平方差按原权重的加权和，展开为 ΣI² − 2ΣI·T + ΣT²：ΣI² 由积分图得到，
+ * ΣT² 对所有位置相同可以省去，互相关的各通道模板先乘上权重，在频域相乘累加后只做一次逆变换。
+ */
+static void searchCoarsest(const LevelData& level, const ScaledPatch& patch, MatchWorkspace& ws)
+{
+    const SearchScale& scale = level.scales.back();
+    const int w = patch.rect.width;
+    const int h = patch.rect.height;
+    const int valid_w = scale.source_l.cols - w + 1;
+    const int valid_h = scale.source_l.rows - h + 1;
+    const bool has_overlap = patch.overlap_weight > 0;
+
+    // 1. 互相关：亮度的内容项与重叠项合并为一个模板，a、b 通道只有重叠项
+    bool first = true;
+    for (int c = 0; c < 4; ++c) {
+        if (!has_overlap && (c == 1 || c == 2)) continue;
+        ws.templ.create(level.dft_size, CV_32F);
+        ws.templ.setTo(0);
+        cv::Mat roi = ws.templ(cv::Rect(0, 0, w, h));
+        if (c == 3) {
+            scale.content_grad_l(patch.rect).convertTo(roi, CV_32F, patch.grad_weight);
+        } else {
+            cv::extractChannel(ws.synth, ws.channel, c);
+            ws.channel.convertTo(roi, CV_32F, patch.overlap_weight);
+            if (c == 0) cv::scaleAdd(scale.content_l(patch.rect), patch.lum_weight, roi, roi);
+        }
+        cv::dft(ws.templ, ws.templ_spectrum, 0, h);
+        cv::mulSpectrums(level.spectra[c], ws.templ_spectrum, first ? ws.accumulated : ws.product, 0, true);
+        if (!first) ws.accumulated += ws.product;
+        first = false;
+    }
+    cv::dft(ws.accumulated, ws.correlation, cv::DFT_INVERSE | cv::DFT_REAL_OUTPUT | cv::DFT_SCALE, valid_h);
+
+    // 2. 每个位置的估计误差
+    auto box = [](const cv::Mat& sum, int x, int y, int bw, int bh) {
+        return sum.at<double>(y + bh, x + bw) - sum.at<double>(y, x + bw)
+               - sum.at<double>(y + bh, x) + sum.at<double>(y, x);
+    };
+    ws.total.create(valid_h, valid_w, CV_32F);
+    for (int y = 0; y < valid_h; ++y) {
+        const float* corr = ws.correlation.ptr<float>(y);
+        float* row = ws.total.ptr<float>(y);
+        for (int x = 0; x < valid_w; ++x) {
+            double error = patch.lum_weight * box(level.sq_l, x, y, w, h)
+                           + patch.grad_weight * box(level.sq_grad, x, y, w, h) - 2.0 * corr[x];
+            if (has_overlap) {
+                error += patch.overlap_weight * (box(level.sq_lab, x, y, patch.overlap_left, h)
+                                                 + box(level.sq_lab, x, y, w, patch.overlap_top)
+                                                 - box(level.sq_lab, x, y, patch.overlap_left, patch.overlap_top));
+            }
+            row[x] = static_cast<float>(error);
         }
+    }
+
+    // 3. 从误差最小的一批位置中依次选取，与已选候选相邻的跳过，避免候选挤在同一处
+    const int count = valid_w * valid_h;
+    const int pool = std::min(count, 8 * searchCandidates);
+    const float* errors = ws.total.ptr<float>();
+    auto less = [errors](int a, int b) { return errors[a] < errors[b]; };
+    ws.order.resize(count);
+    std::iota(ws.order.begin(), ws.order.end(), 0);
+    std::nth_element(ws.order.begin(), ws.order.begin() + pool - 1, ws.order.end(), less);
+    std::sort(ws.order.begin(), ws.order.begin() + pool, less);
+
+    ws.candidates.clear();
+    for (int i = 0; i < pool && (int)ws.candidates.size() < searchCandidates; ++i) {
+        const cv::Point point(ws.order[i] % valid_w, ws.order[i] / valid_w);
+        const bool separate = std::all_of(ws.candidates.begin(), ws.candidates.end(), [&point](const cv::Point& c) {
+            return std::abs(c.x - point.x) > 1 || std::abs(c.y - point.y) > 1;
+        });
+        if (separate) ws.candidates.push_back(point);
+    }
+}
 
-        cv::Rect source_rect(x, y, patch_size, patch_size);
-        cv::Rect crop_rect(0, 0, target_patch_lab.cols, target_patch_lab.rows);
-
-        // 2. 计算误差
-        // a. 边界误差 (Boundary Error): 候选块与已合成区域在重叠部分的SSD(Sum of Squared Differences)
-        double boundary_error = 0;
-        if (cv::countNonZero(overlap_mask) > 0) {
-            cv::Mat source_patch_lab_cropped = source_lab(source_rect)(crop_rect);
-            cv::Mat diff_boundary;
-            cv::absdiff(source_patch_lab_cropped, synthesized_region_lab, diff_boundary);
-            cv::multiply(diff_boundary, diff_boundary, diff_boundary); // 平方
-            std::vector<cv::Mat> diff_channels;
-            cv::split(diff_boundary, diff_channels);
-            // 应用重叠掩码
-            diff_channels[0] = diff_channels[0].mul(overlap_mask, 1.0 / 255.0);
-            diff_channels[1] = diff_channels[1].mul(overlap_mask, 1.0 / 255.0);
-            diff_channels[2] = diff_channels[2].mul(overlap_mask, 1.0 / 255.0);
-            cv::Scalar ssd_boundary = cv::sum(diff_channels[0]) + cv::sum(diff_channels[1]) + cv::sum(diff_channels[2]);
-            boundary_error = ssd_boundary[0] / (cv::countNonZero(overlap_mask) + 1e-6);
+/**
+ * @brief 把候选放大到下一级：每个候选对应 2×2 个位置，按估计误差保留同样数量的最佳位置。
+ */
+static void refineCandidates(const SearchScale& scale, const ScaledPatch& patch, MatchWorkspace& ws)
+{
+    const int max_x = scale.source_l.cols - patch.rect.width;
+    const int max_y = scale.source_l.rows - patch.rect.height;
+
+    ws.scored.clear();
+    for (const cv::Point& c : ws.candidates) {
+        for (int dy = 0; dy <= 1; ++dy) {
+            for (int dx = 0; dx <= 1; ++dx) {
+                const cv::Point child(std::min(2 * c.x + dx, max_x), std::min(2 * c.y + dy, max_y));
+                const bool seen = std::any_of(ws.scored.begin(), ws.scored.end(),
+                                              [&child](const std::pair<double, cv::Point>& s) { return s.second == child; });
+                if (!seen) ws.scored.emplace_back(0.0, child);
+            }
         }
+    }
+
+    const cv::Mat content_l = scale.content_l(patch.rect);
+    const cv::Mat content_grad_l = scale.content_grad_l(patch.rect);
+    for (auto& s : ws.scored) {
+        const cv::Rect r(s.second, patch.rect.size());
+        double error = patch.lum_weight * cv::norm(scale.source_l(r), content_l, cv::NORM_L2SQR)
+                       + patch.grad_weight * cv::norm(scale.source_grad_l(r), content_grad_l, cv::NORM_L2SQR);
+        if (patch.overlap_weight > 0) error += patch.overlap_weight * cv::norm(scale.source_lab(r), ws.synth, cv::NORM_L2SQR, ws.mask);
+        s.first = error;
+    }
+    const size_t keep = std::min(ws.scored.size(), ws.candidates.size());
+    std::partial_sort(ws.scored.begin(), ws.scored.begin() + keep, ws.scored.end(),
+                      [](const std::pair<double, cv::Point>& a, const std::pair<double, cv::Point>& b) { return a.first < b.first; });
+    ws.candidates.clear();
+    for (size_t i = 0; i < keep; ++i) ws.candidates.push_back(ws.scored[i].second);
+}
 
-        // b. 内容误差 (Content Error): 候选块与目标内容块在颜色和梯度上的差异
-        cv::Mat source_patch_lab_cropped = source_lab(source_rect)(crop_rect);
-        std::vector<cv::Mat> source_channels;
-        cv::split(source_patch_lab_cropped, source_channels);
-        cv::Mat diff_lum;
-        cv::absdiff(source_channels[0], target_channels[0], diff_lum); // 亮度差异
-        diff_lum.convertTo(diff_lum, CV_32F);
-        cv::multiply(diff_lum, diff_lum, diff_lum);
-        double lum_error = cv::mean(diff_lum)[0];
-
-        cv::Mat source_grad_l_cropped = source_grad_l(source_rect)(crop_rect);
-        cv::Mat diff_grad;
-        cv::absdiff(source_grad_l_cropped, target_grad_l, diff_grad); // 梯度差异
-        double grad_error = cv::mean(diff_grad)[0];
-
-        // 组合内容误差
-        double content_error = (1.0 - beta) * lum_error + beta * grad_error;
-
-        // c. 总误差 (Total Error): 边界误差和内容误差的加权和
-        double total_error = alpha * boundary_error + (1.0 - alpha) * content_error;
-
-        candidate_rects.push_back(source_rect);
-        candidate_errors.push_back(total_error);
+/**
+ * @brief 在源纹理中搜索与目标块最匹配的块。
+ *
+ * 由粗到细：先在缩小的纹理图上用 DFT 一次估计所有位置的平方差误差，选出互不相邻的几个候选，
+ * 再逐级放大、只在候选附近细化，最后用原来的误差逐个比较剩下的候选：
+ * 重叠区的SSD（按重叠像素数平均）与内容误差加权求和，内容误差由亮度的均方差和
+ * 目标块自身梯度与纹理梯度之差的绝对值均值组成。
+ *
+ * @param level 当前层的匹配数据。
+ * @param target_rect 目标块在内容图中的位置。
+ * @param synthesized_region_lab 已合成图像在目标块位置的区域。
+ * @param overlap_left 左侧重叠带的宽度，0 表示没有。
+ * @param overlap_top 上方重叠带的高度，0 表示没有。
+ * @return 最佳匹配块在源纹理中的位置，纹理图放不下目标块时返回空矩形。
+ */
+static cv::Rect findBestMatch(const LevelData& level, const cv::Rect& target_rect, const cv::Mat& synthesized_region_lab,
+                              int overlap_left, int overlap_top, double alpha, double beta, cv::RNG& rng, MatchWorkspace& ws)
+{
+    const int w = target_rect.width;
+    const int h = target_rect.height;
+    if (level.source_lab.cols < w || level.source_lab.rows < h) return cv::Rect();
+    synthesized_region_lab.convertTo(ws.synth_full, CV_32F);
+
+    // 1. 在最后一级上全局搜索
+    const int coarsest = (int)level.scales.size() - 1;
+    ScaledPatch patch = scalePatch(level.scales[coarsest], coarsest, target_rect, overlap_left, overlap_top, alpha, beta);
+    prepareOverlap(patch, coarsest, ws);
+    searchCoarsest(level, patch, ws);
+
+    // 2. 逐级细化到原尺寸
+    for (int k = coarsest - 1; k >= 0; --k) {
+        patch = scalePatch(level.scales[k], k, target_rect, overlap_left, overlap_top, alpha, beta);
+        prepareOverlap(patch, k, ws);
+        refineCandidates(level.scales[k], patch, ws);
     }
 
-    // 3. 选择最佳块
-    if (candidate_errors.empty()) return cv::Mat();
-    double min_error = *std::min_element(candidate_errors.begin(), candidate_errors.end());
+    // 3. 用原来的误差比较剩下的候选（此时 ws.mask 为原尺寸的重叠区掩码）
+    const double area = static_cast<double>(w) * h;
+    const bool has_overlap = overlap_left > 0 || overlap_top > 0;
+    const cv::Mat content_l = level.content_l(target_rect);
+    cv::Sobel(content_l, ws.target_grad, CV_32F, 1, 1, 3, 1, 0, cv::BORDER_REFLECT_101 | cv::BORDER_ISOLATED);
+    ws.scored.clear();
+    double min_error = std::numeric_limits<double>::max();
+    for (const cv::Point& c : ws.candidates) {
+        const cv::Rect r(c, target_rect.size());
+        double boundary_error = 0.0;
+        if (has_overlap) {
+            cv::absdiff(level.source_lab(r), synthesized_region_lab, ws.diff);
+            cv::multiply(ws.diff, ws.diff, ws.diff); // 与原来一样按8位饱和
+            const cv::Scalar mean = cv::mean(ws.diff, ws.mask);
+            boundary_error = mean[0] + mean[1] + mean[2];
+        }
+        const double lum_error = cv::norm(level.source_l(r), content_l, cv::NORM_L2SQR) / area;
+        const double grad_error = cv::norm(level.source_grad_l(r), ws.target_grad, cv::NORM_L1) / area;
+        const double error = alpha * boundary_error + (1.0 - alpha) * ((1.0 - beta) * lum_error + beta * grad_error);
+        ws.scored.emplace_back(error, c);
+        min_error = std::min(min_error, error);
+    }
 
     // 为了增加随机性，不总是选择误差最小的，而是在一个容忍度范围内随机选择一个
-    std::vector<cv::Rect> tolerated_candidates;
-    double tolerance = 1.2;
-    for (size_t i = 0; i < candidate_errors.size(); ++i) {
-        if (candidate_errors[i] <= min_error * tolerance) {
-            tolerated_candidates.push_back(candidate_rects[i]);
+    ws.tolerated.clear();
+    for (const auto& s : ws.scored) {
+        if (s.first <= min_error * 1.2) ws.tolerated.push_back(s.second);
+    }
+    const cv::Point best = ws.tolerated[rng.uniform(0, (int)ws.tolerated.size())];
+    return cv::Rect(best.x, best.y, w, h);
+}
+
+/**
+ * @class WorkspacePool
+ * @brief 并行合成时各线程轮流使用的 MatchWorkspace，用完放回，误差图在整个合成过程中复用。
+ */
+class WorkspacePool
+{
+public:
+    std::unique_ptr<MatchWorkspace> acquire()
+    {
+        QMutexLocker locker(&mutex);
+        if (idle.empty()) return std::make_unique<MatchWorkspace>();
+        std::unique_ptr<MatchWorkspace> ws = std::move(idle.back());
+        idle.pop_back();
+        return ws;
+    }
+
+    void release(std::unique_ptr<MatchWorkspace> ws)
+    {
+        QMutexLocker locker(&mutex);
+        idle.push_back(std::move(ws));
+    }
+
+private:
+    QMutex mutex;
+    std::vector<std::unique_ptr<MatchWorkspace>> idle;
+};
+
+/**
+ * @brief 由种子、层号和块的网格坐标得到该块的随机数种子 (splitmix64)。
+ *
+ * 每个块有自己的随机数序列，结果与块由哪个线程、以什么顺序处理无关。
+ */
+static quint64 patchSeed(quint64 seed, int level, int row, int col)
+{
+    quint64 z = seed + 0x9E3779B97F4A7C15ull * (1 + ((quint64)level << 40) + ((quint64)row << 20) + (quint64)col);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    return z ? z : 1; // cv::RNG 把0当作默认种子
+}
+
+/**
+ * @brief 合成一个块：找到最佳匹配块，沿最小误差边界切割后拼接到结果图上。
+ * @param rect 块在结果图中的位置。
+ * @param overlap 与左侧、上方已合成块的重叠宽度。
+ */
+static void synthesizePatch(const LevelData& level, cv::Mat& result_lab, const cv::Rect& rect, int overlap,
+                            double alpha, double beta, cv::RNG& rng, MatchWorkspace& ws)
+{
+    const int w = rect.width;
+    const int h = rect.height;
+    cv::Mat synthesized_region = result_lab(rect);
+
+    // 找到最佳匹配块（重叠区为左侧和上方已合成的部分）
+    const int overlap_left = rect.x > 0 ? std::min(overlap, w) : 0;
+    const int overlap_top = rect.y > 0 ? std::min(overlap, h) : 0;
+    cv::Rect match_rect = findBestMatch(level, rect, synthesized_region, overlap_left, overlap_top, alpha, beta, rng, ws);
+    if (match_rect.empty()) return;
+    cv::Mat best_match = level.source_lab(match_rect);
+
+    // 最小误差边界切割与融合
+    cv::Mat final_mask = cv::Mat(h, w, CV_8UC1, cv::Scalar(255));
+    if (overlap_left > 0) { // 处理左侧重叠
+        cv::Rect band(0, 0, overlap_left, h);
+        cv::Mat cut_mask = calculateMinErrorCut(best_match(band), synthesized_region(band), true);
+        cut_mask.copyTo(final_mask(band));
+    }
+    if (overlap_top > 0) { // 处理上方重叠
+        cv::Rect band(0, 0, w, overlap_top);
+        cv::Mat cut_mask = calculateMinErrorCut(best_match(band), synthesized_region(band), false);
+        cv::bitwise_and(final_mask(band), cut_mask, final_mask(band));
+    }
+
+    // 将最佳块通过计算出的边界掩码拼接到结果图上
+    best_match.copyTo(synthesized_region, final_mask);
+}
+
+/**
+ * @brief 准备金字塔某一层的匹配数据：原尺寸的亮度和梯度，逐级缩小的搜索数据，以及最后一级的频谱和积分图。
+ *
+ * 块逐级缩小到不小于 minCoarsePatchSize，且缩小后的纹理图仍放得下缩小后的块。
+ */
+static LevelData prepareLevel(const cv::Mat& content_lab, const cv::Mat& texture_lab, int patch_size)
+{
+    LevelData level;
+    level.source_lab = texture_lab;
+    cv::extractChannel(content_lab, level.content_l, 0);
+    cv::extractChannel(texture_lab, level.source_l, 0);
+    // 纹理梯度在整幅图上计算一次，块边缘的梯度也能用到块外的真实像素
+    cv::Sobel(level.source_l, level.source_grad_l, CV_32F, 1, 1);
+
+    int depth = 0;
+    while ((patch_size >> (depth + 1)) >= minCoarsePatchSize
+           && (texture_lab.cols >> (depth + 1)) > (patch_size >> (depth + 1))
+           && (texture_lab.rows >> (depth + 1)) > (patch_size >> (depth + 1))) {
+        ++depth;
+    }
+
+    cv::Mat source, content;
+    texture_lab.convertTo(source, CV_32F);
+    level.content_l.convertTo(content, CV_32F);
+    for (int k = 0; k <= depth; ++k) {
+        if (k > 0) {
+            cv::Mat smaller_source, smaller_content;
+            cv::resize(source, smaller_source, cv::Size(source.cols / 2, source.rows / 2), 0, 0, cv::INTER_AREA);
+            cv::resize(content, smaller_content, cv::Size(content.cols / 2, content.rows / 2), 0, 0, cv::INTER_AREA);
+            source = smaller_source;
+            content = smaller_content;
         }
+        SearchScale scale;
+        scale.source_lab = source;
+        cv::extractChannel(source, scale.source_l, 0);
+        cv::Sobel(scale.source_l, scale.source_grad_l, CV_32F, 1, 1);
+        scale.content_l = content;
+        cv::Sobel(content, scale.content_grad_l, CV_32F, 1, 1);
+        level.scales.push_back(scale);
+    }
+
+    // 最后一级：补零到 DFT 尺寸后的频谱，以及平方项的积分图
+    const SearchScale& coarsest = level.scales.back();
+    level.dft_size = cv::Size(cv::getOptimalDFTSize(coarsest.source_l.cols), cv::getOptimalDFTSize(coarsest.source_l.rows));
+    std::vector<cv::Mat> planes;
+    cv::split(coarsest.source_lab, planes);
+    planes.push_back(coarsest.source_grad_l);
+    for (int c = 0; c < 4; ++c) {
+        cv::Mat padded = cv::Mat::zeros(level.dft_size, CV_32F);
+        planes[c].copyTo(padded(cv::Rect(0, 0, planes[c].cols, planes[c].rows)));
+        cv::dft(padded, level.spectra[c], 0, planes[c].rows);
+    }
+    cv::Mat squared, squared_sum;
+    cv::multiply(coarsest.source_l, coarsest.source_l, squared);
+    cv::integral(squared, level.sq_l, CV_64F);
+    cv::multiply(coarsest.source_grad_l, coarsest.source_grad_l, squared);
+    cv::integral(squared, level.sq_grad, CV_64F);
+    cv::multiply(coarsest.source_lab, coarsest.source_lab, squared);
+    cv::transform(squared, squared_sum, cv::Matx13f(1.0f, 1.0f, 1.0f));
+    cv::integral(squared_sum, level.sq_lab, CV_64F);
+    return level;
+}
+
+/**
+ * @brief 由合成结果得到最终图像：放大到原图尺寸，只取合成结果的亮度，颜色沿用原图。
+ *
+ * 为了保留原始内容的颜色，只使用合成结果的L通道（亮度/纹理），
+ * 而使用原始内容的a和b通道（颜色）。提前结束或只合成到较粗的层时，亮度先放大到原图尺寸。
+ */
+static QImage composeResult(const cv::Mat& result_lab, const cv::Mat& content_lab)
+{
+    std::vector<cv::Mat> final_channels;
+    cv::split(content_lab, final_channels);
+    cv::extractChannel(result_lab, final_channels[0], 0);
+    if (result_lab.size() != content_lab.size()) {
+        cv::resize(final_channels[0], final_channels[0], content_lab.size(), 0, 0, cv::INTER_LINEAR);
     }
+    cv::Mat final_lab, result_bgr;
+    cv::merge(final_channels, final_lab);
+    cv::cvtColor(final_lab, result_bgr, cv::COLOR_Lab2BGR);
+    return ImageConverter::matToQImage(result_bgr);
+}
 
-    if (tolerated_candidates.empty()) { // 如果没有在容忍度内的，就选最小的那个
-        auto min_it = std::min_element(candidate_errors.begin(), candidate_errors.end());
-        size_t min_idx = std::distance(candidate_errors.begin(), min_it);
-        return source_lab(candidate_rects[min_idx]).clone();
+/**
+ * @brief 各质量档位对应的参数。
+ */
+ImageTextureTransferProcessor::Options ImageTextureTransferProcessor::optionsFor(Quality quality)
+{
+    Options options;
+    switch (quality) {
+    case Draft: // 少一层金字塔，最细的一层不合成，块更大
+        options.levels = 3;
+        options.finestLevel = 1;
+        options.patchDivisor = 6;
+        break;
+    case Balanced:
+        options.patchDivisor = 6;
+        break;
+    case Best:
+        break;
     }
+    return options;
+}
 
-    // 从容忍度范围内的候选中随机选择一个
-    int random_idx = rng.uniform(0, (int)tolerated_candidates.size());
-    return source_lab(tolerated_candidates[random_idx]).clone();
+/**
+ * @brief 以默认参数执行纹理迁移。
+ */
+QImage ImageTextureTransferProcessor::process(const QImage &contentImage, const QImage &textureImage, quint64 seed)
+{
+    Options options = optionsFor(Best);
+    options.seed = seed;
+    return process(contentImage, textureImage, options);
 }
 
 /**
- * @brief 对外提供的唯一处理接口，执行纹理迁移。
+ * @brief 执行纹理迁移（随时可停止）。
  * @param contentImage 内容图片 (QImage)。
  * @param textureImage 纹理/风格图片 (QImage)。
- * @return 迁移了纹理的新 QImage。
+ * @param options 合成参数。
+ * @param onPreview 每合成完一层金字塔调用一次（在调用线程中），传入放大到原图尺寸的预览。
+ * @param cancelled 不为空且变为true时尽快停止。
+ * @return 迁移了纹理的新 QImage；超出时间预算或被取消时为已经合成到的结果。
  */
-QImage ImageTextureTransferProcessor::process(const QImage &contentImage, const QImage &textureImage)
+QImage ImageTextureTransferProcessor::process(const QImage &contentImage, const QImage &textureImage, const Options &options,
+                                              const PreviewCallback &onPreview, const std::atomic<bool> *cancelled)
 {
     try {
         if (contentImage.isNull() || textureImage.isNull()) return QImage();
+        QElapsedTimer elapsed;
+        elapsed.start();
 
         // --- 1. 预处理：构建图像金字塔和辅助数据 ---
         cv::Mat content_mat = ImageConverter::qImageToMat(contentImage);
         cv::Mat texture_mat = ImageConverter::qImageToMat(textureImage);
 
-        int num_levels = 4; // 金字塔层数
+        const int num_levels = std::max(0, options.levels); // 金字塔层数
+        const int finest_level = std::clamp(options.finestLevel, 0, num_levels);
         std::vector<cv::Mat> content_pyramid_lab, texture_pyramid_lab;
         cv::Mat content_lab, texture_lab;
 
@@ -261,33 +641,20 @@ QImage ImageTextureTransferProcessor::process(const QImage &contentImage, const
         cv::buildPyramid(content_lab, content_pyramid_lab, num_levels);
         cv::buildPyramid(texture_lab, texture_pyramid_lab, num_levels);
 
-        // 为纹理金字塔的每一层预计算梯度图和显著性图
-        std::vector<cv::Mat> texture_pyramid_grad_l;
-        std::vector<cv::Mat> texture_pyramid_saliency;
-        cv::Ptr<cv::saliency::Saliency> saliency = cv::saliency::StaticSaliencySpectralResidual::create();
-
-        for (const auto& tex_level_lab : texture_pyramid_lab) {
-            std::vector<cv::Mat> tex_channels;
-            cv::split(tex_level_lab, tex_channels);
-            cv::Mat grad_l;
-            cv::Sobel(tex_channels[0], grad_l, CV_32F, 1, 1);
-            texture_pyramid_grad_l.push_back(grad_l);
-
-            cv::Mat saliency_map;
-            cv::Mat tex_level_bgr;
-            cv::cvtColor(tex_level_lab, tex_level_bgr, cv::COLOR_Lab2BGR);
-            saliency->computeSaliency(tex_level_bgr, saliency_map);
-            texture_pyramid_saliency.push_back(saliency_map);
-        }
+        WorkspacePool workspaces;
+        // 超出时间预算或被取消。最粗的一层很小且总会完成，结果里不会留下未合成的空白
+        auto shouldStop = [&]() {
+            if (cancelled && cancelled->load(std::memory_order_relaxed)) return true;
+            return options.budgetMs > 0 && elapsed.elapsed() >= options.budgetMs;
+        };
 
         // --- 2. 从粗到细，逐层合成 ---
         cv::Mat result_lab;
-        for (int level = num_levels; level >= 0; --level) {
+        bool stopped = false;
+        for (int level = num_levels; level >= finest_level && !stopped; --level) {
             qDebug() << "--- Processing Pyramid Level" << level << "---";
             const cv::Mat& current_content_lab = content_pyramid_lab[level];
             const cv::Mat& current_texture_lab = texture_pyramid_lab[level];
-            const cv::Mat& current_texture_grad_l = texture_pyramid_grad_l[level];
-            const cv::Mat& current_texture_saliency = texture_pyramid_saliency[level];
 
             if (level == num_levels) { // 最粗糙的一层，从零开始合成
                 result_lab = cv::Mat::zeros(current_content_lab.size(), current_content_lab.type());
@@ -296,70 +663,60 @@ QImage ImageTextureTransferProcessor::process(const QImage &contentImage, const
             }
 
             // --- 3. 基于块的合成 (Patch-based Synthesis) ---
-            int patch_size = std::max(5, std::min(current_content_lab.rows, current_content_lab.cols) / 8);
+            int patch_size = std::max(5, std::min(current_content_lab.rows, current_content_lab.cols) / std::max(1, options.patchDivisor));
             if (patch_size % 2 == 0) patch_size++; // 确保patch大小为奇数
             if (patch_size >= current_texture_lab.rows || patch_size >= current_texture_lab.cols) continue;
             int overlap = std::max(1, patch_size / 6);
+            const LevelData level_data = prepareLevel(current_content_lab, current_texture_lab, patch_size);
 
             // alpha控制边界误差和内容误差的权重，在粗糙层更注重内容，在精细层更注重边界平滑
-            double alpha = 0.1 + 0.8 * (level / (double)num_levels);
+            double alpha = 0.1 + 0.8 * (level / (double)std::max(1, num_levels));
             double beta = 0.7; // beta控制亮度误差和梯度误差的权重
 
-            // 逐块扫描并合成图像
-            for (int y = 0; y < current_content_lab.rows; y += patch_size - overlap) {
-                for (int x = 0; x < current_content_lab.cols; x += patch_size - overlap) {
-                    int w = std::min(patch_size, current_content_lab.cols - x);
-                    int h = std::min(patch_size, current_content_lab.rows - y);
-                    if (w <= overlap || h <= overlap) continue;
-
-                    cv::Rect current_rect(x, y, w, h);
-                    cv::Mat target_patch = current_content_lab(current_rect);
-                    cv::Mat synthesized_region = result_lab(current_rect);
-
-                    // 创建重叠区域的掩码
-                    cv::Mat overlap_mask = cv::Mat::zeros(h, w, CV_8UC1);
-                    if (x > 0) overlap_mask(cv::Rect(0, 0, std::min(overlap, w), h)).setTo(255);
-                    if (y > 0) overlap_mask(cv::Rect(0, 0, w, std::min(overlap, h))).setTo(255);
-
-                    // 找到最佳匹配块
-                    cv::Mat best_match_full = findBestMatch(target_patch, overlap_mask, synthesized_region, current_texture_lab, current_texture_grad_l, current_texture_saliency, alpha, beta, patch_size);
-                    if (best_match_full.empty()) continue;
-                    cv::Mat best_match = best_match_full(cv::Rect(0, 0, w, h));
-
-                    // --- 4. 最小误差边界切割与融合 ---
-                    cv::Mat final_mask = cv::Mat(h, w, CV_8UC1, cv::Scalar(255));
-                    if (x > 0) { // 处理左侧重叠
-                        cv::Rect rect(0, 0, std::min(overlap, w), h);
-                        cv::Mat cut_mask = calculateMinErrorCut(best_match(rect), synthesized_region(rect), true);
-                        cut_mask.copyTo(final_mask(rect));
-                    }
-                    if (y > 0) { // 处理上方重叠
-                        cv::Rect rect(0, 0, w, std::min(overlap, h));
-                        cv::Mat cut_mask = calculateMinErrorCut(best_match(rect), synthesized_region(rect), false);
-                        cv::bitwise_and(final_mask(rect), cut_mask, final_mask(rect));
+            // 块的网格：步长为 patch_size - overlap，过窄的最后一列/行跳过
+            const int step = patch_size - overlap;
+            std::vector<int> xs, ys;
+            for (int x = 0; x < current_content_lab.cols && current_content_lab.cols - x > overlap; x += step) xs.push_back(x);
+            for (int y = 0; y < current_content_lab.rows && current_content_lab.rows - y > overlap; y += step) ys.push_back(y);
+            const int grid_rows = (int)ys.size();
+            const int grid_cols = (int)xs.size();
+
+            // --- 4. 波前并行 ---
+            // 块 (i, j) 要读取左侧 (i, j-1)、上方 (i-1, j)、左上 (i-1, j-1) 和右上 (i-1, j+1) 写入的重叠区，
+            // 按 2i + j 分组后这些块都在更早的组里，而同组的块互不重叠：
+            // 逐组推进、组内并行，每个块看到的已合成内容与逐行顺序合成时完全相同。
+            for (int wave = 0; wave <= 2 * (grid_rows - 1) + grid_cols - 1; ++wave) {
+                const int first_row = std::max(0, (wave - grid_cols + 2) / 2);
+                const int last_row = std::min(grid_rows - 1, wave / 2);
+                if (first_row > last_row) continue;
+                // 每一波之间检查是否该停止：这一层合成了一部分，其余部分保留上一层放大的结果
+                if (level < num_levels && shouldStop()) {
+                    qDebug() << "Texture transfer stopped early at level" << level;
+                    stopped = true;
+                    break;
+                }
+                cv::parallel_for_(cv::Range(first_row, last_row + 1), [&](const cv::Range& range) {
+                    std::unique_ptr<MatchWorkspace> ws = workspaces.acquire();
+                    for (int i = range.start; i < range.end; ++i) {
+                        const int j = wave - 2 * i;
+                        const int x = xs[j];
+                        const int y = ys[i];
+                        cv::Rect rect(x, y, std::min(patch_size, current_content_lab.cols - x), std::min(patch_size, current_content_lab.rows - y));
+                        cv::RNG rng(patchSeed(options.seed, level, i, j));
+                        synthesizePatch(level_data, result_lab, rect, overlap, alpha, beta, rng, *ws);
                     }
+                    workspaces.release(std::move(ws));
+                });
+            }
 
-                    // 将最佳块通过计算出的边界掩码拼接到结果图上
-                    best_match.copyTo(result_lab(current_rect), final_mask);
-                }
+            // 合成完一层（最后一层除外）：给出放大到原图尺寸的预览
+            if (!stopped && level > finest_level && onPreview) {
+                onPreview(composeResult(result_lab, content_lab), num_levels - level + 1, num_levels - finest_level + 1);
             }
         }
 
-        // --- 5. 颜色保持 ---
-        // 为了保留原始内容的颜色，只使用合成结果的L通道（亮度/纹理），
-        // 而使用原始内容的a和b通道（颜色）。
-        qDebug() << "Performing final color preservation...";
-        std::vector<cv::Mat> result_channels, original_content_channels;
-        cv::split(result_lab, result_channels);
-        cv::split(content_lab, original_content_channels);
-        std::vector<cv::Mat> final_channels = { result_channels[0], original_content_channels[1], original_content_channels[2] };
-        cv::merge(final_channels, result_lab);
-        qDebug() << "Color preservation complete.";
-
-        // --- 6. 转换回BGR并返回 ---
-        cv::Mat result_bgr;
-        cv::cvtColor(result_lab, result_bgr, cv::COLOR_Lab2BGR);
-        return ImageConverter::matToQImage(result_bgr);
+        // --- 5. 颜色保持，转换回BGR并返回 ---
+        return composeResult(result_lab, content_lab);
 
     } catch (const cv::Exception& e) {
         // 捕获并报告任何OpenCV异常
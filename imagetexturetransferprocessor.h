@@ -32,6 +32,8 @@
 // =============================================================================
 
 #include <QImage>
+#include <atomic>
+#include <functional>
 
 /**
  * @class ImageTextureTransferProcessor
@@ -39,6 +41,9 @@
  *
  * 遵循单一职责原则，使用经典的颜色统计量匹配算法，将一张图片的
  * 纹理（风格）应用到另一张图片的内容上。此类被设计为纯静态工具类。
+ *
+ * 合成从金字塔最粗的一层开始逐层细化，可以随时停止：每完成一层给出一次预览，
+ * 超出时间预算或被取消时返回已经合成到的结果。
  */
 class ImageTextureTransferProcessor
 {
@@ -49,12 +54,45 @@ public:
     ImageTextureTransferProcessor() = delete;
 
     /**
-     * @brief 对外提供的唯一处理接口。
+     * @struct Options
+     * @brief 合成参数。
+     */
+    struct Options {
+        int levels = 4;       // 金字塔层数（不含原图）
+        int finestLevel = 0;  // 合成到这一层为止，更细的层只把结果放大
+        int patchDivisor = 8; // 块的边长 = 该层短边 / patchDivisor
+        qint64 budgetMs = 0;  // 时间预算（毫秒），0 表示不限
+        quint64 seed = 0;     // 随机种子，种子和其余参数相同且没有提前停止时结果相同
+    };
+
+    /**
+     * @enum Quality
+     * @brief 质量档位，决定金字塔层数、合成到哪一层和块的大小。
+     */
+    enum Quality { Draft, Balanced, Best };
+    static Options optionsFor(Quality quality);
+
+    // 每合成完一层调用一次：放大到原图尺寸的预览、已完成的层数、总层数
+    using PreviewCallback = std::function<void(const QImage &preview, int finishedLevels, int totalLevels)>;
+
+    /**
+     * @brief 以默认参数（Best 档位，不限时间）执行纹理迁移。
      * @param contentImage 内容图片 (QImage)。
      * @param textureImage 纹理/风格图片 (QImage)。
+     * @param seed 随机种子。块按波前在多个线程上并行合成，每个块的随机数只由种子和块的位置决定，
+     *             种子相同时结果相同。
      * @return 迁移了纹理的新 QImage。
      */
-    static QImage process(const QImage &contentImage, const QImage &textureImage);
+    static QImage process(const QImage &contentImage, const QImage &textureImage, quint64 seed = 0);
+
+    /**
+     * @brief 按给定参数执行纹理迁移，可随时停止。
+     * @param onPreview 每合成完一层调用一次（在调用线程中）。
+     * @param cancelled 不为空且变为true时尽快停止。
+     * @return 迁移了纹理的新 QImage；超出时间预算或被取消时为已经合成到的结果。
+     */
+    static QImage process(const QImage &contentImage, const QImage &textureImage, const Options &options,
+                          const PreviewCallback &onPreview = {}, const std::atomic<bool> *cancelled = nullptr);
 };
 
 #endif // IMAGETEXTURETRANSFERPROCESSOR_H
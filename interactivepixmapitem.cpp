@@ -29,16 +29,22 @@
 // =============================================================================
 
 #include "interactivepixmapitem.h"
-#include <QGraphicsPixmapItem>
 #include <QPainter>
 #include <QGraphicsSceneMouseEvent>
+#include <QStyleOptionGraphicsItem>
+#include <QTimer>
 #include <QCursor>
 #include <QtMath>
 
+// mip 层的最小边长：最长边缩小到该值以下时停止生成更低的层。
+static const int minMipSize = 256;
+// 交互停止多长时间（毫秒）后切换回全分辨率绘制。
+static const int idleDelayMs = 200;
+
 /**
  * @brief InteractivePixmapItem 构造函数。
  *
- * 负责设置项的交互标志，创建内部的 QGraphicsPixmapItem，并设置变换原点。
+ * 负责设置项的交互标志和缓存模式，生成 mip 层，并设置变换原点。
  * @param pixmap 要显示的图像。
  * @param parent 父图形项。
  */
@@ -52,34 +58,49 @@ InteractivePixmapItem::InteractivePixmapItem(const QPixmap &pixmap, QGraphicsIte
     setFlags(ItemIsSelectable | ItemIsMovable | ItemSendsGeometryChanges);
     // 启用悬停事件，以便在需要时可以改变光标样式或显示额外信息。
     setAcceptHoverEvents(true);
+    // 在设备坐标下缓存绘制结果。平移时直接复用缓存，
+    // 层级切换时由 invalidateCache() 显式失效。
+    setCacheMode(DeviceCoordinateCache);
+
+    // --- 2. 生成 mip 层 ---
+    // 第0层为原图，之后每层宽高减半。缩放基于上一层进行，
+    // 因此生成全部层的总代价不超过一次原图级别的平滑缩放。
+    fullSize = pixmap.size();
+    mipLevels.append(pixmap);
+    QImage level = pixmap.toImage();
+    while (qMax(level.width(), level.height()) > minMipSize && qMin(level.width(), level.height()) > 1) {
+        level = level.scaled(level.width() / 2, level.height() / 2, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        mipLevels.append(QPixmap::fromImage(level));
+    }
 
-    // --- 2. 创建并设置子项 ---
-    // 将一个标准的QGraphicsPixmapItem作为子项，它负责绘制图像。
-    // 这种组合模式将绘制和交互逻辑分离。
-    pixmapItem = new QGraphicsPixmapItem(pixmap, this);
+    // --- 3. 空闲计时器 ---
+    // 每次交互都会重启计时器，超时即认为交互结束。
+    idleTimer = new QTimer(this);
+    idleTimer->setSingleShot(true);
+    idleTimer->setInterval(idleDelayMs);
+    connect(idleTimer, &QTimer::timeout, this, &InteractivePixmapItem::settle);
 
-    // --- 3. 设置变换原点 ---
+    // --- 4. 设置变换原点 ---
     // 将旋转和缩放的中心点设置在图像的几何中心，确保变换行为符合直觉。
-    QSizeF originalSize = pixmap.size();
-    setTransformOriginPoint(originalSize.width() / 2, originalSize.height() / 2);
+    setTransformOriginPoint(fullSize.width() / 2, fullSize.height() / 2);
 }
 
 /**
  * @brief 返回该项的边界矩形。
  *
- * 直接返回内部 pixmapItem 的边界矩形，因为实际内容是由它定义的。
+ * 始终为原图尺寸，与当前绘制所用的 mip 层无关。
  * @return 该项在局部坐标系下的边界矩形。
  */
 QRectF InteractivePixmapItem::boundingRect() const
 {
-    return pixmapItem->boundingRect();
+    return QRectF(QPointF(0, 0), fullSize);
 }
 
 /**
  * @brief 绘制该项的内容。
  *
- * 这个函数只负责绘制附加的装饰（如此处的选中框），
- * 实际的图像是由子项 pixmapItem 自动绘制的，无需在此处手动调用。
+ * 交互期间根据当前的细节层次选择较低分辨率的 mip 层，并拉伸到原图尺寸的
+ * 矩形上绘制；空闲时始终绘制原图。最后在选中时绘制虚线选择框。
  * @param painter 用于绘制的 QPainter 对象。
  * @param option 提供样式选项。
  * @param widget 绘制所在的窗口部件。
@@ -89,14 +110,48 @@ void InteractivePixmapItem::paint(QPainter *painter, const QStyleOptionGraphicsI
     Q_UNUSED(option);
     Q_UNUSED(widget);
 
+    int level = 0;
+    if (interacting) {
+        level = levelForDetail(QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform()));
+    }
+
+    const QPixmap &source = mipLevels.at(level);
+    // 交互期间关闭平滑缩放以进一步降低每帧开销，空闲时恢复高质量绘制。
+    painter->setRenderHint(QPainter::SmoothPixmapTransform, !interacting);
+    painter->drawPixmap(boundingRect(), source, QRectF(source.rect()));
+
     // 如果该项当前被选中，则在其周围绘制一个虚线框作为视觉反馈。
     if (isSelected()) {
         painter->setPen(Qt::DashLine);
         painter->setBrush(Qt::NoBrush);
-        painter->drawRect(pixmapItem->boundingRect());
+        painter->drawRect(boundingRect());
     }
 }
 
+/**
+ * @brief 立即结束交互状态，切换回全分辨率绘制。
+ *
+ * 进入交互状态时缓存已失效，之后缓存的都是关闭平滑缩放的绘制结果（即使用的是第0层），
+ * 因此结束交互时缓存总要失效。
+ */
+void InteractivePixmapItem::settle()
+{
+    idleTimer->stop();
+    if (!interacting) return;
+    interacting = false;
+    invalidateCache();
+}
+
+/**
+ * @brief 显式使该项的设备坐标缓存失效，并请求重绘。
+ *
+ * QGraphicsItem::update() 会丢弃该项已缓存的像素，下一次绘制时重新调用 paint()。
+ */
+void InteractivePixmapItem::invalidateCache()
+{
+    update(boundingRect());
+}
+
 /**
  * @brief 鼠标按下事件处理器。
  *
@@ -135,3 +190,52 @@ void InteractivePixmapItem::wheelEvent(QGraphicsSceneWheelEvent *event)
     // 接受事件，表示我们已经处理了它，防止其进一步传递。
     event->accept();
 }
+
+/**
+ * @brief 图形项属性变化处理器。
+ *
+ * Shift+A/D（旋转）和滚轮（缩放）最终都会经过这里，因此在此统一进入交互状态。
+ * 纯平移（拖动）不会改变设备坐标下的像素内容，DeviceCoordinateCache
+ * 可以直接复用缓存，无需降级；但若已处于交互状态，拖动会延长该状态。
+ * @param change 变化的类型。
+ * @param value 新的值。
+ * @return 传递给基类处理后的值。
+ */
+QVariant InteractivePixmapItem::itemChange(GraphicsItemChange change, const QVariant &value)
+{
+    if (change == ItemRotationHasChanged || change == ItemScaleHasChanged || change == ItemTransformHasChanged) {
+        markInteracting();
+    } else if (change == ItemPositionHasChanged && interacting) {
+        idleTimer->start();
+    }
+    return QGraphicsObject::itemChange(change, value);
+}
+
+/**
+ * @brief 标记交互开始（或持续），并重新启动空闲计时器。
+ *
+ * 进入交互状态时缓存必须失效，否则会继续显示全分辨率的缓存内容。
+ */
+void InteractivePixmapItem::markInteracting()
+{
+    if (!interacting) {
+        interacting = true;
+        invalidateCache();
+    }
+    idleTimer->start();
+}
+
+/**
+ * @brief 根据设备坐标下的细节层次选择 mip 层索引。
+ *
+ * levelOfDetail 为1时一个图像像素对应一个屏幕像素；为0.25时图像被缩小到
+ * 四分之一，此时第2层（宽高各为原图1/4）已足够清晰。
+ * @param levelOfDetail 每个项坐标单位对应的设备像素数。
+ * @return 要绘制的 mip 层索引，0 为原图。
+ */
+int InteractivePixmapItem::levelForDetail(qreal levelOfDetail) const
+{
+    if (levelOfDetail <= 0.0 || levelOfDetail >= 1.0) return 0;
+    int level = qFloor(std::log2(1.0 / levelOfDetail));
+    return qBound(0, level, mipLevels.size() - 1);
+}
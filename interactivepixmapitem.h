@@ -33,19 +33,25 @@
 
 #include <QGraphicsObject>
 #include <QPixmap>
+#include <QVector>
 
 // --- 前置声明 ---
-class QGraphicsPixmapItem;
 class QGraphicsSceneMouseEvent;
 class QGraphicsSceneWheelEvent;
+class QTimer;
 
 /**
  * @class InteractivePixmapItem
  * @brief 一个可交互的 QGraphicsPixmapItem。
  *
- * 继承自 QGraphicsObject 以获得信号和槽的支持。它内部包含一个
- * QGraphicsPixmapItem 来负责实际的图像绘制，而此类本身则负责处理
- * 用户的交互事件，如点击、滚轮缩放等。
+ * 继承自 QGraphicsObject 以获得信号和槽的支持。它负责处理用户的交互
+ * 事件（如点击、拖动、滚轮缩放），并自行绘制图像。
+ *
+ * [细节层次 (LOD)]
+ * 构造时会为原图生成一组逐级减半的缩略层（mip 层）。拖动、旋转或缩放
+ * 期间，paint() 根据当前视图缩放比例挑选最接近的低分辨率层绘制；
+ * 交互停止一段时间后（或导出前调用 settle()）切换回全分辨率原图。
+ * 同时启用 DeviceCoordinateCache，缓存仅在绘制层级或图像改变时显式失效。
  */
 class InteractivePixmapItem : public QGraphicsObject
 {
@@ -75,6 +81,18 @@ public:
      */
     void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = nullptr) override;
 
+    /**
+     * @brief 立即结束交互状态，切换回全分辨率绘制。
+     *
+     * 在将场景渲染为最终图像（导出）之前调用，确保输出使用原图而非缩略层。
+     */
+    void settle();
+
+    /**
+     * @brief 显式使该项的设备坐标缓存失效，并请求重绘。
+     */
+    void invalidateCache();
+
 signals:
     /**
      * @brief 当该项被点击时发射此信号。
@@ -99,11 +117,38 @@ protected:
      */
     void wheelEvent(QGraphicsSceneWheelEvent *event) override;
 
+    /**
+     * @brief 图形项属性变化处理器。
+     *
+     * 位置、旋转或缩放改变时进入交互状态，以便使用低分辨率层绘制。
+     * @param change 变化的类型。
+     * @param value 新的值。
+     * @return 传递给基类处理后的值。
+     */
+    QVariant itemChange(GraphicsItemChange change, const QVariant &value) override;
+
 private:
+    /**
+     * @brief 标记交互开始（或持续），并重新启动空闲计时器。
+     */
+    void markInteracting();
+
+    /**
+     * @brief 根据设备坐标下的细节层次选择 mip 层索引。
+     * @param levelOfDetail 每个项坐标单位对应的设备像素数。
+     * @return 要绘制的 mip 层索引，0 为原图。
+     */
+    int levelForDetail(qreal levelOfDetail) const;
+
     // --- 成员变量 ---
-    // 使用组合的方式，让一个标准的QGraphicsPixmapItem负责图像的显示。
-    // InteractivePixmapItem 则作为包装器，为其添加交互能力。
-    QGraphicsPixmapItem *pixmapItem;
+    // mip 层：第0层为原图，之后每层宽高减半，直到最长边不超过 minMipSize。
+    QVector<QPixmap> mipLevels;
+    // 原图尺寸，所有层都绘制到这个矩形上，因此边界矩形与所选层无关。
+    QSizeF fullSize;
+    // [关键变量] 是否处于交互（拖动/旋转/缩放）状态。
+    bool interacting = false;
+    // 交互停止后的空闲计时器，超时后切换回全分辨率绘制。
+    QTimer *idleTimer;
 };
 
 #endif // INTERACTIVEPIXMAPITEM_H
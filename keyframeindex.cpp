@@ -0,0 +1,292 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+// =============================================================================
+// File: keyframeindex.cpp
+//
+// Description:
+// KeyframeIndex 类的实现文件。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include "keyframeindex.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QStandardPaths>
+#include <algorithm>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+}
+
+// 磁盘缓存文件的标识与版本
+static const quint32 cacheMagic = 0x4B464931; // "KFI1"
+static const quint32 cacheVersion = 2;
+// 缓存文件头（标识、版本、条目数）和每个条目的字节数
+static const qint64 cacheHeaderBytes = 3 * 4;
+static const qint64 cacheEntryBytes = 3 * 8;
+// 估计重排延迟时读取的视频数据包数
+static const int reorderProbePackets = 64;
+// 计算指纹时读取的文件首尾字节数
+static const qint64 fingerprintChunkBytes = 1024 * 1024;
+
+/**
+ * @brief KeyframeIndex 构造函数。
+ */
+KeyframeIndex::KeyframeIndex(QObject *parent)
+    : QThread(parent)
+{
+}
+
+/**
+ * @brief KeyframeIndex 析构函数，取消并等待后台线程。
+ */
+KeyframeIndex::~KeyframeIndex()
+{
+    cancel();
+    wait();
+}
+
+/**
+ * @brief 在后台线程中为指定文件建立索引。
+ * @param filePath 视频文件路径。
+ */
+void KeyframeIndex::build(const QString &filePath)
+{
+    if (isRunning()) {
+        cancel();
+        wait();
+    }
+    sourcePath = filePath;
+    cachePath.clear();
+    entries.clear();
+    cancelled.store(false, std::memory_order_relaxed);
+    ready.store(false, std::memory_order_release);
+    start(QThread::LowPriority);
+}
+
+/**
+ * @brief 取消正在进行的建立过程。
+ */
+void KeyframeIndex::cancel()
+{
+    cancelled.store(true, std::memory_order_relaxed);
+}
+
+/**
+ * @brief 查找时间点之前（含）最近的关键帧。
+ */
+bool KeyframeIndex::findPreceding(qint64 ms, Entry &entry) const
+{
+    if (!isReady() || entries.empty()) return false;
+    auto it = std::upper_bound(entries.begin(), entries.end(), ms,
+                               [](qint64 value, const Entry &e) { return value < e.ms; });
+    if (it == entries.begin()) return false;
+    entry = *(it - 1);
+    return true;
+}
+
+/**
+ * @brief 后台线程主函数：缓存 -> 容器索引 -> 扫描数据包。
+ */
+void KeyframeIndex::run()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    const QString fingerprint = fileFingerprint(sourcePath);
+    if (!fingerprint.isEmpty()) {
+        const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/keyframes";
+        QDir().mkpath(cacheDir);
+        cachePath = cacheDir + "/" + fingerprint + ".kfi";
+        if (loadCache()) {
+            ready.store(true, std::memory_order_release);
+            qDebug() << "关键帧索引: 从缓存载入" << entries.size() << "个关键帧，用时" << timer.elapsed() << "ms";
+            emit indexReady(static_cast<int>(entries.size()));
+            return;
+        }
+    }
+
+    AVFormatContext *formatCtx = nullptr;
+    if (avformat_open_input(&formatCtx, sourcePath.toLocal8Bit().constData(), nullptr, nullptr) != 0) return;
+    bool built = false;
+    if (avformat_find_stream_info(formatCtx, nullptr) >= 0) {
+        const int streamIndex = av_find_best_stream(formatCtx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+        if (streamIndex >= 0) {
+            built = readContainerIndex(formatCtx, streamIndex) || scanPackets(formatCtx, streamIndex);
+        }
+    }
+    avformat_close_input(&formatCtx);
+    if (!built || cancelled.load(std::memory_order_relaxed)) return;
+
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.ms < b.ms; });
+    saveCache();
+    ready.store(true, std::memory_order_release);
+    qDebug() << "关键帧索引: 建立" << entries.size() << "个关键帧，用时" << timer.elapsed() << "ms";
+    emit indexReady(static_cast<int>(entries.size()));
+}
+
+/**
+ * @brief 从容器自带的索引中读取关键帧。
+ *
+ * MP4/MOV 等格式在打开时就已读入完整的采样表，这里直接复制其中的关键帧条目。
+ * 条目的时间戳是 DTS，显示时间按估计的重排延迟推算。
+ * @return 容器索引中包含关键帧时返回true。
+ */
+bool KeyframeIndex::readContainerIndex(AVFormatContext *formatCtx, int streamIndex)
+{
+    AVStream *stream = formatCtx->streams[streamIndex];
+    const int count = avformat_index_get_entries_count(stream);
+    for (int i = 0; i < count && !cancelled.load(std::memory_order_relaxed); ++i) {
+        const AVIndexEntry *indexEntry = avformat_index_get_entry(stream, i);
+        if (!indexEntry || !(indexEntry->flags & AVINDEX_KEYFRAME) || indexEntry->timestamp == AV_NOPTS_VALUE) continue;
+        Entry entry;
+        entry.dts = indexEntry->timestamp;
+        entry.pos = indexEntry->pos;
+        entries.push_back(entry);
+    }
+    if (entries.empty()) return false;
+    // 没有可用的索引时还要从头扫描，因此在确定使用容器索引之后才读取数据包
+    const qint64 reorderDelay = measureReorderDelay(formatCtx, streamIndex);
+    for (Entry &entry : entries) {
+        entry.ms = av_rescale_q(entry.dts + reorderDelay, stream->time_base, AVRational{1, 1000});
+    }
+    return true;
+}
+
+/**
+ * @brief 估计视频流的重排延迟。
+ *
+ * 有B帧时数据包的 PTS 比 DTS 晚，取开头若干数据包中的最大差值。
+ * @return 重排延迟（视频流时间基），没有B帧或时间戳缺失时为0。
+ */
+qint64 KeyframeIndex::measureReorderDelay(AVFormatContext *formatCtx, int streamIndex)
+{
+    qint64 delay = 0;
+    int probed = 0;
+    AVPacket *packet = av_packet_alloc();
+    while (probed < reorderProbePackets && av_read_frame(formatCtx, packet) >= 0) {
+        if (packet->stream_index == streamIndex) {
+            ++probed;
+            if (packet->pts != AV_NOPTS_VALUE && packet->dts != AV_NOPTS_VALUE) delay = std::max(delay, packet->pts - packet->dts);
+        }
+        av_packet_unref(packet);
+    }
+    av_packet_free(&packet);
+    return delay;
+}
+
+/**
+ * @brief 逐个读取数据包（不解码）收集关键帧。
+ *
+ * 只解析容器，不调用解码器，速度受限于磁盘读取。
+ * @return 找到至少一个关键帧时返回true。
+ */
+bool KeyframeIndex::scanPackets(AVFormatContext *formatCtx, int streamIndex)
+{
+    // 丢弃其他流的数据包，减少解析开销
+    for (unsigned i = 0; i < formatCtx->nb_streams; ++i) {
+        if (static_cast<int>(i) != streamIndex) formatCtx->streams[i]->discard = AVDISCARD_ALL;
+    }
+    const AVRational timeBase = formatCtx->streams[streamIndex]->time_base;
+    AVPacket *packet = av_packet_alloc();
+    while (!cancelled.load(std::memory_order_relaxed) && av_read_frame(formatCtx, packet) >= 0) {
+        if (packet->stream_index == streamIndex && (packet->flags & AV_PKT_FLAG_KEY)) {
+            // 与容器索引一致：按显示时间查找，按解码时间定位
+            const qint64 pts = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+            if (pts != AV_NOPTS_VALUE) {
+                Entry entry;
+                entry.dts = packet->dts != AV_NOPTS_VALUE ? packet->dts : pts;
+                entry.ms = av_rescale_q(pts, timeBase, AVRational{1, 1000});
+                entry.pos = packet->pos;
+                entries.push_back(entry);
+            }
+        }
+        av_packet_unref(packet);
+    }
+    av_packet_free(&packet);
+    return !entries.empty();
+}
+
+/**
+ * @brief 从磁盘缓存读取索引。
+ * @return 缓存存在且格式正确时返回true。
+ */
+bool KeyframeIndex::loadCache()
+{
+    QFile file(cachePath);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    QDataStream stream(&file);
+    quint32 magic = 0, version = 0;
+    qint32 count = 0;
+    stream >> magic >> version >> count;
+    if (magic != cacheMagic || version != cacheVersion || count <= 0) return false;
+    // 条目数不能超过文件实际能容纳的数量，损坏的缓存不会导致巨大的分配
+    if (count > (file.size() - cacheHeaderBytes) / cacheEntryBytes) return false;
+    entries.resize(count);
+    for (Entry &entry : entries) {
+        stream >> entry.ms >> entry.dts >> entry.pos;
+    }
+    if (stream.status() != QDataStream::Ok) {
+        entries.clear();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 把索引写入磁盘缓存（失败时静默忽略，下次重新建立）。
+ */
+void KeyframeIndex::saveCache() const
+{
+    if (cachePath.isEmpty()) return;
+    QFile file(cachePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return;
+    QDataStream stream(&file);
+    stream << cacheMagic << cacheVersion << static_cast<qint32>(entries.size());
+    for (const Entry &entry : entries) {
+        stream << entry.ms << entry.dts << entry.pos;
+    }
+}
+
+/**
+ * @brief 计算文件指纹。
+ *
+ * 只读取首尾各1MiB，对任意大小的文件都是常数开销。
+ */
+QString KeyframeIndex::fileFingerprint(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) return QString();
+    const qint64 size = file.size();
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray::number(size));
+    hash.addData(file.read(fingerprintChunkBytes));
+    if (size > fingerprintChunkBytes && file.seek(std::max(fingerprintChunkBytes, size - fingerprintChunkBytes))) {
+        hash.addData(file.read(fingerprintChunkBytes));
+    }
+    return QString::fromLatin1(hash.result().toHex());
+}
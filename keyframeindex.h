@@ -0,0 +1,137 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+#ifndef KEYFRAMEINDEX_H
+#define KEYFRAMEINDEX_H
+
+// =============================================================================
+// File: keyframeindex.h
+//
+// Description:
+// 该文件定义了 KeyframeIndex 类，在后台线程中为视频流建立关键帧索引
+// （时间戳 -> 文件字节位置），并按文件指纹缓存到磁盘上，
+// 供 VideoDecoder 在跳转时直接定位到目标之前最近的关键帧。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include <QThread>
+#include <QString>
+#include <atomic>
+#include <vector>
+
+// --- 前置声明 ---
+struct AVFormatContext;
+
+/**
+ * @class KeyframeIndex
+ * @brief 视频流的关键帧索引（后台建立，磁盘缓存）。
+ *
+ * [建立方式]
+ * 1. 先查找磁盘缓存：缓存文件以视频文件的指纹（大小 + 首尾各1MiB内容的SHA-1）命名，
+ *    文件被改名或移动后仍然有效，内容变化后自动失效。
+ * 2. 容器自带索引（如 MP4 的 stss）时直接读取，无需扫描文件。
+ * 3. 否则只读取数据包（不解码），记录所有带关键帧标志的视频包。
+ *
+ * [时间戳]
+ * 容器索引中的时间戳是解码时间戳（DTS），有B帧时比显示时间戳（PTS）早一个重排延迟。
+ * 条目同时保存两者：ms 是显示时间，用于和跳转目标比较；dts 用于定位。
+ * 容器索引的条目用开头若干数据包中最大的 PTS - DTS 估计显示时间，宁可偏晚，
+ * 这样找到的关键帧一定不晚于目标。
+ *
+ * [线程约定]
+ * build() 启动后台线程；isReady() 返回true之后索引不再变化，
+ * findPreceding() 可以在任意线程中无锁调用。
+ */
+class KeyframeIndex : public QThread
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @struct Entry
+     * @brief 一个关键帧条目。
+     */
+    struct Entry {
+        qint64 ms = 0;   // 显示时间戳（毫秒），查找时与目标时间点比较
+        qint64 dts = 0;  // 解码时间戳（视频流时间基），定位时交给 av_seek_frame
+        qint64 pos = -1; // 数据包在文件中的字节位置，未知时为-1
+    };
+
+    explicit KeyframeIndex(QObject *parent = nullptr);
+    ~KeyframeIndex();
+
+    /**
+     * @brief 在后台线程中为指定文件建立索引（会先取消并等待上一次建立）。
+     * @param filePath 视频文件路径。
+     */
+    void build(const QString &filePath);
+
+    /**
+     * @brief 取消正在进行的建立过程。
+     */
+    void cancel();
+
+    /**
+     * @brief 索引是否已经建立完成。
+     */
+    bool isReady() const { return ready.load(std::memory_order_acquire); }
+
+    /**
+     * @brief 查找时间点之前（含）最近的关键帧。
+     * @param ms 目标时间点（毫秒）。
+     * @param entry [out] 找到的关键帧。
+     * @return 索引未就绪或目标早于第一个关键帧时返回false。
+     */
+    bool findPreceding(qint64 ms, Entry &entry) const;
+
+    /**
+     * @brief 关键帧个数（索引未就绪时为0）。
+     */
+    int size() const { return isReady() ? static_cast<int>(entries.size()) : 0; }
+
+signals:
+    // 索引建立完成时发射
+    void indexReady(int keyframeCount);
+
+protected:
+    void run() override;
+
+private:
+    // 从容器自带的索引中读取关键帧
+    bool readContainerIndex(AVFormatContext *formatCtx, int streamIndex);
+    // 读取开头若干视频数据包，返回其中最大的 PTS - DTS（视频流时间基）
+    qint64 measureReorderDelay(AVFormatContext *formatCtx, int streamIndex);
+    // 逐个读取数据包（不解码）收集关键帧
+    bool scanPackets(AVFormatContext *formatCtx, int streamIndex);
+    // 读写磁盘缓存
+    bool loadCache();
+    void saveCache() const;
+    // 计算文件指纹（大小 + 首尾各1MiB内容的SHA-1），失败时返回空字符串
+    static QString fileFingerprint(const QString &filePath);
+
+    QString sourcePath;           // 视频文件路径
+    QString cachePath;            // 磁盘缓存文件路径
+    std::vector<Entry> entries;   // 按时间戳排序的关键帧
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> ready{false};
+};
+
+#endif // KEYFRAMEINDEX_H
@@ -44,10 +44,13 @@
 #include "processcommand.h"
 #include "stagingareamanager.h"
 #include "stitcherdialog.h"
+#include "videoframeitem.h"
 #include "videoprocessor.h"
+#include "videotelemetrypanel.h"
 
 // --- 包含Qt模块 ---
 #include <QCloseEvent>
+#include <QDockWidget>
 #include <QFileDialog>
 #include <QGuiApplication>
 #include <QImageReader>
@@ -87,7 +90,7 @@ MainWindow::MainWindow(QWidget *parent)
     , currentHue(0)
     , videoProcessor(nullptr)
     , videoScene(nullptr)
-    , videoPixmapItem(nullptr)
+    , videoFrameItem(nullptr)
 {
     // --- 1. UI基础设置 ---
     ui->setupUi(this);
@@ -184,23 +187,45 @@ MainWindow::MainWindow(QWidget *parent)
     // --- 7. 视频播放器模块设置 (Video Player Module) ---
     videoScene = new QGraphicsScene(this);
     ui->videoView->setScene(videoScene);
+    videoFrameItem = new VideoFrameItem();
+    videoScene->addItem(videoFrameItem);
+    ui->videoView->viewport()->installEventFilter(this); // 视图尺寸变化时重新适配视频帧
     videoProcessor = new VideoProcessor(ui, this); // 将ui指针传递给VideoProcessor
     connect(ui->addVideoButton, &QPushButton::clicked, videoProcessor, &VideoProcessor::addVideos);
     connect(ui->removeVideoButton, &QPushButton::clicked, videoProcessor, &VideoProcessor::removeSelectedVideo);
     connect(ui->videoListView, &QListView::clicked, videoProcessor, &VideoProcessor::playVideoAtIndex);
     connect(ui->playPauseButton, &QPushButton::clicked, videoProcessor, &VideoProcessor::togglePlayPause);
+    connect(ui->prevFrameButton, &QPushButton::clicked, videoProcessor, &VideoProcessor::stepBackward);
+    connect(ui->nextFrameButton, &QPushButton::clicked, videoProcessor, &VideoProcessor::stepForward);
+    connect(ui->loopButton, &QPushButton::clicked, videoProcessor, &VideoProcessor::toggleLoop);
     connect(ui->videoSlider, &QSlider::sliderPressed, videoProcessor, &VideoProcessor::onSliderPressed);
     connect(ui->videoSlider, &QSlider::sliderMoved, videoProcessor, &VideoProcessor::seek);
     connect(ui->videoSlider, &QSlider::sliderReleased, videoProcessor, &VideoProcessor::stopSeeking);
     connect(ui->speedComboBox, &QComboBox::currentIndexChanged, videoProcessor, &VideoProcessor::setSpeed);
     connect(ui->saveFrameButton, &QPushButton::clicked, videoProcessor, &VideoProcessor::saveCurrentFrame);
     connect(ui->recordButton, &QPushButton::clicked, videoProcessor, &VideoProcessor::toggleRecording);
+    connect(ui->exportButton, &QPushButton::clicked, videoProcessor, &VideoProcessor::exportPlaylist);
 
     // 连接VideoProcessor的信号到MainWindow的槽
     connect(videoProcessor, &VideoProcessor::frameReady, this, &MainWindow::updateVideoFrame);
     connect(videoProcessor, &VideoProcessor::progressUpdated, this, &MainWindow::updateVideoProgress);
     connect(videoProcessor, &VideoProcessor::videoOpened, this, &MainWindow::onVideoOpened);
 
+    // 视频遥测面板：停靠窗口，由“工具”菜单开关，只在视频页显示
+    auto *telemetryDock = new QDockWidget("视频遥测", this);
+    telemetryDock->setObjectName("telemetryDock");
+    telemetryDock->setFeatures(QDockWidget::DockWidgetMovable | QDockWidget::DockWidgetFloatable);
+    telemetryDock->setWidget(new VideoTelemetryPanel(videoProcessor->getTelemetry(), telemetryDock));
+    addDockWidget(Qt::RightDockWidgetArea, telemetryDock);
+    telemetryDock->hide();
+    QAction *telemetryAction = ui->tool->addAction("视频遥测面板");
+    telemetryAction->setCheckable(true);
+    auto updateTelemetryDock = [this, telemetryDock, telemetryAction]() {
+        telemetryDock->setVisible(telemetryAction->isChecked() && ui->basicPage->currentWidget() == ui->videoTab);
+    };
+    connect(telemetryAction, &QAction::toggled, this, updateTelemetryDock);
+    connect(ui->basicPage, &QTabWidget::currentChanged, this, updateTelemetryDock);
+
     // --- 8. 初始化信息面板 ---
     updateExtraInfoPanels(QPixmap()); // 使用空Pixmap初始化直方图和颜色信息
 }
@@ -238,6 +263,9 @@ bool MainWindow::eventFilter(QObject *watched, QEvent *event)
         scaleImage(scaleFactor * zoomFactor);
         return true; // 事件已处理，不再向下传递
     }
+    if (watched == ui->videoView->viewport() && event->type() == QEvent::Resize && !videoFrameItem->image().isNull()) {
+        ui->videoView->fitInView(videoFrameItem, Qt::KeepAspectRatio);
+    }
     return QMainWindow::eventFilter(watched, event);
 }
 
@@ -645,17 +673,15 @@ void MainWindow::onMouseMovedOnImage(const QPointF &scenePos)
  * @brief 槽函数：更新视频播放视图的当前帧。
  * @param frame 要显示的视频帧。
  */
-void MainWindow::updateVideoFrame(const QPixmap &frame)
+void MainWindow::updateVideoFrame(const QImage &frame)
 {
     if (frame.isNull()) return;
 
-    if (!videoPixmapItem) {
-        videoPixmapItem = videoScene->addPixmap(frame);
-    } else {
-        videoPixmapItem->setPixmap(frame);
+    // 帧直接交给图形项绘制；只有分辨率变化时才重新计算场景范围和缩放
+    if (videoFrameItem->setImage(frame)) {
+        videoScene->setSceneRect(videoFrameItem->boundingRect());
+        ui->videoView->fitInView(videoFrameItem, Qt::KeepAspectRatio);
     }
-    videoScene->setSceneRect(frame.rect());
-    ui->videoView->fitInView(videoPixmapItem, Qt::KeepAspectRatio);
 }
 
 /**
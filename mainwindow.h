@@ -48,6 +48,7 @@ class StagingAreaManager;
 class DraggableItemModel;
 class QUndoStack;
 class ProcessCommand;
+class VideoFrameItem;
 class HistogramWidget;
 class VideoProcessor;
 
@@ -134,7 +135,7 @@ private slots:
     void on_applyAdjustmentsButton_clicked();
 
     // --- 视频处理与播放 (Video Processing & Playback) ---
-    void updateVideoFrame(const QPixmap &frame);
+    void updateVideoFrame(const QImage &frame);
     void updateVideoProgress(const QString &timeString, int position, int duration);
     void onVideoOpened(bool success, int totalDurationMs, double fps);
 
@@ -176,7 +177,7 @@ private:
     QGraphicsScene *imageScene;         // 用于显示静态图像的场景
     QGraphicsPixmapItem *pixmapItem;    // 在场景中显示的图像项
     QGraphicsScene *videoScene;         // 用于显示视频帧的场景
-    QGraphicsPixmapItem *videoPixmapItem; // 在场景中显示的视频帧项
+    VideoFrameItem *videoFrameItem;     // 在场景中显示的视频帧项
 
     // 状态与数据
     QString currentStagedImageId;       // 当前在主视图中显示的图像在暂存区的ID
@@ -0,0 +1,190 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+// =============================================================================
+// File: packetqueue.cpp
+//
+// Description:
+// PacketQueue 类的实现文件。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include "packetqueue.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+/**
+ * @brief PacketQueue 构造函数，预分配全部数据包槽位。
+ * @param capacity 队列最多容纳的数据包个数。
+ */
+PacketQueue::PacketQueue(int capacity)
+    : packets(capacity), serials(capacity, 0)
+{
+    for (AVPacket *&packet : packets) {
+        packet = av_packet_alloc();
+    }
+}
+
+/**
+ * @brief PacketQueue 析构函数，释放所有槽位。
+ */
+PacketQueue::~PacketQueue()
+{
+    for (AVPacket *&packet : packets) {
+        av_packet_free(&packet);
+    }
+}
+
+/**
+ * @brief 等待空位。
+ * @return 可以写入时返回true；被中止或被打断时返回false。
+ */
+bool PacketQueue::waitForSpaceLocked()
+{
+    while (!aborted && !putInterrupted && count == static_cast<int>(packets.size())) {
+        notFull.wait(&mutex);
+    }
+    if (aborted) return false;
+    if (putInterrupted) {
+        putInterrupted = false;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 写入一个数据包。
+ */
+bool PacketQueue::put(AVPacket *packet)
+{
+    QMutexLocker locker(&mutex);
+    if (!waitForSpaceLocked()) return false;
+    const int tail = (head + count) % static_cast<int>(packets.size());
+    av_packet_move_ref(packets[tail], packet);
+    serials[tail] = serial;
+    ++count;
+    notEmpty.wakeOne();
+    return true;
+}
+
+/**
+ * @brief 写入结束标记（空数据包）。
+ */
+bool PacketQueue::putEof()
+{
+    QMutexLocker locker(&mutex);
+    if (!waitForSpaceLocked()) return false;
+    const int tail = (head + count) % static_cast<int>(packets.size());
+    av_packet_unref(packets[tail]); // 空数据包即结束标记
+    serials[tail] = serial;
+    ++count;
+    notEmpty.wakeOne();
+    return true;
+}
+
+/**
+ * @brief 读取一个数据包。
+ */
+bool PacketQueue::get(AVPacket *packet, int &packetSerial)
+{
+    QMutexLocker locker(&mutex);
+    while (!aborted && count == 0) {
+        notEmpty.wait(&mutex);
+    }
+    if (aborted) return false;
+    av_packet_move_ref(packet, packets[head]);
+    packetSerial = serials[head];
+    head = (head + 1) % static_cast<int>(packets.size());
+    --count;
+    notFull.wakeOne();
+    return true;
+}
+
+/**
+ * @brief 清空所有槽位。
+ */
+void PacketQueue::clearLocked()
+{
+    for (AVPacket *packet : packets) {
+        av_packet_unref(packet);
+    }
+    head = 0;
+    count = 0;
+}
+
+/**
+ * @brief 清空队列并设置新的序号。
+ *
+ * 打断写入就是为了让写入方尽快来清空队列：没有被阻塞的写入消耗掉的打断标记
+ * 在这里一并清除，否则清空后的第一次写入会被无故打断。
+ */
+void PacketQueue::flush(int newSerial)
+{
+    QMutexLocker locker(&mutex);
+    clearLocked();
+    serial = newSerial;
+    putInterrupted = false;
+    notFull.wakeAll();
+}
+
+/**
+ * @brief 中止队列。
+ */
+void PacketQueue::abort()
+{
+    QMutexLocker locker(&mutex);
+    aborted = true;
+    notEmpty.wakeAll();
+    notFull.wakeAll();
+}
+
+/**
+ * @brief 重新启用队列。
+ */
+void PacketQueue::start(int initialSerial)
+{
+    QMutexLocker locker(&mutex);
+    clearLocked();
+    serial = initialSerial;
+    aborted = false;
+    putInterrupted = false;
+}
+
+/**
+ * @brief 打断一次写入等待。
+ */
+void PacketQueue::interruptPut()
+{
+    QMutexLocker locker(&mutex);
+    putInterrupted = true;
+    notFull.wakeAll();
+}
+
+/**
+ * @brief 当前队列中的数据包个数。
+ */
+int PacketQueue::size() const
+{
+    QMutexLocker locker(&mutex);
+    return count;
+}
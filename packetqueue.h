@@ -0,0 +1,135 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+#ifndef PACKETQUEUE_H
+#define PACKETQUEUE_H
+
+// =============================================================================
+// File: packetqueue.h
+//
+// Description:
+// 该文件定义了 PacketQueue 类，一个有界的、阻塞式的 FFmpeg 数据包队列。
+// 解复用线程向其中写入压缩数据包，视频/音频解码线程从中读取。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include <QMutex>
+#include <QWaitCondition>
+#include <vector>
+
+// --- 前置声明 ---
+struct AVPacket;
+
+/**
+ * @class PacketQueue
+ * @brief 有界的阻塞式数据包队列。
+ *
+ * 队列的所有 AVPacket 槽位在构造时预分配，put()/get() 通过
+ * av_packet_move_ref 转移数据包的所有权，运行期间不再分配 AVPacket。
+ *
+ * [序号 (serial)]
+ * 每个数据包都带有写入时队列的序号。跳转时解复用线程调用 flush()
+ * 清空队列并设置新的序号，解码线程发现序号变化后清空解码器内部缓冲，
+ * 并用新序号标记之后输出的帧。
+ *
+ * [结束标记]
+ * putEof() 写入一个空数据包，解码线程收到后以 nullptr 调用
+ * avcodec_send_packet，取出解码器中剩余的所有帧。
+ */
+class PacketQueue
+{
+public:
+    /**
+     * @brief 构造函数。
+     * @param capacity 队列最多容纳的数据包个数。
+     */
+    explicit PacketQueue(int capacity);
+    ~PacketQueue();
+
+    PacketQueue(const PacketQueue&) = delete;
+    PacketQueue& operator=(const PacketQueue&) = delete;
+
+    /**
+     * @brief 写入一个数据包。队列已满时阻塞，直到有空位、被中止或被打断。
+     * @param packet 要写入的数据包。成功时其引用被移入队列，packet 变为空包。
+     * @return 成功写入返回true；被中止或被 interruptPut() 打断时返回false，packet 保持不变。
+     */
+    bool put(AVPacket *packet);
+
+    /**
+     * @brief 写入结束标记（空数据包）。阻塞规则同 put()。
+     */
+    bool putEof();
+
+    /**
+     * @brief 读取一个数据包。队列为空时阻塞，直到有数据或被中止。
+     * @param packet [out] 接收数据包（调用者负责 av_packet_unref）。
+     * @param serial [out] 该数据包写入时队列的序号。
+     * @return 被中止时返回false。
+     */
+    bool get(AVPacket *packet, int &serial);
+
+    /**
+     * @brief 清空队列中的所有数据包，并设置新的序号。
+     * @param newSerial 之后写入的数据包所携带的序号。
+     */
+    void flush(int newSerial);
+
+    /**
+     * @brief 中止队列：唤醒所有等待者，之后的 put()/get() 立即返回false。
+     */
+    void abort();
+
+    /**
+     * @brief 重新启用队列（清空数据、清除中止标志并设置初始序号）。
+     */
+    void start(int initialSerial);
+
+    /**
+     * @brief 打断一次正在（或即将）阻塞的 put()，让写入线程回去处理跳转等控制请求。
+     */
+    void interruptPut();
+
+    /**
+     * @brief 当前队列中的数据包个数。
+     */
+    int size() const;
+
+private:
+    // 清空所有槽位（调用者需持有锁）
+    void clearLocked();
+    // 等待空位，返回是否可以写入（调用者需持有锁）
+    bool waitForSpaceLocked();
+
+    mutable QMutex mutex;
+    QWaitCondition notEmpty;  // 有数据可读
+    QWaitCondition notFull;   // 有空位可写
+
+    std::vector<AVPacket*> packets; // 预分配的数据包槽位
+    std::vector<int> serials;       // 每个槽位对应的序号
+    int head = 0;                   // 读位置
+    int count = 0;                  // 当前数据包个数
+    int serial = 0;                 // 当前写入序号
+    bool aborted = false;           // 中止标志
+    bool putInterrupted = false;    // 一次性的写入打断标志
+};
+
+#endif // PACKETQUEUE_H
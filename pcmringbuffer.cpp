@@ -0,0 +1,126 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+// =============================================================================
+// File: pcmringbuffer.cpp
+//
+// Description:
+// PcmRingBuffer 类的实现文件。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include "pcmringbuffer.h"
+#include <algorithm>
+#include <cstring>
+
+/**
+ * @brief PcmRingBuffer 构造函数。
+ * @param capacity 缓冲区容量（字节）。
+ */
+PcmRingBuffer::PcmRingBuffer(qint64 capacity)
+    : buffer(static_cast<size_t>(std::max<qint64>(capacity, 1)))
+{
+}
+
+/**
+ * @brief [生产者] 写入数据。
+ *
+ * 序号变化时先发布新的段起点，再写入数据；消费者看到写位置前进时，
+ * 一定也能看到不早于这些数据的段信息。
+ */
+qint64 PcmRingBuffer::write(const char *data, qint64 size, int serial)
+{
+    const quint64 w = writePos.load(std::memory_order_relaxed);
+    if (serial != segmentSerial.load(std::memory_order_relaxed)) {
+        segmentStart.store(w, std::memory_order_relaxed);
+        segmentSerial.store(serial, std::memory_order_release);
+    }
+    const qint64 n = std::min(size, freeSpace());
+    if (n <= 0) return 0;
+    copyIn(w, data, n);
+    writePos.store(w + n, std::memory_order_release);
+    return n;
+}
+
+/**
+ * @brief [生产者] 当前可写入的字节数。
+ */
+qint64 PcmRingBuffer::freeSpace() const
+{
+    const quint64 used = writePos.load(std::memory_order_relaxed) - readPos.load(std::memory_order_acquire);
+    return capacity() - static_cast<qint64>(used);
+}
+
+/**
+ * @brief [消费者] 读取属于当前序号的数据。
+ *
+ * 先读写位置、后读段信息：读到的段信息不会早于写位置之前的任何数据。
+ * - 段序号早于当前序号：写位置之前全是旧数据，全部丢弃。
+ * - 段序号等于当前序号：段起点之前是旧数据，跳过后读取。
+ * - 段序号晚于当前序号（调用者看到的序号已经过期）：只丢弃段起点之前的数据，本次不读取。
+ */
+qint64 PcmRingBuffer::read(char *data, qint64 maxSize, int currentSerial)
+{
+    const quint64 w = writePos.load(std::memory_order_acquire);
+    const int serial = segmentSerial.load(std::memory_order_acquire);
+    quint64 r = readPos.load(std::memory_order_relaxed);
+
+    const int age = serial - currentSerial;
+    if (age < 0) {
+        if (r != w) readPos.store(w, std::memory_order_release);
+        return 0;
+    }
+    // 段起点可能在读取写位置之后才发布，因此不能越过 w
+    r = std::max(r, std::min(segmentStart.load(std::memory_order_relaxed), w));
+    qint64 n = 0;
+    if (age == 0) {
+        n = std::min(maxSize, static_cast<qint64>(w - r));
+        if (n > 0) copyOut(r, data, n);
+    }
+    readPos.store(r + n, std::memory_order_release);
+    return n;
+}
+
+/**
+ * @brief 缓冲区中的字节数（近似值）。
+ */
+qint64 PcmRingBuffer::size() const
+{
+    const quint64 r = readPos.load(std::memory_order_acquire);
+    const quint64 w = writePos.load(std::memory_order_acquire);
+    return static_cast<qint64>(w - r);
+}
+
+void PcmRingBuffer::copyIn(quint64 pos, const char *data, qint64 size)
+{
+    const size_t offset = static_cast<size_t>(pos % buffer.size());
+    const size_t first = std::min(static_cast<size_t>(size), buffer.size() - offset);
+    std::memcpy(buffer.data() + offset, data, first);
+    std::memcpy(buffer.data(), data + first, static_cast<size_t>(size) - first);
+}
+
+void PcmRingBuffer::copyOut(quint64 pos, char *data, qint64 size) const
+{
+    const size_t offset = static_cast<size_t>(pos % buffer.size());
+    const size_t first = std::min(static_cast<size_t>(size), buffer.size() - offset);
+    std::memcpy(data, buffer.data() + offset, first);
+    std::memcpy(data + first, buffer.data(), static_cast<size_t>(size) - first);
+}
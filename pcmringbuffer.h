@@ -0,0 +1,113 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+#ifndef PCMRINGBUFFER_H
+#define PCMRINGBUFFER_H
+
+// =============================================================================
+// File: pcmringbuffer.h
+//
+// Description:
+// 该文件定义了 PcmRingBuffer 类，一个预分配的单生产者/单消费者无锁字节环形缓冲区，
+// 用于在音频解码线程和音频输出设备之间传递 PCM 数据。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include <QtGlobal>
+#include <atomic>
+#include <vector>
+
+/**
+ * @class PcmRingBuffer
+ * @brief 带跳转序号的 PCM 字节环形缓冲区。
+ *
+ * [线程约定]
+ * - write()、freeSpace() 只能由唯一的生产者（音频解码线程）调用。
+ * - read() 只能由唯一的消费者（音频输出设备）调用。
+ * - size() 可由任意线程调用，返回的是一个近似值。
+ *
+ * [跳转]
+ * 与 SpscRingBuffer 一样，缓冲区只能由消费者清空。生产者写入新序号的第一个字节时
+ * 记下这个位置（“段起点”），消费者读取时把段起点之前的旧数据直接跳过，
+ * 缓冲区中只有旧序号的数据时全部丢弃。跳转因此不需要重建任何对象，也不需要加锁。
+ *
+ * 读写位置是单调递增的字节计数，对容量取模得到下标；
+ * 存储空间在构造时一次性分配，运行期间不再分配内存。
+ */
+class PcmRingBuffer
+{
+public:
+    /**
+     * @brief 构造函数。
+     * @param capacity 缓冲区容量（字节）。
+     */
+    explicit PcmRingBuffer(qint64 capacity);
+
+    PcmRingBuffer(const PcmRingBuffer&) = delete;
+    PcmRingBuffer& operator=(const PcmRingBuffer&) = delete;
+
+    /**
+     * @brief [生产者] 写入数据，空间不足时只写入能放下的部分。
+     * @param data 数据。
+     * @param size 字节数。
+     * @param serial 这段数据所属的跳转序号。
+     * @return 实际写入的字节数。
+     */
+    qint64 write(const char *data, qint64 size, int serial);
+
+    /**
+     * @brief [生产者] 当前可写入的字节数。
+     */
+    qint64 freeSpace() const;
+
+    /**
+     * @brief [消费者] 读取属于当前序号的数据。
+     * @param data [out] 接收数据的缓冲区。
+     * @param maxSize 最多读取的字节数。
+     * @param currentSerial 当前的跳转序号，更早的数据被丢弃。
+     * @return 实际读取的字节数；暂时没有当前序号的数据时返回0。
+     */
+    qint64 read(char *data, qint64 maxSize, int currentSerial);
+
+    /**
+     * @brief 缓冲区中的字节数（近似值，包括尚未丢弃的旧数据）。
+     */
+    qint64 size() const;
+
+    qint64 capacity() const { return static_cast<qint64>(buffer.size()); }
+
+private:
+    // 把 [pos, pos + size) 拷贝进/出环形存储，处理回绕
+    void copyIn(quint64 pos, const char *data, qint64 size);
+    void copyOut(quint64 pos, char *data, qint64 size) const;
+
+    // 预分配的存储空间
+    std::vector<char> buffer;
+    // [关键变量] 读位置（累计字节数），只由消费者写入。与 writePos 分处不同缓存行。
+    alignas(64) std::atomic<quint64> readPos{0};
+    // [关键变量] 写位置（累计字节数），只由生产者写入。
+    alignas(64) std::atomic<quint64> writePos{0};
+    // [关键变量] 最近一个序号的段起点和序号，只由生产者写入（先写起点，再以 release 语义写序号）。
+    std::atomic<quint64> segmentStart{0};
+    std::atomic<int> segmentSerial{-1};
+};
+
+#endif // PCMRINGBUFFER_H
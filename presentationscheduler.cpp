@@ -0,0 +1,233 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+// =============================================================================
+// File: presentationscheduler.cpp
+//
+// Description:
+// PresentationScheduler 类的实现文件。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include "presentationscheduler.h"
+#include <QTimer>
+#include <algorithm>
+
+// 两次音频位置更新之间外推的上限（毫秒）
+static const qint64 maxAudioExtrapolationMs = 100;
+// 两次刷新之间的最长间隔（毫秒），保证暂时没有帧时也能及时轮询
+static const qint64 maxTickIntervalMs = 50;
+
+/**
+ * @brief PresentationScheduler 构造函数。
+ */
+PresentationScheduler::PresentationScheduler(QObject *parent)
+    : QObject(parent)
+{
+    timer = new QTimer(this);
+    timer->setSingleShot(true);
+    timer->setTimerType(Qt::PreciseTimer);
+    connect(timer, &QTimer::timeout, this, &PresentationScheduler::onTimeout);
+    wallTimer.start();
+}
+
+/**
+ * @brief 开始调度，时钟从0开始。
+ */
+void PresentationScheduler::start(double fps)
+{
+    frameIntervalMs = fps > 0 ? std::max<qint64>(1, qRound64(1000.0 / fps)) : 40;
+    presentedCount = droppedCount = lateCount = 0;
+    lastPresentWallMs = -1;
+    lastReportWallMs = wallMs();
+    running = true;
+    paused = false;
+    resetClock(0);
+    armTimer(0);
+}
+
+/**
+ * @brief 停止调度。
+ */
+void PresentationScheduler::stop()
+{
+    running = false;
+    paused = false;
+    timer->stop();
+}
+
+/**
+ * @brief 暂停：冻结时钟并停止刷新。
+ */
+void PresentationScheduler::pause()
+{
+    if (!running || paused) return;
+    pausedClockMs = clockMs();
+    paused = true;
+    timer->stop();
+}
+
+/**
+ * @brief 继续：时钟从暂停处继续，并立即刷新一次。
+ */
+void PresentationScheduler::resume()
+{
+    if (!running || !paused) return;
+    paused = false;
+    anchorClockMs = pausedClockMs;
+    anchorWallMs = wallMs();
+    lastAudioWallMs = anchorWallMs; // 暂停期间不计入音频外推
+    armTimer(0);
+}
+
+/**
+ * @brief 设置播放速率，时钟从当前位置按新速率继续。
+ */
+void PresentationScheduler::setRate(double newRate)
+{
+    if (newRate <= 0 || newRate == playbackRate) return;
+    const qint64 now = clockMs();
+    playbackRate = newRate;
+    if (paused) {
+        pausedClockMs = now;
+    } else {
+        anchorClockMs = now;
+        anchorWallMs = wallMs();
+    }
+}
+
+/**
+ * @brief 设置显示器刷新率。
+ */
+void PresentationScheduler::setDisplayRefreshRate(double hz)
+{
+    refreshIntervalMs = hz > 0 ? std::max<qint64>(1, static_cast<qint64>(1000.0 / hz)) : 16;
+}
+
+/**
+ * @brief 把时钟重置到指定位置。
+ */
+void PresentationScheduler::resetClock(qint64 ms)
+{
+    source = WallClock;
+    anchorClockMs = pausedClockMs = ms;
+    anchorWallMs = wallMs();
+    lastAudioMs = -1;
+}
+
+/**
+ * @brief 以音频位置作为主时钟。
+ *
+ * 音频设备报告的位置按缓冲周期跳变，只在位置变化时记录变化时刻，
+ * clockMs() 在两次变化之间用墙上时钟外推。墙上时钟的锚点同时跟随音频，
+ * 之后切换到墙上时钟时位置连续。
+ */
+void PresentationScheduler::updateAudioClock(qint64 audioMs)
+{
+    const qint64 now = wallMs();
+    if (audioMs != lastAudioMs) {
+        lastAudioMs = audioMs;
+        lastAudioWallMs = now;
+    }
+    source = AudioClock;
+    anchorClockMs = clockMs();
+    anchorWallMs = now;
+}
+
+/**
+ * @brief 改用墙上时钟，位置从当前时钟继续。
+ */
+void PresentationScheduler::useWallClock()
+{
+    if (source == WallClock) return;
+    anchorClockMs = clockMs();
+    anchorWallMs = wallMs();
+    source = WallClock;
+}
+
+/**
+ * @brief 当前主时钟（毫秒）。
+ */
+qint64 PresentationScheduler::clockMs() const
+{
+    if (!running || paused) return pausedClockMs;
+    const qint64 now = wallMs();
+    if (source == AudioClock && lastAudioMs >= 0) {
+        return lastAudioMs + std::min(now - lastAudioWallMs, maxAudioExtrapolationMs);
+    }
+    return anchorClockMs + qRound64((now - anchorWallMs) * playbackRate);
+}
+
+/**
+ * @brief 记录一帧已显示。
+ */
+void PresentationScheduler::framePresented(qint64 framePts, qint64 clock)
+{
+    ++presentedCount;
+    // 取出的是不晚于时钟的最新一帧，落后超过一帧说明这一帧本该更早显示
+    if (clock - framePts > frameIntervalMs) ++lateCount;
+    const qint64 now = wallMs();
+    lastPresentWallMs = now;
+    if (now - lastReportWallMs >= 1000) {
+        lastReportWallMs = now;
+        emit statsUpdated(presentedCount, droppedCount, lateCount);
+    }
+}
+
+/**
+ * @brief 记录被丢弃的帧。
+ */
+void PresentationScheduler::framesDropped(qint64 count)
+{
+    droppedCount += std::max<qint64>(0, count);
+}
+
+/**
+ * @brief 安排下一次刷新。
+ */
+void PresentationScheduler::scheduleNext(qint64 nextFramePts)
+{
+    if (!running || paused) return;
+    const qint64 now = wallMs();
+    qint64 delay = refreshIntervalMs; // 暂时没有帧：按刷新周期轮询
+    if (nextFramePts >= 0) delay = qRound64((nextFramePts - clockMs()) / playbackRate);
+    // 距上次呈现不足一个刷新周期时推迟，呈现频率不超过显示器刷新率
+    if (lastPresentWallMs >= 0) delay = std::max(delay, lastPresentWallMs + refreshIntervalMs - now);
+    armTimer(std::clamp<qint64>(delay, 1, maxTickIntervalMs));
+}
+
+/**
+ * @brief 启动定时器并记下预定的触发时刻。
+ */
+void PresentationScheduler::armTimer(qint64 delayMs)
+{
+    plannedTickNs = wallTimer.nsecsElapsed() + delayMs * 1000000;
+    timer->start(static_cast<int>(delayMs));
+}
+
+/**
+ * @brief 定时器到期：记录触发延迟后发出 tick()。
+ */
+void PresentationScheduler::onTimeout()
+{
+    lastTickLatencyUs = std::max<qint64>(0, (wallTimer.nsecsElapsed() - plannedTickNs) / 1000);
+    emit tick();
+}
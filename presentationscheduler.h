@@ -0,0 +1,156 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+#ifndef PRESENTATIONSCHEDULER_H
+#define PRESENTATIONSCHEDULER_H
+
+// =============================================================================
+// File: presentationscheduler.h
+//
+// Description:
+// 该文件定义了 PresentationScheduler 类，为视频播放提供主时钟、
+// 按帧的显示时刻安排刷新，并统计显示、丢弃和迟到的帧数。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include <QObject>
+#include <QElapsedTimer>
+
+class QTimer;
+
+/**
+ * @class PresentationScheduler
+ * @brief 视频呈现调度器（主线程）。
+ *
+ * [主时钟]
+ * 有音频输出时以音频为主时钟：播放端每次刷新时通过 updateAudioClock() 告知音频位置，
+ * 两次音频位置更新之间用墙上时钟平滑外推（最多100毫秒，音频卡住时视频随之等待）；
+ * 没有音频或变速播放时使用按速率缩放的墙上时钟。两者随时对齐，切换时不会跳变。
+ *
+ * [节奏]
+ * 不再以固定的 1000/fps 间隔刷新：每次呈现后根据下一帧的时间戳计算它的显示时刻，
+ * 用单次精确定时器在那时触发 tick()；同时不比显示器的刷新周期更频繁地呈现，
+ * 高帧率视频在低刷新率的显示器上不会白白转换和上传看不到的帧。
+ *
+ * [统计]
+ * presented：已显示的帧；dropped：从未显示就被更新的帧取代或被效果线程丢弃的帧；
+ * late：显示时已落后于主时钟超过一帧的帧。
+ */
+class PresentationScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum ClockSource { AudioClock, WallClock };
+
+    explicit PresentationScheduler(QObject *parent = nullptr);
+
+    /**
+     * @brief 开始调度（时钟从0开始）。
+     * @param fps 视频的标称帧率，用于判定迟到帧。
+     */
+    void start(double fps);
+    void stop();
+    // 暂停：冻结时钟并停止刷新
+    void pause();
+    // 继续：时钟从暂停处继续，并立即刷新一次
+    void resume();
+    bool isRunning() const { return running && !paused; }
+
+    /**
+     * @brief 设置播放速率，时钟从当前位置按新速率继续。
+     */
+    void setRate(double newRate);
+    double rate() const { return playbackRate; }
+
+    // 设置显示器刷新率（Hz），限制最高呈现频率
+    void setDisplayRefreshRate(double hz);
+
+    /**
+     * @brief 把时钟重置到指定位置（跳转后调用），之后在收到音频位置之前使用墙上时钟。
+     */
+    void resetClock(qint64 ms);
+    // 以音频位置作为主时钟（每次刷新时调用）
+    void updateAudioClock(qint64 audioMs);
+    // 改用墙上时钟（静音或变速时）
+    void useWallClock();
+    // 当前主时钟（毫秒）
+    qint64 clockMs() const;
+    ClockSource clockSource() const { return source; }
+
+    // 记录一帧已显示
+    void framePresented(qint64 framePts, qint64 clock);
+    // 记录被丢弃的帧
+    void framesDropped(qint64 count);
+    /**
+     * @brief 安排下一次刷新。
+     * @param nextFramePts 下一帧的时间戳（毫秒），-1 表示暂时没有可显示的帧。
+     */
+    void scheduleNext(qint64 nextFramePts);
+
+    qint64 presentedFrames() const { return presentedCount; }
+    qint64 droppedFrames() const { return droppedCount; }
+    qint64 lateFrames() const { return lateCount; }
+    // 最近一次 tick() 实际触发时刻晚于预定时刻的时长（微秒），反映主线程事件循环的拥塞程度
+    qint64 tickLatencyUs() const { return lastTickLatencyUs; }
+
+signals:
+    // 到了刷新时刻
+    void tick();
+    // 约每秒报告一次统计数据
+    void statsUpdated(qint64 presented, qint64 dropped, qint64 late);
+
+private slots:
+    // 定时器到期：记录触发延迟后发出 tick()
+    void onTimeout();
+
+private:
+    qint64 wallMs() const { return wallTimer.elapsed(); }
+    // 启动定时器并记下预定的触发时刻
+    void armTimer(qint64 delayMs);
+
+    QTimer *timer = nullptr;
+    QElapsedTimer wallTimer;
+    bool running = false;
+    bool paused = false;
+    double playbackRate = 1.0;
+    qint64 frameIntervalMs = 40;
+    qint64 refreshIntervalMs = 16;
+
+    // --- 时钟 ---
+    ClockSource source = WallClock;
+    qint64 anchorClockMs = 0;   // 墙上时钟的锚点：anchorWallMs 时刻的时钟值
+    qint64 anchorWallMs = 0;
+    qint64 lastAudioMs = -1;    // 最近一次变化的音频位置及其变化时刻
+    qint64 lastAudioWallMs = 0;
+    qint64 pausedClockMs = 0;
+
+    // --- 统计 ---
+    qint64 lastPresentWallMs = -1;
+    qint64 lastReportWallMs = 0;
+    qint64 presentedCount = 0;
+    qint64 droppedCount = 0;
+    qint64 lateCount = 0;
+    qint64 plannedTickNs = 0;     // 预定的触发时刻（wallTimer 纳秒）
+    qint64 lastTickLatencyUs = 0;
+};
+
+#endif // PRESENTATIONSCHEDULER_H
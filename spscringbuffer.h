@@ -0,0 +1,170 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+#ifndef SPSCRINGBUFFER_H
+#define SPSCRINGBUFFER_H
+
+// =============================================================================
+// File: spscringbuffer.h
+//
+// Description:
+// 该文件定义了 SpscRingBuffer 类模板，一个固定容量、预分配的
+// 单生产者/单消费者（SPSC）无锁环形缓冲区。用于在解码线程和
+// 播放线程之间传递视频帧和音频块，双方互不加锁。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/**
+ * @class SpscRingBuffer
+ * @brief 单生产者/单消费者无锁环形缓冲区。
+ *
+ * [线程约定]
+ * - push()、isFull() 只能由唯一的生产者线程调用。
+ * - front()、pop()、isEmpty() 只能由唯一的消费者线程调用。
+ * - size() 可由任意线程调用，返回的是一个近似值。
+ *
+ * [内存序]
+ * 生产者先写入槽位，再以 release 语义发布 tail；消费者以 acquire 语义
+ * 读取 tail 后才访问槽位。消费者同理以 release 语义发布 head，
+ * 生产者以 acquire 语义读取 head 后才复用槽位。因此槽位数据的读写
+ * 不需要任何锁。
+ *
+ * 所有槽位在构造时一次性分配，运行期间不再分配内存。
+ */
+template <typename T>
+class SpscRingBuffer
+{
+public:
+    /**
+     * @brief 构造函数。
+     * @param capacity 最多可同时容纳的元素个数。
+     */
+    explicit SpscRingBuffer(size_t capacity)
+        : slots(capacity + 1) // 多留一个空槽用于区分“满”和“空”
+    {
+    }
+
+    SpscRingBuffer(const SpscRingBuffer&) = delete;
+    SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+
+    /**
+     * @brief [生产者] 放入一个元素。
+     * @param item 要放入的元素（将被移动）。
+     * @return 缓冲区已满时返回false，此时 item 保持不变。
+     */
+    bool push(T &&item)
+    {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        const size_t next = increment(t);
+        if (next == head.load(std::memory_order_acquire)) return false;
+        slots[t] = std::move(item);
+        tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief [生产者] 判断缓冲区是否已满。
+     */
+    bool isFull() const
+    {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        return increment(t) == head.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief [消费者] 查看队首元素但不取出。
+     * @return 指向队首元素的指针；缓冲区为空时返回nullptr。
+     */
+    T *front()
+    {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return nullptr;
+        return &slots[h];
+    }
+
+    /**
+     * @brief [消费者] 取出队首元素。
+     *
+     * 取出后槽位会被重置为默认值，以便及时释放元素持有的资源
+     * （例如 cv::Mat 引用的帧缓冲）。
+     * @param out [out] 接收取出的元素。
+     * @return 缓冲区为空时返回false。
+     */
+    bool pop(T &out)
+    {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+        out = std::move(slots[h]);
+        slots[h] = T();
+        head.store(increment(h), std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief [消费者] 丢弃队首元素。
+     * @return 缓冲区为空时返回false。
+     */
+    bool discard()
+    {
+        T dropped;
+        return pop(dropped);
+    }
+
+    /**
+     * @brief [消费者] 判断缓冲区是否为空。
+     */
+    bool isEmpty() const
+    {
+        return head.load(std::memory_order_relaxed) == tail.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief 当前元素个数的近似值（可由任意线程调用，用于统计和显示）。
+     */
+    size_t size() const
+    {
+        const size_t h = head.load(std::memory_order_acquire);
+        const size_t t = tail.load(std::memory_order_acquire);
+        return (t + slots.size() - h) % slots.size();
+    }
+
+    /**
+     * @brief 缓冲区容量。
+     */
+    size_t capacity() const { return slots.size() - 1; }
+
+private:
+    size_t increment(size_t index) const { return (index + 1) % slots.size(); }
+
+    // 预分配的槽位
+    std::vector<T> slots;
+    // [关键变量] 读位置，只由消费者写入。与 tail 分处不同缓存行，避免伪共享。
+    alignas(64) std::atomic<size_t> head{0};
+    // [关键变量] 写位置，只由生产者写入。
+    alignas(64) std::atomic<size_t> tail{0};
+};
+
+#endif // SPSCRINGBUFFER_H
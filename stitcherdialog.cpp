@@ -110,11 +110,18 @@ QPixmap StitcherDialog::getFinalImage() const
         return QPixmap(); // 如果场景为空，返回空图像
     }
 
-    // 2. 创建一个与边界矩形大小相同、支持透明度的图像
+    // 2. 让所有图像项立即结束交互状态，确保导出时使用全分辨率原图而非缩略层
+    for (QGraphicsItem *graphicsItem : scene->items()) {
+        if (auto *item = qobject_cast<InteractivePixmapItem*>(graphicsItem->toGraphicsObject())) {
+            item->settle();
+        }
+    }
+
+    // 3. 创建一个与边界矩形大小相同、支持透明度的图像
     QImage image(bounds.size().toSize(), QImage::Format_ARGB32_Premultiplied);
     image.fill(Qt::transparent); // 用透明色填充背景
 
-    // 3. 使用QPainter将场景内容渲染到图像上
+    // 4. 使用QPainter将场景内容渲染到图像上
     QPainter painter(&image);
     painter.setRenderHint(QPainter::Antialiasing); // 启用抗锯齿以获得更高质量
     // scene->render 的最后一个参数指定了只渲染场景中的哪个源区域
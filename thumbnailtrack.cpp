@@ -0,0 +1,200 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+// =============================================================================
+// File: thumbnailtrack.cpp
+//
+// Description:
+// ThumbnailTrack 类的实现文件。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include "thumbnailtrack.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <algorithm>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+}
+
+// 缩略图宽度（像素），高度按宽高比计算
+static const int thumbnailWidth = 160;
+// 缩略图个数上限与最小采样间隔
+static const int maxThumbnails = 600;
+static const qint64 minIntervalMs = 1000;
+
+/**
+ * @brief ThumbnailTrack 构造函数。
+ */
+ThumbnailTrack::ThumbnailTrack(QObject *parent)
+    : QThread(parent)
+{
+}
+
+/**
+ * @brief ThumbnailTrack 析构函数，取消并等待后台线程。
+ */
+ThumbnailTrack::~ThumbnailTrack()
+{
+    cancelled.store(true, std::memory_order_relaxed);
+    wait();
+}
+
+/**
+ * @brief 在后台线程中生成缩略图轨道。
+ */
+void ThumbnailTrack::build(const QString &filePath, qint64 durationMs)
+{
+    clear();
+    sourcePath = filePath;
+    sourceDurationMs = durationMs;
+    cancelled.store(false, std::memory_order_relaxed);
+    start(QThread::LowestPriority);
+}
+
+/**
+ * @brief 取消生成并清空已有的缩略图。
+ */
+void ThumbnailTrack::clear()
+{
+    cancelled.store(true, std::memory_order_relaxed);
+    wait();
+    QMutexLocker locker(&mutex);
+    thumbnails.clear();
+}
+
+/**
+ * @brief 查找时间上最接近的缩略图。
+ */
+QImage ThumbnailTrack::thumbnailAt(qint64 ms) const
+{
+    QMutexLocker locker(&mutex);
+    if (thumbnails.empty()) return QImage();
+    auto it = std::lower_bound(thumbnails.begin(), thumbnails.end(), ms,
+                               [](const Thumbnail &t, qint64 value) { return t.ms < value; });
+    if (it == thumbnails.end()) return thumbnails.back().image;
+    if (it != thumbnails.begin() && ms - (it - 1)->ms < it->ms - ms) --it;
+    return it->image;
+}
+
+/**
+ * @brief 已生成的缩略图个数。
+ */
+int ThumbnailTrack::count() const
+{
+    QMutexLocker locker(&mutex);
+    return static_cast<int>(thumbnails.size());
+}
+
+/**
+ * @brief 后台线程主函数：按间隔跳转、只解码关键帧并缩小。
+ */
+void ThumbnailTrack::run()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    AVFormatContext *formatCtx = nullptr;
+    if (avformat_open_input(&formatCtx, sourcePath.toLocal8Bit().constData(), nullptr, nullptr) != 0) return;
+    if (avformat_find_stream_info(formatCtx, nullptr) < 0) { avformat_close_input(&formatCtx); return; }
+    const int streamIndex = av_find_best_stream(formatCtx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    if (streamIndex < 0) { avformat_close_input(&formatCtx); return; }
+    AVStream *stream = formatCtx->streams[streamIndex];
+    for (unsigned i = 0; i < formatCtx->nb_streams; ++i) {
+        if (static_cast<int>(i) != streamIndex) formatCtx->streams[i]->discard = AVDISCARD_ALL;
+    }
+
+    // 只解码关键帧；单线程解码避免与播放线程争抢CPU
+    const AVCodec *codec = avcodec_find_decoder(stream->codecpar->codec_id);
+    AVCodecContext *codecCtx = codec ? avcodec_alloc_context3(codec) : nullptr;
+    if (!codecCtx || avcodec_parameters_to_context(codecCtx, stream->codecpar) < 0) {
+        avcodec_free_context(&codecCtx); avformat_close_input(&formatCtx); return;
+    }
+    codecCtx->skip_frame = AVDISCARD_NONKEY;
+    codecCtx->thread_count = 1;
+    int lowres = 0;
+    while (lowres < codec->max_lowres && (codecCtx->width >> (lowres + 1)) >= thumbnailWidth) ++lowres;
+    codecCtx->lowres = lowres;
+    if (avcodec_open2(codecCtx, codec, nullptr) < 0) {
+        avcodec_free_context(&codecCtx); avformat_close_input(&formatCtx); return;
+    }
+
+    const qint64 intervalMs = std::max(minIntervalMs, sourceDurationMs / maxThumbnails);
+    const int thumbWidth = std::min(thumbnailWidth, std::max(1, stream->codecpar->width));
+    const int thumbHeight = std::max(2, static_cast<int>(static_cast<qint64>(thumbWidth) * stream->codecpar->height / std::max(1, stream->codecpar->width)) & ~1);
+    SwsContext *swsCtx = nullptr;
+    AVPacket *packet = av_packet_alloc();
+    AVFrame *frame = av_frame_alloc();
+    qint64 lastKeyPts = AV_NOPTS_VALUE;
+
+    for (qint64 ms = 0; ms <= sourceDurationMs && !cancelled.load(std::memory_order_relaxed); ms += intervalMs) {
+        if (av_seek_frame(formatCtx, streamIndex, av_rescale_q(ms, AVRational{1, 1000}, stream->time_base), AVSEEK_FLAG_BACKWARD) < 0) continue;
+        avcodec_flush_buffers(codecCtx);
+
+        // 跳转后的第一个视频包就是关键帧
+        bool gotPacket = false;
+        while (av_read_frame(formatCtx, packet) >= 0) {
+            if (packet->stream_index == streamIndex) { gotPacket = true; break; }
+            av_packet_unref(packet);
+        }
+        if (!gotPacket) break;
+        const qint64 keyPts = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+        // 长GOP时相邻间隔会落在同一个关键帧上，不重复解码
+        if (keyPts != AV_NOPTS_VALUE && lastKeyPts != AV_NOPTS_VALUE && keyPts <= lastKeyPts) {
+            av_packet_unref(packet);
+            continue;
+        }
+        lastKeyPts = keyPts;
+
+        // 送入关键帧后立即冲刷，解码器输出这一帧（无论其内部延迟多少帧）
+        avcodec_send_packet(codecCtx, packet);
+        av_packet_unref(packet);
+        avcodec_send_packet(codecCtx, nullptr);
+        if (avcodec_receive_frame(codecCtx, frame) != 0) continue;
+
+        swsCtx = sws_getCachedContext(swsCtx, frame->width, frame->height, static_cast<AVPixelFormat>(frame->format),
+                                      thumbWidth, thumbHeight, AV_PIX_FMT_RGB24, SWS_BILINEAR, nullptr, nullptr, nullptr);
+        if (!swsCtx) { av_frame_unref(frame); break; }
+        QImage image(thumbWidth, thumbHeight, QImage::Format_RGB888);
+        uint8_t *dest[] = { image.bits() };
+        int destLinesize[] = { static_cast<int>(image.bytesPerLine()) };
+        sws_scale(swsCtx, frame->data, frame->linesize, 0, frame->height, dest, destLinesize);
+
+        Thumbnail thumbnail;
+        const qint64 framePts = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : keyPts;
+        thumbnail.ms = framePts != AV_NOPTS_VALUE ? av_rescale_q(framePts, stream->time_base, AVRational{1, 1000}) : ms;
+        thumbnail.image = image;
+        av_frame_unref(frame);
+
+        QMutexLocker locker(&mutex);
+        if (thumbnails.empty() || thumbnails.back().ms < thumbnail.ms) thumbnails.push_back(std::move(thumbnail));
+    }
+
+    av_frame_free(&frame);
+    av_packet_free(&packet);
+    sws_freeContext(swsCtx);
+    avcodec_free_context(&codecCtx);
+    avformat_close_input(&formatCtx);
+    qDebug() << "缩略图轨道: 生成" << count() << "张，用时" << timer.elapsed() << "ms";
+}
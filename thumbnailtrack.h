@@ -0,0 +1,102 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+#ifndef THUMBNAILTRACK_H
+#define THUMBNAILTRACK_H
+
+// =============================================================================
+// File: thumbnailtrack.h
+//
+// Description:
+// 该文件定义了 ThumbnailTrack 类，在后台线程中只解码关键帧并生成
+// 低分辨率缩略图序列，拖动进度条时立即显示最近的缩略图。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include <QThread>
+#include <QImage>
+#include <QMutex>
+#include <atomic>
+#include <vector>
+
+/**
+ * @class ThumbnailTrack
+ * @brief 视频的关键帧缩略图轨道（快速预览拖动用）。
+ *
+ * [生成方式]
+ * 后台线程按固定间隔在视频流上向后跳转到最近的关键帧，只解码这一个关键帧
+ * （解码器设置为 AVDISCARD_NONKEY，支持时还启用 lowres），
+ * 缩小为宽度约160像素的 QImage。相邻间隔落在同一个关键帧上时不重复解码。
+ * 缩略图总数有上限，一小时的视频也只占用几十MB内存。
+ *
+ * [线程约定]
+ * 缩略图在生成过程中逐个追加，thumbnailAt() 可以在主线程中随时调用，
+ * 返回目前已生成的缩略图中时间最接近的一张。
+ */
+class ThumbnailTrack : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit ThumbnailTrack(QObject *parent = nullptr);
+    ~ThumbnailTrack();
+
+    /**
+     * @brief 在后台线程中为指定文件生成缩略图轨道（会先取消并等待上一次生成）。
+     * @param filePath 视频文件路径。
+     * @param durationMs 视频总时长（毫秒），用于确定采样间隔。
+     */
+    void build(const QString &filePath, qint64 durationMs);
+
+    /**
+     * @brief 取消生成并清空已有的缩略图。
+     */
+    void clear();
+
+    /**
+     * @brief 查找时间上最接近的缩略图。
+     * @param ms 时间点（毫秒）。
+     * @return 缩略图；还没有任何缩略图时返回空 QImage。
+     */
+    QImage thumbnailAt(qint64 ms) const;
+
+    /**
+     * @brief 已生成的缩略图个数。
+     */
+    int count() const;
+
+protected:
+    void run() override;
+
+private:
+    struct Thumbnail {
+        qint64 ms = 0;
+        QImage image;
+    };
+
+    QString sourcePath;               // 视频文件路径
+    qint64 sourceDurationMs = 0;      // 视频总时长
+    mutable QMutex mutex;             // 保护 thumbnails
+    std::vector<Thumbnail> thumbnails; // 按时间排序的缩略图
+    std::atomic<bool> cancelled{false};
+};
+
+#endif // THUMBNAILTRACK_H
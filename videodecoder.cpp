@@ -0,0 +1,1229 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+// =============================================================================
+// File: videodecoder.cpp
+//
+// Description:
+// VideoDecoder 类的实现文件（生产者一侧）。
+//
+// [流水线]
+//   解复用线程 --PacketQueue--> 视频解码线程 --SpscRingBuffer--> 主线程
+//              --PacketQueue--> 音频解码线程 --SpscRingBuffer--> 主线程
+// 解复用与解码分离后，单个码率尖峰的视频包不会再阻塞音频解码；
+// 视频解码器启用 FFmpeg 自身的帧级/片级多线程，
+// 像素格式转换则按水平条带交给 cv::parallel_for_ 并行执行。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include "videodecoder.h"
+#include <QDebug>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <opencv2/imgproc.hpp>
+
+// 包含 FFmpeg C语言头文件
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libswresample/swresample.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
+#include <libavutil/opt.h>
+}
+
+// 环形缓冲区容量。视频约为数秒的帧，音频为2秒的 48kHz 立体声 S16。
+static const size_t videoRingCapacity = 100;
+static const size_t presentRingCapacity = 4;
+static const qint64 audioRingBytes = 2 * 48000 * 2 * 2;
+// 数据包队列容量。只需覆盖解码器的输入抖动，不必太大。
+static const int videoPacketCapacity = 64;
+static const int audioPacketCapacity = 128;
+// 解码器 lowres 的最高级别（1/8 尺寸）
+static const int maxLowresLevel = 3;
+// 视频帧缓冲池的默认字节上限。按帧数限制时4K BGR24的100帧约需2.5GB，
+// 按字节限制后高分辨率视频只会缓冲较少的帧，内存占用有硬上限。
+static const size_t defaultFrameBudgetBytes = 256 * 1024 * 1024;
+// GOP 缓存的默认字节上限。I420 每像素1.5字节，720p 画面约可缓存90帧。
+static const size_t defaultGopCacheBytes = 128 * 1024 * 1024;
+// 预取模式下的帧缓冲池限额：只够缓冲开头的十来帧，闲置的解码器不占用太多内存
+static const size_t prefetchFrameBudgetBytes = 32 * 1024 * 1024;
+// 效果线程外推播放时钟的上限（毫秒）。主线程卡住时不会因为外推过头而丢掉所有帧。
+static const qint64 maxClockExtrapolationMs = 200;
+
+/**
+ * @class ParallelSwsConverter
+ * @brief 按水平条带并行执行的像素格式转换器（源格式 -> BGR24）。
+ *
+ * 单个 SwsContext 不能被多个线程同时使用，因此把图像分成若干条带，
+ * 每个条带拥有自己的 SwsContext，由 cv::parallel_for_ 并行转换。
+ * 条带边界按色度子采样的行数对齐（4:2:0 为2行），
+ * 保证每个条带的色度平面起始行是整数。调色板格式只使用一个条带。
+ * 源尺寸、源格式或目标尺寸变化时自动重建。
+ */
+class ParallelSwsConverter
+{
+public:
+    ParallelSwsConverter() = default;
+    ParallelSwsConverter(const ParallelSwsConverter&) = delete;
+    ParallelSwsConverter& operator=(const ParallelSwsConverter&) = delete;
+    ~ParallelSwsConverter() { release(); }
+
+    /**
+     * @brief 将解码帧转换并写入 BGR24 的目标 Mat（目标尺寸即输出尺寸）。
+     * @return 成功返回true。
+     */
+    bool convert(const AVFrame *src, cv::Mat &dst)
+    {
+        if (src->width != srcWidth || src->height != srcHeight || src->format != srcFormat
+            || dst.cols != dstWidth || dst.rows != dstHeight) {
+            if (!configure(src->width, src->height, src->format, dst.cols, dst.rows)) return false;
+        }
+        if (bands.size() == 1) {
+            scaleBand(bands[0], src, dst);
+            return true;
+        }
+        cv::parallel_for_(cv::Range(0, static_cast<int>(bands.size())), [&](const cv::Range &range) {
+            for (int i = range.start; i < range.end; ++i) scaleBand(bands[i], src, dst);
+        });
+        return true;
+    }
+
+private:
+    struct Band {
+        SwsContext *context = nullptr;
+        int srcY = 0, srcRows = 0; // 源图像中的起始行与行数
+        int dstY = 0;              // 目标图像中的起始行
+    };
+
+    // 每个条带至少包含的目标行数，太细的条带线程调度开销大于收益
+    static const int minBandRows = 64;
+
+    bool configure(int width, int height, int format, int outWidth, int outHeight)
+    {
+        release();
+        const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(static_cast<AVPixelFormat>(format));
+        if (!desc || width <= 0 || height <= 0 || outWidth <= 0 || outHeight <= 0) return false;
+
+        chromaShift = desc->log2_chroma_h;
+        const int align = 1 << chromaShift;
+        int bandCount = 1;
+        if (!(desc->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_HWACCEL))) {
+            bandCount = std::clamp(std::min(height, outHeight) / minBandRows, 1, std::max(1, cv::getNumThreads()));
+        }
+
+        for (int i = 0; i < bandCount; ++i) {
+            const int srcY0 = static_cast<int>(static_cast<qint64>(height) * i / bandCount) & ~(align - 1);
+            const int srcY1 = (i + 1 == bandCount) ? height
+                                                   : static_cast<int>(static_cast<qint64>(height) * (i + 1) / bandCount) & ~(align - 1);
+            const int dstY0 = static_cast<int>(static_cast<qint64>(srcY0) * outHeight / height);
+            const int dstY1 = (i + 1 == bandCount) ? outHeight : static_cast<int>(static_cast<qint64>(srcY1) * outHeight / height);
+            if (srcY1 <= srcY0 || dstY1 <= dstY0) continue;
+
+            Band band;
+            band.context = sws_getContext(width, srcY1 - srcY0, static_cast<AVPixelFormat>(format),
+                                          outWidth, dstY1 - dstY0, AV_PIX_FMT_BGR24,
+                                          SWS_BILINEAR, nullptr, nullptr, nullptr);
+            if (!band.context) { release(); return false; }
+            band.srcY = srcY0;
+            band.srcRows = srcY1 - srcY0;
+            band.dstY = dstY0;
+            bands.push_back(band);
+        }
+        if (bands.empty()) return false;
+
+        srcWidth = width; srcHeight = height; srcFormat = format;
+        dstWidth = outWidth; dstHeight = outHeight;
+        return true;
+    }
+
+    void scaleBand(const Band &band, const AVFrame *src, cv::Mat &dst) const
+    {
+        const uint8_t *srcPlanes[4] = {};
+        int srcStrides[4] = {};
+        for (int p = 0; p < 4; ++p) {
+            if (!src->data[p]) continue;
+            // 只有两个色度平面按垂直子采样缩行，亮度与alpha平面不缩
+            const int rowShift = (p == 1 || p == 2) ? chromaShift : 0;
+            srcPlanes[p] = src->data[p] + static_cast<ptrdiff_t>(band.srcY >> rowShift) * src->linesize[p];
+            srcStrides[p] = src->linesize[p];
+        }
+        uint8_t *dstPlanes[4] = { dst.ptr(band.dstY), nullptr, nullptr, nullptr };
+        int dstStrides[4] = { static_cast<int>(dst.step), 0, 0, 0 };
+        sws_scale(band.context, srcPlanes, srcStrides, 0, band.srcRows, dstPlanes, dstStrides);
+    }
+
+    void release()
+    {
+        for (Band &band : bands) sws_freeContext(band.context);
+        bands.clear();
+        srcWidth = srcHeight = dstWidth = dstHeight = 0;
+        srcFormat = -1;
+    }
+
+    std::vector<Band> bands;
+    int srcWidth = 0, srcHeight = 0, srcFormat = -1;
+    int dstWidth = 0, dstHeight = 0;
+    int chromaShift = 0;
+};
+
+/**
+ * @brief 把 FFmpeg 错误码转换为可读的错误描述。
+ */
+static QString ffmpegErrorString(int errnum)
+{
+    char buffer[AV_ERROR_MAX_STRING_SIZE] = {};
+    av_strerror(errnum, buffer, sizeof(buffer));
+    return QString::fromUtf8(buffer);
+}
+
+/**
+ * @brief 单调时钟的当前时刻（纳秒），用于测量跳转耗时。
+ */
+static qint64 steadyNowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief 取得解码帧以毫秒为单位的显示时间戳。
+ *
+ * 帧级多线程和B帧重排后 frame->pts 可能缺失，优先使用 best_effort_timestamp。
+ */
+static qint64 framePtsMs(const AVFrame *frame, AVRational timeBase)
+{
+    int64_t pts = frame->best_effort_timestamp;
+    if (pts == AV_NOPTS_VALUE) pts = frame->pts;
+    if (pts == AV_NOPTS_VALUE) return 0;
+    return av_rescale_q(pts, timeBase, AVRational{1, 1000});
+}
+
+/**
+ * @brief VideoDecoder 构造函数。
+ *
+ * 一次性预分配两个数据包队列和各个环形缓冲区的全部槽位。
+ */
+VideoDecoder::VideoDecoder(QObject* parent)
+    : QThread(parent), gopCache(defaultGopCacheBytes),
+      videoPackets(videoPacketCapacity), audioPackets(audioPacketCapacity),
+      videoRing(videoRingCapacity), presentRing(presentRingCapacity), audioRing(audioRingBytes), framePool(defaultFrameBudgetBytes) {}
+
+/**
+ * @brief VideoDecoder 析构函数。
+ *
+ * 确保线程在对象销毁前被安全地停止和等待。这是一个良好实践，
+ * 可以防止悬挂线程或资源泄漏。
+ */
+VideoDecoder::~VideoDecoder() {
+    stop(); // 设置停止标志
+    wait(); // 等待run()函数执行完毕
+}
+
+/**
+ * @brief 启动解码过程。
+ *
+ * 阻塞到解码线程打开文件和解码器为止，耗时只取决于FFmpeg解析流信息本身。
+ * @param filePath 要解码的视频文件路径。
+ * @return 如果文件成功打开、音视频解码器均可用，则返回true；失败原因见 errorString()。
+ */
+bool VideoDecoder::startDecoding(const QString &filePath) {
+    startDecodingAsync(filePath);
+    return waitForOpened();
+}
+
+/**
+ * @brief 启动解码线程，不等待打开结果。
+ * @param filePath 要解码的视频文件路径。
+ */
+void VideoDecoder::startDecodingAsync(const QString &filePath) {
+    // 如果上一个解码线程还在运行，先停止并等待它结束
+    if (isRunning()) {
+        stop();
+        wait();
+    }
+    // 设置新的文件路径和状态
+    sourcePath = filePath;
+    stopped.store(false, std::memory_order_release);
+    seekRequest.store(-1, std::memory_order_release);
+    seekTargetMs.store(-1, std::memory_order_relaxed);
+    {
+        QMutexLocker locker(&openMutex);
+        openState = OpenState::Pending;
+        openError.clear();
+    }
+    // 启动新线程，Qt会自动调用run()方法
+    start();
+}
+
+/**
+ * @brief 等待 run() 报告打开结果。
+ * @return 打开成功返回true。
+ */
+bool VideoDecoder::waitForOpened() {
+    QMutexLocker locker(&openMutex);
+    while (openState == OpenState::Pending) {
+        openCondition.wait(&openMutex);
+    }
+    return openState == OpenState::Ready;
+}
+
+/**
+ * @brief 最近一次 startDecoding() 失败的原因。
+ */
+QString VideoDecoder::errorString() const {
+    QMutexLocker locker(&openMutex);
+    return openError;
+}
+
+/**
+ * @brief [解复用线程] 报告打开结果并唤醒 waitForOpened()。
+ * @param success 是否成功。
+ * @param error 失败原因。
+ */
+void VideoDecoder::reportOpenResult(bool success, const QString &error) {
+    if (!success) qWarning() << "FFmpeg:" << error;
+    QMutexLocker locker(&openMutex);
+    openState = success ? OpenState::Ready : OpenState::Failed;
+    openError = error;
+    openCondition.wakeAll();
+}
+
+/**
+ * @brief 请求停止所有解码线程。
+ *
+ * 设置停止标志并中止两个数据包队列，唤醒阻塞在队列和流控条件变量上的
+ * 解复用/解码线程，各线程在下一次检查时自行退出。
+ */
+void VideoDecoder::stop() {
+    stopped.store(true, std::memory_order_release);
+    videoPackets.abort();
+    audioPackets.abort();
+    wakeWaitingThreads(true);
+}
+
+/**
+ * @brief 请求跳转到指定时间点。
+ *
+ * 这是一个线程安全的异步跳转请求。它设置请求的时间点，打断解复用线程
+ * 可能正在进行的阻塞写入（或文件末尾的空闲等待），让它尽快回到循环开头
+ * 执行实际的跳转操作；等待缓冲区空位的解码线程也会被唤醒并放弃旧数据。
+ * @param ms 目标时间点（毫秒）。
+ * @param fillGopCache 是否把预解码帧也存入 GOP 缓存。
+ */
+void VideoDecoder::seek(qint64 ms, bool fillGopCache) {
+    seekStartNs.store(steadyNowNs(), std::memory_order_relaxed);
+    seekFillRequest.store(fillGopCache, std::memory_order_relaxed);
+    // 跳转后旧的时钟不再有效，播放端发布新时钟之前不丢帧
+    presentationClockMs.store(-1, std::memory_order_release);
+    seekRequest.store(ms, std::memory_order_release);
+    videoPackets.interruptPut();
+    audioPackets.interruptPut();
+    wakeWaitingThreads(true);
+}
+
+/**
+ * @brief 配置视频解码器的多线程方式。
+ * @param threadCount 解码线程数，0 表示自动。
+ * @param frameThreading 是否启用帧级多线程。
+ * @param sliceThreading 是否启用片级多线程。
+ */
+void VideoDecoder::setDecoderThreading(int threadCount, bool frameThreading, bool sliceThreading) {
+    decoderThreadCount = std::max(0, threadCount);
+    frameThreadingEnabled = frameThreading;
+    sliceThreadingEnabled = sliceThreading;
+}
+
+/**
+ * @brief 设置呈现尺寸。
+ * @param width 视图宽度（物理像素），<=0 表示不缩小。
+ * @param height 视图高度（物理像素），<=0 表示不缩小。
+ */
+void VideoDecoder::setTargetSize(int width, int height) {
+    targetWidth.store(std::max(0, width), std::memory_order_relaxed);
+    targetHeight.store(std::max(0, height), std::memory_order_relaxed);
+}
+
+/**
+ * @brief 设置是否始终输出原始分辨率。
+ */
+void VideoDecoder::setFullResolution(bool enabled) {
+    fullResolution.store(enabled, std::memory_order_relaxed);
+}
+
+/**
+ * @brief [视频解码线程] 计算输出帧的尺寸。
+ *
+ * 把原始尺寸按比例缩小到刚好放进呈现尺寸（不放大），宽高取偶数。
+ * 未设置呈现尺寸或要求原始分辨率时返回原始尺寸。
+ */
+cv::Size VideoDecoder::outputSize() const {
+    const int viewWidth = targetWidth.load(std::memory_order_relaxed);
+    const int viewHeight = targetHeight.load(std::memory_order_relaxed);
+    if (fullResolution.load(std::memory_order_relaxed) || viewWidth <= 0 || viewHeight <= 0
+        || (viewWidth >= sourceWidth && viewHeight >= sourceHeight)) {
+        return cv::Size(sourceWidth, sourceHeight);
+    }
+    const double scale = std::min(static_cast<double>(viewWidth) / sourceWidth, static_cast<double>(viewHeight) / sourceHeight);
+    const int width = std::max(2, static_cast<int>(sourceWidth * scale) & ~1);
+    const int height = std::max(2, static_cast<int>(sourceHeight * scale) & ~1);
+    return cv::Size(width, height);
+}
+
+/**
+ * @brief [视频解码线程] 选择解码器的 lowres 级别。
+ *
+ * 取使解码输出仍不小于输出尺寸的最大级别，之后的 sws_scale 只需做少量缩小。
+ * H.264/HEVC 等解码器不支持 lowres（max_lowres 为0），此时只依靠 sws_scale 缩小。
+ */
+int VideoDecoder::desiredLowres() const {
+    const int maxLowres = std::min<int>(videoCodecCtx->codec->max_lowres, maxLowresLevel);
+    if (maxLowres <= 0) return 0;
+    const cv::Size out = outputSize();
+    int lowres = 0;
+    while (lowres < maxLowres
+           && AV_CEIL_RSHIFT(sourceWidth, lowres + 1) >= out.width
+           && AV_CEIL_RSHIFT(sourceHeight, lowres + 1) >= out.height) {
+        ++lowres;
+    }
+    return lowres;
+}
+
+/**
+ * @brief 从视频缓冲区中获取与当前音频时间戳最匹配的视频帧。
+ *
+ * 这是实现音视频同步的关键部分。它以音频播放进度为基准，
+ * 从视频缓冲区中找到时间上最接近的一帧。只能由消费者（主线程）调用，
+ * 全程不加锁，解码线程可以同时继续写入。
+ * @param audio_pts 当前音频播放的时间戳（毫秒）。
+ * @param framePts [out] 可选，返回帧的时间戳（毫秒），没有新帧时保持不变。
+ * @return 匹配的视频帧 (cv::Mat)。
+ */
+cv::Mat VideoDecoder::getVideoFrame(qint64 audio_pts, qint64 *framePts, int *skippedFrames) {
+    const int currentSerial = serial.load(std::memory_order_acquire);
+    cv::Mat frame;
+    // 循环丢弃所有时间戳小于等于当前音频时间戳的“过时”视频帧。
+    // 这确保了视频不会落后于音频。跳转前产生的旧帧无条件丢弃。
+    // 当队首帧的时间戳已经超前于音频时停止，上一次取出的帧就是最佳匹配。
+    while (VideoFrame *head = presentRing.front()) {
+        if (head->serial != currentSerial) { presentRing.discard(); continue; }
+        if (head->pts > audio_pts) break;
+        VideoFrame vf;
+        presentRing.pop(vf);
+        // 被更新的帧取代、从未显示过的帧计为跳过
+        if (!frame.empty() && skippedFrames) ++*skippedFrames;
+        frame = vf.frame;
+        if (framePts) *framePts = vf.pts;
+    }
+    // 腾出了缓冲区空位，上一次返回的帧也已被播放端释放，唤醒可能在等待的解码线程
+    wakeWaitingThreads(false);
+    return frame; // 返回找到的最佳匹配帧，或者空帧
+}
+
+/**
+ * @brief 待显示缓冲区中下一帧的时间戳，跳转前的旧帧被直接丢弃。
+ */
+qint64 VideoDecoder::nextFramePts() {
+    const int currentSerial = serial.load(std::memory_order_acquire);
+    while (VideoFrame *head = presentRing.front()) {
+        if (head->serial == currentSerial) return head->pts;
+        presentRing.discard();
+    }
+    return -1;
+}
+
+/**
+ * @brief 切换预取模式。
+ * @param enabled 为true时帧缓冲池限额降为 prefetchFrameBudgetBytes 并停用 GOP 缓存，为false时恢复默认限额。
+ */
+void VideoDecoder::setPrefetchMode(bool enabled) {
+    framePool.setBudget(enabled ? prefetchFrameBudgetBytes : defaultFrameBudgetBytes);
+    // 闲置的解码器不需要 GOP 缓存，限额为0时已缓存的画面也随之释放
+    gopCache.setBudget(enabled ? 0 : defaultGopCacheBytes);
+    // 解码线程可能正因限额已满而等待
+    if (!enabled) wakeWaitingThreads(true);
+}
+
+/**
+ * @brief 丢弃待显示缓冲区中跳转前的旧帧。
+ *
+ * 闲置的解码器跳转后没有播放端取帧，旧帧会一直占满待显示缓冲区，
+ * 效果线程因此无法继续处理新位置的帧。
+ */
+void VideoDecoder::discardStaleFrames() {
+    nextFramePts();
+    wakeWaitingThreads(false);
+}
+
+/**
+ * @brief 发布播放端的主时钟。
+ */
+void VideoDecoder::setPresentationClock(qint64 clockMs, double rate) {
+    presentationRatePermille.store(qRound(rate * 1000), std::memory_order_relaxed);
+    presentationClockNs.store(steadyNowNs(), std::memory_order_relaxed);
+    presentationClockMs.store(clockMs, std::memory_order_release);
+}
+
+/**
+ * @brief 读取当前序号的 PCM 数据。
+ *
+ * 只能由消费者（AudioPullDevice）调用。跳转请求尚未被解复用线程处理时，
+ * 缓冲区中的数据都属于旧位置，此时不返回任何数据，以免跳转后先播放一段旧音频。
+ * @param data [out] 接收数据的缓冲区。
+ * @param maxSize 最多读取的字节数。
+ * @return 实际读取的字节数。
+ */
+qint64 VideoDecoder::readAudio(char *data, qint64 maxSize) {
+    if (seekRequest.load(std::memory_order_acquire) != -1) return 0;
+    // 只读取完整的采样帧（立体声 S16 每帧4字节）
+    const qint64 n = audioRing.read(data, maxSize & ~qint64(3), serial.load(std::memory_order_acquire));
+    wakeWaitingThreads(false);
+    if (n > 0) {
+        if (const std::shared_ptr<const AudioTap> tap = std::atomic_load(&audioTap)) (*tap)(data, n);
+    }
+    return n;
+}
+
+/**
+ * @brief 设置是否输出音频。关闭时唤醒可能正在等待空位的音频解码线程，让它丢弃数据继续解码。
+ */
+void VideoDecoder::setAudioOutputEnabled(bool enabled) {
+    audioOutputEnabled.store(enabled, std::memory_order_release);
+    if (!enabled) wakeWaitingThreads(true);
+}
+
+/**
+ * @brief 设置音频观察回调（任意线程）。
+ */
+void VideoDecoder::setAudioTap(AudioTap tap) {
+    std::shared_ptr<const AudioTap> newTap;
+    if (tap) newTap = std::make_shared<const AudioTap>(std::move(tap));
+    std::atomic_store(&audioTap, std::move(newTap));
+}
+
+/**
+ * @brief 判断某个序号产生的数据是否已经作废。
+ *
+ * 停止后所有数据都作废；发生新的跳转（或跳转请求尚未处理）时，
+ * 旧序号的数据即使写入缓冲区也会被消费者丢弃。
+ */
+bool VideoDecoder::isStale(int itemSerial) const {
+    return stopped.load(std::memory_order_acquire)
+           || seekRequest.load(std::memory_order_acquire) != -1
+           || itemSerial != serial.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief [解码线程] 在流控条件变量上等待，直到 ready() 返回true。
+ *
+ * 先登记等待者再检查条件，消费者则先修改状态再检查等待者，
+ * 两侧之间各有一道全序内存栅栏，因此不会出现“条件已满足却没人唤醒”的情况。
+ * ready() 在持有 flowMutex 时调用。
+ */
+template <typename Ready>
+void VideoDecoder::waitUntil(Ready ready) {
+    waitingThreads.fetch_add(1, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    {
+        QMutexLocker locker(&flowMutex);
+        while (!ready()) {
+            flowCondition.wait(&flowMutex);
+        }
+    }
+    waitingThreads.fetch_sub(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief 唤醒在流控条件变量上等待的线程。
+ *
+ * 消费者每次取数据后调用（force 为false）：没有线程等待时只有一道栅栏和一次原子读取。
+ * 停止和跳转时以 force 为true调用，无条件唤醒。
+ */
+void VideoDecoder::wakeWaitingThreads(bool force) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!force && waitingThreads.load(std::memory_order_relaxed) == 0) return;
+    QMutexLocker locker(&flowMutex);
+    flowCondition.wakeAll();
+}
+
+/**
+ * @brief [解码线程] 将数据放入环形缓冲区。
+ *
+ * 缓冲区满时在条件变量上等待，直到消费者腾出空间；期间若这份数据已经作废
+ * （停止或跳转）则放弃本次写入。
+ * @return 成功写入返回true。
+ */
+template <typename T>
+bool VideoDecoder::pushWhenReady(SpscRingBuffer<T> &ring, T &&item) {
+    bool pushed = ring.push(std::move(item));
+    if (!pushed) {
+        waitUntil([&] {
+            pushed = ring.push(std::move(item));
+            return pushed || isStale(item.serial);
+        });
+    }
+    // 下游的效果线程可能正在等待新数据
+    if (pushed) wakeWaitingThreads(false);
+    return pushed;
+}
+
+/**
+ * @brief [视频解码线程] 从帧缓冲池取出一块BGR24缓冲。
+ *
+ * 池已达到字节上限时，说明缓冲区和播放端仍持有足够多的帧，
+ * 此时等待播放端释放旧帧（播放端每次取帧时唤醒）；期间若这一帧已经作废则返回空 Mat。
+ * @param rows 帧高度。
+ * @param cols 帧宽度。
+ * @param frameSerial 这一帧所属的跳转序号。
+ * @return 可直接写入的缓冲。
+ */
+cv::Mat VideoDecoder::acquireFrameBuffer(int rows, int cols, int frameSerial) {
+    // 限额被调低（进入预取模式）后，池中已有的缓冲仍会被复用，这里先释放空闲的部分
+    if (framePool.allocatedBytes() > framePool.budget()) framePool.trim();
+    cv::Mat buffer = framePool.acquire(rows, cols, CV_8UC3);
+    if (!buffer.empty()) return buffer;
+    waitUntil([&] {
+        buffer = framePool.acquire(rows, cols, CV_8UC3);
+        return !buffer.empty() || isStale(frameSerial);
+    });
+    return buffer;
+}
+
+/**
+ * @brief 打开指定流的解码器。
+ * @param streamIndex 流索引。
+ * @param codecCtx [out] 打开成功的解码器上下文（失败时也可能已分配，由调用者释放）。
+ * @param threaded 是否应用多线程配置（只对视频解码器启用）。
+ * @param lowres 解码缩小级别（0 为原始尺寸，n 为 1/2^n），超出解码器支持范围时自动截断。
+ * @return 成功返回true。
+ */
+bool VideoDecoder::openCodec(int streamIndex, AVCodecContext** codecCtx, bool threaded, int lowres) {
+    AVCodecParameters* codecParams = formatCtx->streams[streamIndex]->codecpar;
+    const AVCodec* codec = avcodec_find_decoder(codecParams->codec_id);
+    if (!codec) return false;
+    *codecCtx = avcodec_alloc_context3(codec);
+    if (!*codecCtx) return false;
+    avcodec_parameters_to_context(*codecCtx, codecParams);
+    (*codecCtx)->pkt_timebase = formatCtx->streams[streamIndex]->time_base;
+    (*codecCtx)->lowres = std::clamp(lowres, 0, static_cast<int>(codec->max_lowres));
+    if (threaded) {
+        int threadType = 0;
+        if (frameThreadingEnabled) threadType |= FF_THREAD_FRAME;
+        if (sliceThreadingEnabled) threadType |= FF_THREAD_SLICE;
+        // thread_count 为0时由 FFmpeg 按CPU核心数自动选择
+        (*codecCtx)->thread_count = threadType ? decoderThreadCount : 1;
+        (*codecCtx)->thread_type = threadType;
+    }
+    return avcodec_open2(*codecCtx, codec, nullptr) >= 0;
+}
+
+/**
+ * @brief 解复用线程的主函数。这是在新线程中执行的所有代码。
+ *
+ * 打开文件和两个解码器，启动视频/音频解码线程，然后进入解复用循环；
+ * 停止时中止队列、等待两个解码线程退出后再释放 FFmpeg 资源。
+ */
+void VideoDecoder::run() {
+    // --- 1. 初始化 FFmpeg ---
+    formatCtx = nullptr;
+    // 打开输入文件并读取头信息
+    int result = avformat_open_input(&formatCtx, sourcePath.toLocal8Bit().constData(), nullptr, nullptr);
+    if (result != 0) {
+        reportOpenResult(false, QString("无法打开文件 %1：%2").arg(sourcePath, ffmpegErrorString(result))); return;
+    }
+    // 查找流信息
+    result = avformat_find_stream_info(formatCtx, nullptr);
+    if (result < 0) {
+        reportOpenResult(false, QString("无法找到流信息：%1").arg(ffmpegErrorString(result)));
+        avformat_close_input(&formatCtx); return;
+    }
+
+    // --- 2. 查找并打开音视频解码器 ---
+    videoStreamIndex = av_find_best_stream(formatCtx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    audioStreamIndex = av_find_best_stream(formatCtx, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+    if (videoStreamIndex < 0 || audioStreamIndex < 0) {
+        reportOpenResult(false, videoStreamIndex < 0 ? QString("文件中没有视频流") : QString("文件中没有音频流"));
+        avformat_close_input(&formatCtx); return;
+    }
+    if (!openCodec(videoStreamIndex, &videoCodecCtx, true)) {
+        reportOpenResult(false, QString("无法打开视频解码器（%1）").arg(avcodec_get_name(formatCtx->streams[videoStreamIndex]->codecpar->codec_id)));
+        avcodec_free_context(&videoCodecCtx); avformat_close_input(&formatCtx); return;
+    }
+    if (!openCodec(audioStreamIndex, &audioCodecCtx, false)) {
+        reportOpenResult(false, QString("无法打开音频解码器（%1）").arg(avcodec_get_name(formatCtx->streams[audioStreamIndex]->codecpar->codec_id)));
+        avcodec_free_context(&videoCodecCtx); avcodec_free_context(&audioCodecCtx); avformat_close_input(&formatCtx); return;
+    }
+    sourceWidth = videoCodecCtx->width;
+    sourceHeight = videoCodecCtx->height;
+    videoFPS = av_q2d(formatCtx->streams[videoStreamIndex]->r_frame_rate);
+    if (videoFPS <= 0) videoFPS = 25; // 提供一个备用FPS
+    qDebug() << "视频解码器:" << videoCodecCtx->codec->name << "线程数" << videoCodecCtx->thread_count
+             << "线程类型" << videoCodecCtx->active_thread_type;
+    // 流式文件可能没有时长信息，此时记为0
+    durationMs = formatCtx->duration != AV_NOPTS_VALUE ? formatCtx->duration / (AV_TIME_BASE / 1000) : 0;
+
+    // --- 3. 启动解码线程 ---
+    const int startSerial = serial.load(std::memory_order_relaxed);
+    videoPackets.start(startSerial);
+    audioPackets.start(startSerial);
+    QThread* videoThread = QThread::create([this] { videoDecodeLoop(); });
+    QThread* effectThread = QThread::create([this] { effectLoop(); });
+    QThread* audioThread = QThread::create([this] { audioDecodeLoop(); });
+    videoThread->start();
+    effectThread->start();
+    audioThread->start();
+    // 元数据均已就绪，通知 startDecoding() 返回
+    reportOpenResult(true);
+    // 关键帧索引在低优先级线程中建立，就绪前跳转退回 FFmpeg 自身的定位方式
+    keyframeIndex.build(sourcePath);
+
+    // --- 4. 解复用循环（直到停止） ---
+    demuxLoop();
+
+    // --- 5. 停止解码线程并清理所有FFmpeg资源 ---
+    keyframeIndex.cancel();
+    videoPackets.abort();
+    audioPackets.abort();
+    videoThread->wait();
+    effectThread->wait();
+    audioThread->wait();
+    delete videoThread;
+    delete effectThread;
+    delete audioThread;
+    keyframeIndex.wait();
+    avcodec_free_context(&videoCodecCtx); avcodec_free_context(&audioCodecCtx); avformat_close_input(&formatCtx);
+    qDebug() << "解码线程已结束。";
+}
+
+/**
+ * @brief [解复用线程] 读取数据包并分发到两个数据包队列。
+ *
+ * 写入因队列已满而阻塞时，跳转请求会打断这次写入；未写入的数据包保留到
+ * 下一次循环。读到文件末尾后写入结束标记，然后在条件变量上等待跳转或停止，
+ * 因此在播放结束后仍然可以跳回去重新播放。
+ */
+void VideoDecoder::demuxLoop() {
+    AVPacket* packet = av_packet_alloc();
+    bool packetPending = false;      // packet 中是否有尚未写入队列的数据包
+    bool reachedEof = false;
+    bool videoEofSent = false, audioEofSent = false;
+    const AVRational videoTimeBase = formatCtx->streams[videoStreamIndex]->time_base;
+    const qint64 halfFrameMs = static_cast<qint64>(500.0 / videoFPS);
+    // 跳转命中 GOP 缓存时，缓存已覆盖到的时间（下一个关键帧），早于它的视频包不必再解码；未命中时为-1
+    qint64 cachedUntilMs = -1;
+    bool cacheMarkerPending = false; // 命中缓存后的标记包是否还未写入
+    bool awaitingKeyframe = false;   // 是否还在等待缓存终点处的关键帧
+    bool dropUntilKeyframe = false;  // 只解码关键帧的模式刚结束，继续丢弃视频包直到下一个关键帧
+
+    while (!stopped.load(std::memory_order_acquire)) {
+        // a. 处理跳转请求
+        const qint64 seekMs = seekRequest.exchange(-1, std::memory_order_acq_rel);
+        if (seekMs != -1) {
+            // 定位到目标之前最近的关键帧（命中缓存时音频仍要从这里开始）
+            seekTo(seekMs);
+            // 解码线程看到新序号时读取这个目标，丢弃目标之前的输出
+            seekTargetMs.store(seekMs, std::memory_order_relaxed);
+            seekFillGop.store(seekFillRequest.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            const int newSerial = serial.load(std::memory_order_relaxed) + 1;
+            // 查找 GOP 缓存：命中时把画面交给解码线程，这个 GOP 剩下的视频包直接丢弃
+            std::vector<DecodedGopCache::Frame> segment;
+            if (!gopCache.lookup(seekMs, outputSize(), halfFrameMs, segment, cachedUntilMs)) cachedUntilMs = -1;
+            awaitingKeyframe = cachedUntilMs >= 0;
+            dropUntilKeyframe = false; // 跳转后本来就从关键帧开始
+            {
+                QMutexLocker locker(&cachedSegmentMutex);
+                cachedSegmentSerial = cachedUntilMs >= 0 ? newSerial : -1;
+                cachedSegment.swap(segment);
+            }
+            // 丢弃队列中跳转前的数据包；解码线程看到新序号后会自行清空解码器内部缓冲
+            videoPackets.flush(newSerial);
+            audioPackets.flush(newSerial);
+            // 环形缓冲区只能由消费者清空，这里只递增序号，让旧数据在被取出时自动作废
+            serial.store(newSerial, std::memory_order_release);
+            // 命中时先放入一个标记包，解码线程不必等到下一个关键帧的数据包就能开始输出缓存的画面
+            cacheMarkerPending = cachedUntilMs >= 0;
+            // 唤醒仍在为旧序号数据等待空位的解码线程
+            wakeWaitingThreads(true);
+            av_packet_unref(packet);
+            packetPending = false;
+            reachedEof = videoEofSent = audioEofSent = false;
+            // 通知主线程跳转已完成
+            emit seekFinished();
+        }
+
+        // 标记包的写入被打断（又有新的跳转）时在下一轮重试，新的跳转会重新决定是否还需要它
+        if (cacheMarkerPending) {
+            cacheMarkerPending = !videoPackets.putEof();
+            if (cacheMarkerPending) continue;
+        }
+
+        // b. 文件已读完：补发结束标记后空闲等待
+        if (reachedEof) {
+            if (!videoEofSent) videoEofSent = videoPackets.putEof();
+            if (!audioEofSent) audioEofSent = audioPackets.putEof();
+            if (videoEofSent && audioEofSent) {
+                waitUntil([this] {
+                    return stopped.load(std::memory_order_acquire) || seekRequest.load(std::memory_order_acquire) != -1;
+                });
+            }
+            continue;
+        }
+
+        // c. 从文件中读取一个数据包 (packet)
+        if (!packetPending) {
+            if (av_read_frame(formatCtx, packet) < 0) { reachedEof = true; continue; } // 文件读完或出错
+            if (packet->stream_index != videoStreamIndex && packet->stream_index != audioStreamIndex) {
+                av_packet_unref(packet);
+                continue;
+            }
+            // 缓存已覆盖的视频包：丢弃到缓存终点处的关键帧为止，之后还要丢弃属于缓存范围的前导帧
+            if (packet->stream_index == videoStreamIndex && cachedUntilMs >= 0) {
+                const qint64 packetMs = packet->pts != AV_NOPTS_VALUE ? av_rescale_q(packet->pts, videoTimeBase, AVRational{1, 1000}) : -1;
+                if (awaitingKeyframe && (packet->flags & AV_PKT_FLAG_KEY) && packetMs + halfFrameMs >= cachedUntilMs) awaitingKeyframe = false;
+                if (awaitingKeyframe || (packetMs >= 0 && packetMs + halfFrameMs < cachedUntilMs)) {
+                    av_packet_unref(packet);
+                    continue;
+                }
+            }
+            // 只解码关键帧时其他视频包不必进入解码器。退出该模式后要一直丢弃到下一个关键帧，
+            // 否则解码器会拿到参考帧已被丢弃的数据包
+            if (packet->stream_index == videoStreamIndex) {
+                if (packet->flags & AV_PKT_FLAG_KEY) {
+                    dropUntilKeyframe = false;
+                } else {
+                    if (frameSkipMode.load(std::memory_order_relaxed) == KeyframesOnly) dropUntilKeyframe = true;
+                    if (dropUntilKeyframe) {
+                        av_packet_unref(packet);
+                        continue;
+                    }
+                }
+            }
+            packetPending = true;
+        }
+
+        // d. 写入对应的队列 (背压)，队列满时阻塞，被跳转或停止打断时保留数据包
+        PacketQueue &queue = (packet->stream_index == videoStreamIndex) ? videoPackets : audioPackets;
+        if (queue.put(packet)) packetPending = false;
+    }
+    av_packet_free(&packet);
+}
+
+/**
+ * @brief [解复用线程] 定位到目标时间点之前最近的关键帧。
+ *
+ * 索引就绪时按显示时间找到关键帧、按其解码时间戳定位，容器不支持时再尝试按字节位置定位；
+ * 索引尚未就绪时在视频流上向后查找关键帧。
+ * @param ms 目标时间点（毫秒）。
+ */
+void VideoDecoder::seekTo(qint64 ms) {
+    KeyframeIndex::Entry keyframe;
+    if (keyframeIndex.findPreceding(ms, keyframe)) {
+        if (av_seek_frame(formatCtx, videoStreamIndex, keyframe.dts, AVSEEK_FLAG_BACKWARD) >= 0) return;
+        if (keyframe.pos >= 0 && !(formatCtx->iformat->flags & AVFMT_NO_BYTE_SEEK)
+            && av_seek_frame(formatCtx, videoStreamIndex, keyframe.pos, AVSEEK_FLAG_BYTE) >= 0) return;
+    }
+    // 将毫秒时间转换为视频流的时间基（timestamp）后执行跳转
+    const AVRational timeBase = formatCtx->streams[videoStreamIndex]->time_base;
+    av_seek_frame(formatCtx, videoStreamIndex, av_rescale_q(ms, AVRational{1, 1000}, timeBase), AVSEEK_FLAG_BACKWARD);
+}
+
+/**
+ * @brief [视频解码线程] 跳转命中 GOP 缓存时，把缓存的画面转回BGR24依次输出。
+ *
+ * 画面写入帧缓冲池的缓冲，和正常解码的帧走同样的流控；期间再次跳转时立即放弃。
+ * @param frameSerial 当前的跳转序号。
+ * @return 解复用线程为这个序号准备了缓存画面时返回true。
+ */
+bool VideoDecoder::serveCachedSegment(int frameSerial) {
+    std::vector<DecodedGopCache::Frame> frames;
+    {
+        QMutexLocker locker(&cachedSegmentMutex);
+        if (cachedSegmentSerial != frameSerial) return false;
+        frames.swap(cachedSegment);
+        cachedSegmentSerial = -1;
+    }
+    bool first = true;
+    for (const DecodedGopCache::Frame &cached : frames) {
+        const int rows = cached.yuv.rows * 2 / 3;
+        cv::Mat bgr = acquireFrameBuffer(rows, cached.yuv.cols, frameSerial);
+        if (bgr.empty()) break; // 停止或又发生了跳转
+        cv::cvtColor(cached.yuv, bgr, cv::COLOR_YUV2BGR_I420);
+        if (first) {
+            recordSeekLatency(0);
+            first = false;
+        }
+        VideoFrame vf;
+        vf.frame = bgr;
+        vf.pts = cached.pts;
+        vf.serial = frameSerial;
+        if (!pushWhenReady(videoRing, std::move(vf))) break;
+    }
+    return true;
+}
+
+/**
+ * @brief [视频解码线程] 记录跳转耗时。
+ * @param discardedFrames 从关键帧到目标帧之间被丢弃的帧数。
+ */
+void VideoDecoder::recordSeekLatency(int discardedFrames) {
+    const qint64 latencyMs = (steadyNowNs() - seekStartNs.load(std::memory_order_relaxed)) / 1000000;
+    lastSeekLatencyMs.store(latencyMs, std::memory_order_relaxed);
+    qDebug() << "跳转完成: 耗时" << latencyMs << "ms，预解码丢弃" << discardedFrames << "帧"
+             << (keyframeIndex.isReady() ? "(关键帧索引)" : "(无索引)");
+}
+
+/**
+ * @brief [视频解码线程] 解码视频数据包并转换为BGR24帧。
+ *
+ * 输出帧直接在颜色转换时缩小到呈现尺寸；需要切换 lowres 级别时，
+ * 在下一个关键帧处取出旧解码器中剩余的帧，再以新级别重新打开解码器。
+ */
+void VideoDecoder::videoDecodeLoop() {
+    AVPacket* packet = av_packet_alloc();
+    AVFrame* frame = av_frame_alloc();
+    ParallelSwsConverter converter;
+    const AVRational timeBase = formatCtx->streams[videoStreamIndex]->time_base;
+    int codecSerial = -1;   // 解码器当前内容所属的序号
+    int packetSerial = 0;
+    qint64 prerollTargetMs = -1; // 跳转目标，早于它的帧直接丢弃
+    int prerollFrames = 0;       // 本次跳转已丢弃的帧数
+    bool fillGop = false;        // 预解码帧是否也存入 GOP 缓存
+    cv::Mat prerollFrame;        // 存入缓存的预解码帧的转换缓冲，跨帧复用
+    // 时间戳与目标相差不到半帧即视为目标帧
+    const qint64 halfFrameMs = static_cast<qint64>(500.0 / videoFPS);
+
+    // 当前数据包的解码耗时：avcodec_send_packet 加上各次 avcodec_receive_frame。
+    // 启用帧级多线程时送入只是排队，真正的解码等待发生在取帧时；转换和写入环形缓冲区不计入
+    qint64 decodeNs = 0;
+
+    // 取出解码器中当前可用的所有帧，转换后写入环形缓冲区
+    auto receiveFrames = [&]() {
+        while (true) {
+            const qint64 receiveStartNs = steadyNowNs();
+            const int receiveResult = avcodec_receive_frame(videoCodecCtx, frame);
+            decodeNs += steadyNowNs() - receiveStartNs;
+            if (receiveResult != 0) break;
+            const qint64 pts = framePtsMs(frame, timeBase);
+            // 跳帧时输出的画面不连续，不能作为 GOP 缓存
+            if (videoCodecCtx->skip_frame != AVDISCARD_DEFAULT) gopCache.abandonGop();
+            else if (frame->flags & AV_FRAME_FLAG_KEY) gopCache.beginGop(pts);
+            // 跳转后的预解码阶段：目标之前的帧只解码不转换，解码线程全速推进；
+            // 逐帧后退时则转换后只存入 GOP 缓存
+            if (prerollTargetMs >= 0) {
+                if (pts + halfFrameMs < prerollTargetMs) {
+                    ++prerollFrames;
+                    if (fillGop && gopCache.isCollecting()) {
+                        const cv::Size size = outputSize();
+                        prerollFrame.create(size, CV_8UC3);
+                        if (converter.convert(frame, prerollFrame)) gopCache.append(prerollFrame, pts);
+                    }
+                    continue;
+                }
+                recordSeekLatency(prerollFrames);
+                prerollTargetMs = -1;
+            }
+            const cv::Size size = outputSize();
+            // 从缓冲池取出可复用的缓冲，颜色转换（含缩放）直接写入其中，不再额外克隆
+            cv::Mat cvFrame = acquireFrameBuffer(size.height, size.width, codecSerial);
+            if (cvFrame.empty()) continue; // 停止或跳转中，这一帧本就会被丢弃
+            const qint64 scaleStartNs = steadyNowNs();
+            if (!converter.convert(frame, cvFrame)) continue;
+            if (VideoTelemetry *sink = telemetry.load(std::memory_order_acquire)) {
+                sink->record(VideoTelemetry::ScaleTime, (steadyNowNs() - scaleStartNs) / 1000);
+                sink->count(VideoTelemetry::DecodedFrames);
+            }
+            // 效果线程会原地修改这块缓冲，必须在放入环形缓冲区之前存入缓存
+            gopCache.append(cvFrame, pts);
+            VideoFrame vf;
+            vf.frame = cvFrame;
+            vf.pts = pts;
+            vf.serial = codecSerial;
+            pushWhenReady(videoRing, std::move(vf));
+        }
+    };
+
+    while (videoPackets.get(packet, packetSerial)) {
+        // 序号变化说明发生了跳转，解码器中残留的参考帧必须清空
+        if (packetSerial != codecSerial) {
+            if (codecSerial != -1) avcodec_flush_buffers(videoCodecCtx);
+            codecSerial = packetSerial;
+            prerollTargetMs = seekTargetMs.load(std::memory_order_relaxed);
+            fillGop = seekFillGop.load(std::memory_order_relaxed);
+            // 只解码关键帧时目标之后的下一个关键帧可能还很远，直接显示目标之前的关键帧
+            if (frameSkipMode.load(std::memory_order_relaxed) == KeyframesOnly) prerollTargetMs = -1;
+            prerollFrames = 0;
+            gopCache.abandonGop();
+            // 命中 GOP 缓存：直接输出缓存的画面，之后从下一个关键帧继续解码。
+            // 这时收到的第一个数据包是解复用线程放入的标记包，不是文件结束
+            if (serveCachedSegment(codecSerial)) {
+                prerollTargetMs = -1;
+                if (!packet->data) { av_packet_unref(packet); continue; }
+            }
+        }
+        // lowres 只能在打开解码器时设置，且新解码器必须从关键帧开始
+        if (packet->data && (packet->flags & AV_PKT_FLAG_KEY)) {
+            const int lowres = desiredLowres();
+            if (lowres != videoCodecCtx->lowres) {
+                avcodec_send_packet(videoCodecCtx, nullptr);
+                receiveFrames();
+                avcodec_free_context(&videoCodecCtx);
+                if (!openCodec(videoStreamIndex, &videoCodecCtx, true, lowres)) {
+                    avcodec_free_context(&videoCodecCtx);
+                    if (!openCodec(videoStreamIndex, &videoCodecCtx, true, 0)) {
+                        qWarning() << "FFmpeg: 无法重新打开视频解码器";
+                        av_packet_unref(packet);
+                        break;
+                    }
+                }
+            }
+        }
+        // 文件结束：最后一个 GOP 没有下一个关键帧，以无穷远为终点存入缓存
+        if (!packet->data) gopCache.finishGop(std::numeric_limits<qint64>::max());
+        // 按跳帧方式设置解码器的 skip_frame（重新打开解码器后也会在这里补上）
+        const int mode = frameSkipMode.load(std::memory_order_relaxed);
+        const AVDiscard discard = mode == KeyframesOnly ? AVDISCARD_NONKEY : mode == SkipNonReference ? AVDISCARD_NONREF : AVDISCARD_DEFAULT;
+        if (videoCodecCtx->skip_frame != discard) videoCodecCtx->skip_frame = discard;
+        int sendResult;
+        decodeNs = 0;
+        do {
+            // 空数据包为结束标记，以 nullptr 送入以取出解码器中剩余的帧
+            const qint64 sendStartNs = steadyNowNs();
+            sendResult = avcodec_send_packet(videoCodecCtx, packet->data ? packet : nullptr);
+            decodeNs += steadyNowNs() - sendStartNs;
+            receiveFrames();
+            // EAGAIN 表示必须先取走输出帧，上面已经取完，重新送入同一个数据包
+        } while (sendResult == AVERROR(EAGAIN) && !stopped.load(std::memory_order_acquire));
+        // 结束标记会一次取出解码器中剩余的所有帧，不计入单个数据包的耗时
+        VideoTelemetry *sink = telemetry.load(std::memory_order_acquire);
+        if (sink && sendResult == 0 && packet->data) sink->record(VideoTelemetry::DecodeTime, decodeNs / 1000);
+        av_packet_unref(packet);
+    }
+    av_frame_free(&frame);
+    av_packet_free(&packet);
+}
+
+/**
+ * @brief 把各级队列深度和缓冲池占用写入遥测仪表。
+ */
+void VideoDecoder::sampleTelemetry() const {
+    VideoTelemetry *sink = telemetry.load(std::memory_order_acquire);
+    if (!sink) return;
+    sink->setGauge(VideoTelemetry::VideoPacketQueue, videoPackets.size());
+    sink->setGauge(VideoTelemetry::AudioPacketQueue, audioPackets.size());
+    sink->setGauge(VideoTelemetry::VideoFrameQueue, static_cast<qint64>(videoRing.size()));
+    sink->setGauge(VideoTelemetry::PresentQueue, static_cast<qint64>(presentRing.size()));
+    sink->setGauge(VideoTelemetry::AudioBufferMs, audioRing.size() / (48 * 2 * 2));
+    const size_t budget = framePool.budget();
+    sink->setGauge(VideoTelemetry::PoolBytes, static_cast<qint64>(framePool.allocatedBytes()));
+    sink->setGauge(VideoTelemetry::PoolBuffersInUse, framePool.buffersInUse());
+    sink->setGauge(VideoTelemetry::PoolUsagePercent, budget > 0 ? static_cast<qint64>(framePool.allocatedBytes() * 100 / budget) : 0);
+}
+
+/**
+ * @brief 设置帧观察回调（任意线程），效果线程处理下一帧时生效。
+ */
+void VideoDecoder::setFrameTap(FrameTap tap) {
+    std::shared_ptr<const FrameTap> newTap;
+    if (tap) newTap = std::make_shared<const FrameTap>(std::move(tap));
+    std::atomic_store(&frameTap, std::move(newTap));
+}
+
+/**
+ * @brief [效果线程] 从视频帧缓冲区取帧，应用效果后放入待显示缓冲区。
+ *
+ * 效果直接写在帧缓冲池的缓冲上（此时只有本线程持有它），不再拷贝整帧。
+ * 待显示缓冲区容量很小，本线程只会领先显示几帧，效果参数改变后很快生效。
+ */
+void VideoDecoder::effectLoop() {
+    const qint64 frameMs = static_cast<qint64>(1000.0 / videoFPS);
+    while (!stopped.load(std::memory_order_acquire)) {
+        waitUntil([this] {
+            return stopped.load(std::memory_order_acquire) || (!videoRing.isEmpty() && !presentRing.isFull());
+        });
+        VideoFrame vf;
+        if (!videoRing.pop(vf)) continue;
+        // 视频解码线程可能在等待空位
+        wakeWaitingThreads(false);
+        if (isStale(vf.serial)) continue; // 跳转前的旧帧，不必处理
+        // 已经落后于播放时钟一帧以上、后面还有帧在排队：这一帧不会被显示，省掉效果处理
+        const qint64 clockMs = presentationClockMs.load(std::memory_order_acquire);
+        if (clockMs >= 0 && !videoRing.isEmpty()) {
+            const qint64 elapsedMs = std::min<qint64>((steadyNowNs() - presentationClockNs.load(std::memory_order_relaxed)) / 1000000, maxClockExtrapolationMs);
+            const qint64 nowMs = clockMs + elapsedMs * presentationRatePermille.load(std::memory_order_relaxed) / 1000;
+            if (vf.pts + frameMs < nowMs) {
+                lateDroppedFrames.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+        }
+        if (VideoTelemetry *sink = telemetry.load(std::memory_order_acquire)) {
+            VideoEffectStage::Timings timings;
+            effectStage.apply(vf.frame, &timings);
+            static const VideoTelemetry::Histogram effectHistograms[VideoEffectStage::EffectCount] = {
+                VideoTelemetry::BrightnessContrastTime, VideoTelemetry::SaturationHueTime, VideoTelemetry::GrayscaleTime
+            };
+            for (int i = 0; i < VideoEffectStage::EffectCount; ++i) {
+                const qint64 ns = timings.cpuNs[i].load(std::memory_order_relaxed);
+                if (ns > 0) sink->record(effectHistograms[i], ns / 1000);
+            }
+        } else {
+            effectStage.apply(vf.frame);
+        }
+        if (const std::shared_ptr<const FrameTap> tap = std::atomic_load(&frameTap)) (*tap)(vf.frame, vf.pts);
+        pushWhenReady(presentRing, std::move(vf));
+    }
+}
+
+/**
+ * @brief [音频解码线程] 解码音频数据包并重采样为 48kHz 立体声 S16。
+ *
+ * 重采样直接写入一块复用的缓冲区（只在帧变大时扩容），再拷贝进 PCM 环形缓冲区；
+ * 环形缓冲区满时在流控条件变量上等待 AudioSink 读走数据。
+ */
+void VideoDecoder::audioDecodeLoop() {
+    // 音频重采样：将源音频格式转换为Qt AudioSink支持的格式（立体声, 16位有符号整数, 48kHz）
+    SwrContext* swrCtx = nullptr;
+    AVChannelLayout out_ch_layout = AV_CHANNEL_LAYOUT_STEREO;
+    swr_alloc_set_opts2(&swrCtx, &out_ch_layout, AV_SAMPLE_FMT_S16, 48000, &audioCodecCtx->ch_layout, audioCodecCtx->sample_fmt, audioCodecCtx->sample_rate, 0, nullptr);
+    swr_init(swrCtx);
+
+    AVPacket* packet = av_packet_alloc();
+    AVFrame* frame = av_frame_alloc();
+    const AVRational timeBase = formatCtx->streams[audioStreamIndex]->time_base;
+    int codecSerial = -1;
+    int packetSerial = 0;
+    qint64 prerollTargetMs = -1; // 跳转目标，早于它的样本直接丢弃
+    std::vector<uint8_t> pcm;    // 重采样输出缓冲，跨帧复用
+
+    while (audioPackets.get(packet, packetSerial)) {
+        if (packetSerial != codecSerial) {
+            if (codecSerial != -1) {
+                avcodec_flush_buffers(audioCodecCtx);
+                swr_init(swrCtx); // 丢弃重采样器中残留的跳转前样本
+            }
+            codecSerial = packetSerial;
+            prerollTargetMs = seekTargetMs.load(std::memory_order_relaxed);
+        }
+        // 关闭输出（变速播放）时不再解码音频；回到原速时播放端会重新跳转，解码器随之清空
+        if (packet->data && !audioOutputEnabled.load(std::memory_order_acquire)) {
+            av_packet_unref(packet);
+            continue;
+        }
+        int sendResult;
+        do {
+            sendResult = avcodec_send_packet(audioCodecCtx, packet->data ? packet : nullptr);
+            while (avcodec_receive_frame(audioCodecCtx, frame) == 0) {
+                // 计算重采样后需要的缓冲区大小
+                int out_samples = av_rescale_rnd(swr_get_delay(swrCtx, frame->sample_rate) + frame->nb_samples, 48000, frame->sample_rate, AV_ROUND_UP);
+                if (pcm.size() < static_cast<size_t>(out_samples) * 2 * 2) pcm.resize(static_cast<size_t>(out_samples) * 2 * 2);
+                // 执行重采样
+                uint8_t* resampled_data = pcm.data();
+                out_samples = swr_convert(swrCtx, &resampled_data, out_samples, (const uint8_t**)frame->data, frame->nb_samples);
+                int data_size = std::max(out_samples, 0) * 2 * 2; // 采样数 * 通道数 * 采样大小(16bit=2bytes)
+                // 跳转后裁掉目标时间点之前的样本，让音频时钟从目标时间点开始
+                int skip_bytes = 0;
+                if (prerollTargetMs >= 0) {
+                    const qint64 early_ms = prerollTargetMs - framePtsMs(frame, timeBase);
+                    skip_bytes = static_cast<int>(std::clamp<qint64>(early_ms * 48 * 2 * 2, 0, data_size));
+                    if (skip_bytes < data_size) prerollTargetMs = -1;
+                }
+                if (skip_bytes >= data_size || !audioOutputEnabled.load(std::memory_order_acquire)) continue;
+                // 写入环形缓冲区，空间不足时等待 AudioSink 读取（或被停止/跳转/关闭输出打断）
+                const char* pending = reinterpret_cast<const char*>(resampled_data) + skip_bytes;
+                qint64 remaining = data_size - skip_bytes;
+                while (remaining > 0) {
+                    const qint64 written = audioRing.write(pending, remaining, codecSerial);
+                    pending += written;
+                    remaining -= written;
+                    if (remaining == 0) break;
+                    bool abandoned = false;
+                    waitUntil([&] {
+                        abandoned = isStale(codecSerial) || !audioOutputEnabled.load(std::memory_order_acquire);
+                        return abandoned || audioRing.freeSpace() > 0;
+                    });
+                    if (abandoned) break;
+                }
+            }
+        } while (sendResult == AVERROR(EAGAIN) && !stopped.load(std::memory_order_acquire));
+        av_packet_unref(packet);
+    }
+    av_frame_free(&frame);
+    av_packet_free(&packet);
+    swr_free(&swrCtx);
+}
+
+/**
+ * @brief 独立打开文件，以原始分辨率解码指定时间点的一帧。
+ *
+ * 从目标时间点之前的关键帧开始解码，返回第一帧时间戳不小于目标时间点的帧；
+ * 如果目标在最后一帧之后，则返回最后一帧。
+ * @param filePath 视频文件路径。
+ * @param ms 目标时间点（毫秒）。
+ * @return BGR24 格式的原始分辨率帧；失败时返回空 Mat。
+ */
+cv::Mat VideoDecoder::decodeFrameAt(const QString &filePath, qint64 ms) {
+    AVFormatContext* fmtCtx = nullptr;
+    if (avformat_open_input(&fmtCtx, filePath.toLocal8Bit().constData(), nullptr, nullptr) != 0) return cv::Mat();
+    cv::Mat result;
+    AVCodecContext* codecCtx = nullptr;
+    const int streamIndex = avformat_find_stream_info(fmtCtx, nullptr) >= 0
+                                ? av_find_best_stream(fmtCtx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0) : -1;
+    if (streamIndex >= 0) {
+        AVStream* stream = fmtCtx->streams[streamIndex];
+        const AVCodec* codec = avcodec_find_decoder(stream->codecpar->codec_id);
+        codecCtx = codec ? avcodec_alloc_context3(codec) : nullptr;
+        if (codecCtx && avcodec_parameters_to_context(codecCtx, stream->codecpar) >= 0 && avcodec_open2(codecCtx, codec, nullptr) >= 0) {
+            av_seek_frame(fmtCtx, streamIndex, av_rescale_q(ms, AVRational{1, 1000}, stream->time_base), AVSEEK_FLAG_BACKWARD);
+            AVPacket* packet = av_packet_alloc();
+            AVFrame* frame = av_frame_alloc();
+            AVFrame* lastFrame = av_frame_alloc();
+            bool found = false, draining = false;
+            while (!found) {
+                if (!draining) {
+                    if (av_read_frame(fmtCtx, packet) < 0) {
+                        draining = true;
+                        avcodec_send_packet(codecCtx, nullptr);
+                    } else {
+                        if (packet->stream_index == streamIndex) avcodec_send_packet(codecCtx, packet);
+                        av_packet_unref(packet);
+                    }
+                }
+                while (!found && avcodec_receive_frame(codecCtx, frame) == 0) {
+                    av_frame_unref(lastFrame);
+                    av_frame_move_ref(lastFrame, frame);
+                    found = framePtsMs(lastFrame, stream->time_base) >= ms;
+                }
+                if (draining && !found) break; // 解码器已清空，使用最后一帧
+            }
+            if (lastFrame->data[0]) {
+                result.create(lastFrame->height, lastFrame->width, CV_8UC3);
+                ParallelSwsConverter converter;
+                if (!converter.convert(lastFrame, result)) result.release();
+            }
+            av_frame_free(&lastFrame);
+            av_frame_free(&frame);
+            av_packet_free(&packet);
+        }
+    }
+    avcodec_free_context(&codecCtx);
+    avformat_close_input(&fmtCtx);
+    return result;
+}
@@ -0,0 +1,380 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+#ifndef VIDEODECODER_H
+#define VIDEODECODER_H
+
+// =============================================================================
+// File: videodecoder.h
+//
+// Description:
+// 该文件定义了 VideoDecoder 类，负责在后台线程中解复用并解码音视频文件。
+// 解复用、视频解码和音频解码分别运行在各自的线程中，
+// 解码结果通过无锁环形缓冲区交给主线程的 VideoProcessor。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <opencv2/core.hpp>
+#include "spscringbuffer.h"
+#include "pcmringbuffer.h"
+#include "framebufferpool.h"
+#include "packetqueue.h"
+#include "keyframeindex.h"
+#include "decodedgopcache.h"
+#include "videoeffectstage.h"
+#include "videotelemetry.h"
+
+// --- 前置声明 ---
+struct AVFormatContext;
+struct AVCodecContext;
+
+/**
+ * @class VideoDecoder
+ * @brief 在后台线程中解码音视频文件的类。
+ *
+ * [控制流程]
+ * 1. 由主线程的 VideoProcessor 创建实例。
+ * 2. 调用 startDecoding() 启动新线程并执行 run()。
+ * 3. run() 打开文件和解码器后，再启动视频解码线程和音频解码线程，
+ *    自身则作为解复用线程，把数据包分发到两个 PacketQueue 中。
+ * 4. 解码线程把解码后的数据放入无锁环形缓冲区中：主线程通过 getVideoFrame() 取出视频帧，
+ *    QAudioSink 则按自己的节奏经 AudioPullDevice 调用 readAudio() 拉取 PCM 数据。
+ * 5. 通过 stop() 和 seek() 方法响应主线程的控制。
+ *
+ * [打开握手]
+ * startDecoding() 阻塞到 run() 解析完流信息并打开解码器（或失败）为止，
+ * 不再依赖固定时长的休眠；失败原因可通过 errorString() 取得。
+ * 也可以用 startDecodingAsync() 在后台打开，需要时再 waitForOpened()（DecoderPrefetcher 即如此预热播放列表中的相邻视频）。
+ *
+ * [精确跳转]
+ * 后台建立的 KeyframeIndex 就绪后，跳转直接定位到目标之前最近的关键帧；
+ * 解码线程从关键帧开始解码，丢弃目标时间点之前的所有输出（不做颜色转换），
+ * 因此跳转后显示的第一帧就是目标帧。每次跳转的耗时记录在 getLastSeekLatencyMs() 中。
+ *
+ * [GOP 缓存]
+ * 解码出的画面同时以 YUV420 存入 DecodedGopCache。跳转目标落在缓存的 GOP 中时，
+ * 解复用线程丢弃这个 GOP 的视频数据包（音频照常），解码线程直接把缓存的画面转回BGR输出，
+ * 然后从下一个关键帧继续解码；逐帧后退、A-B 循环和反复拖动到同一处都不必重新解码整个 GOP。
+ *
+ * [高倍速浏览]
+ * setSkipMode() 让解码器跳过不被参考的帧（AVDISCARD_NONREF），或只解码关键帧（AVDISCARD_NONKEY，
+ * 解复用线程同时丢弃其他视频包）。此时输出的画面不连续，不存入 GOP 缓存，跳转后也不再预解码到目标帧。
+ *
+ * [流控]
+ * 环形缓冲区或帧缓冲池已满时，解码线程在条件变量上等待；主线程取走数据后
+ * 只有在确实有线程等待时才加锁唤醒，平时取数据仍然不加锁。
+ *
+ * [线程模型]
+ * - 解复用线程 (run)：读取数据包，处理跳转请求。
+ * - 视频解码线程：FFmpeg 帧级/片级多线程解码，颜色转换按水平条带并行执行。
+ * - 效果线程：从视频帧缓冲区取帧，由 VideoEffectStage 原地应用视频效果后
+ *   放入容量很小的待显示缓冲区，效果与解码流水并行，不占用主线程时间。
+ * - 音频解码线程：解码并重采样为 48kHz 立体声 S16，直接写入预分配的 PCM 环形缓冲区。
+ * 每个环形缓冲区都只有一个生产者和一个消费者，双方之间不共享任何锁。跳转时不会清空环形缓冲区（那是消费者的职责），
+ * 而是递增 serial；消费者在取数据时丢弃 serial 过期的旧数据。
+ */
+class VideoDecoder : public QThread {
+    Q_OBJECT
+public:
+    explicit VideoDecoder(QObject* parent = nullptr);
+    ~VideoDecoder();
+
+    // 启动解码并阻塞到打开完成，相当于 startDecodingAsync() 之后再 waitForOpened()
+    bool startDecoding(const QString& filePath);
+    // 启动解码线程后立即返回，不等待打开结果（预取时使用）
+    void startDecodingAsync(const QString& filePath);
+    /**
+     * @brief 等待解码线程报告打开结果，已经打开（或失败）时立即返回。
+     * @return 文件和解码器均已打开返回true；失败原因见 errorString()。
+     */
+    bool waitForOpened();
+    // 最近一次 startDecoding() 失败的原因
+    QString errorString() const;
+    // 正在解码的文件路径
+    QString sourceFile() const { return sourcePath; }
+    void stop();
+    /**
+     * @brief 请求跳转到指定时间点。
+     * @param ms 目标时间点（毫秒）。
+     * @param fillGopCache 为true时从关键帧到目标之间的预解码帧也转换并存入 GOP 缓存，
+     *        之后继续后退时直接命中缓存（逐帧后退时使用）。
+     */
+    void seek(qint64 ms, bool fillGopCache = false);
+    cv::Mat getVideoFrame(qint64 audio_pts, qint64 *framePts = nullptr, int *skippedFrames = nullptr);
+    // 待显示缓冲区中下一帧的时间戳（毫秒），没有可显示的帧时返回-1。只能由主线程调用。
+    qint64 nextFramePts();
+    /**
+     * @brief 发布播放端的主时钟（任意线程，通常每次刷新时调用）。
+     *
+     * 效果线程据此估算当前播放位置：一帧在处理前就已经落后于时钟一帧以上、
+     * 且后面还有帧在排队时，直接丢弃而不做效果处理，把CPU留给还来得及显示的帧。
+     * @param clockMs 当前的主时钟（毫秒），-1 表示暂停/跳转中，此时不丢帧。
+     * @param rate 播放速率，用于在两次发布之间外推时钟。
+     */
+    void setPresentationClock(qint64 clockMs, double rate);
+    // 效果线程因落后于时钟而直接丢弃的帧数
+    qint64 getLateDroppedFrames() const { return lateDroppedFrames.load(std::memory_order_relaxed); }
+    /**
+     * @brief 读取当前序号（最近一次跳转之后）的 PCM 数据：48kHz 立体声 S16。
+     *
+     * 只能由唯一的消费者（AudioPullDevice，在 AudioSink 的线程中）调用，
+     * 跳转前产生的旧数据被直接丢弃，跳转尚未完成时不返回任何数据。
+     * @return 实际读取的字节数；暂时没有数据时返回0。
+     */
+    qint64 readAudio(char *data, qint64 maxSize);
+    // PCM 环形缓冲区中的字节数（近似值）
+    qint64 bufferedAudioBytes() const { return audioRing.size(); }
+    // 为false时音频解码线程直接丢弃解码结果（变速播放时），不会因为没人读取而阻塞（任意线程）
+    void setAudioOutputEnabled(bool enabled);
+    // 音频观察回调：在 readAudio() 中对交给 AudioSink 的每一段数据调用一次（录制时使用）。
+    // 回调不得持有 data 指针；传入空函数表示取消（任意线程）。
+    using AudioTap = std::function<void(const char *data, qint64 size)>;
+    void setAudioTap(AudioTap tap);
+    double getFPS() const { return videoFPS; }
+    qint64 getDurationMs() const { return durationMs; }
+    // 视频流的原始分辨率（startDecoding() 成功后有效）
+    cv::Size getSourceSize() const { return cv::Size(sourceWidth, sourceHeight); }
+    // 最近一次跳转从请求到目标帧解码完成的耗时（毫秒），尚未跳转时为-1
+    qint64 getLastSeekLatencyMs() const { return lastSeekLatencyMs.load(std::memory_order_relaxed); }
+    // 设置视频效果参数（任意线程），最多几帧之后就会体现在显示的画面上
+    void setEffectParams(const VideoEffectParams &params) { effectStage.setParams(params); }
+    // 对一帧单独应用当前的视频效果（例如保存原始分辨率帧时）
+    void applyEffects(cv::Mat &frame) const { effectStage.apply(frame); }
+    // 帧观察回调：在效果线程中对每一帧（已应用效果、即将进入待显示缓冲区）调用一次。
+    // 回调不得修改或持有该帧，耗时应尽量短；传入空函数表示取消（任意线程）。
+    using FrameTap = std::function<void(const cv::Mat &frame, qint64 pts)>;
+    void setFrameTap(FrameTap tap);
+    /**
+     * @enum SkipMode
+     * @brief 解码时跳过哪些视频帧（高倍速浏览时使用）。
+     */
+    enum SkipMode {
+        DecodeAllFrames,  // 解码所有帧
+        SkipNonReference, // 跳过不被其他帧参考的帧（通常是B帧），画面仍然连续
+        KeyframesOnly     // 只解码关键帧，其他视频包在解复用时直接丢弃
+    };
+    // 设置跳帧方式（任意线程），在下一个数据包处生效
+    void setSkipMode(SkipMode mode) { frameSkipMode.store(mode, std::memory_order_relaxed); }
+    SkipMode skipMode() const { return static_cast<SkipMode>(frameSkipMode.load(std::memory_order_relaxed)); }
+    // 设置视频帧缓冲池的字节上限（下一次取缓冲时生效）
+    void setFrameBufferBudget(size_t bytes) { framePool.setBudget(bytes); }
+    /**
+     * @brief 切换预取模式（主线程）。
+     *
+     * 预取模式下帧缓冲池的限额降为很小的一块，解码器只预先解码开头的几帧就停下等待，
+     * 超出限额的空闲缓冲被释放；退出时恢复默认限额并唤醒解码线程继续解码。
+     */
+    void setPrefetchMode(bool enabled);
+    // 设置 GOP 缓存的字节上限，0 表示不缓存（任意线程）
+    void setGopCacheBudget(size_t bytes) { gopCache.setBudget(bytes); }
+    // GOP 缓存当前占用的字节数
+    size_t gopCacheBytes() const { return gopCache.usedBytes(); }
+    // 丢弃待显示缓冲区中跳转前的旧帧并唤醒效果线程（主线程，解码器闲置、没有播放端取帧时使用）
+    void discardStaleFrames();
+    /**
+     * @brief 配置视频解码器的多线程方式，需在 startDecoding() 之前调用。
+     * @param threadCount 解码线程数，0 表示由 FFmpeg 按CPU核心数自动选择。
+     * @param frameThreading 是否启用帧级多线程（吞吐量高，但增加若干帧的延迟）。
+     * @param sliceThreading 是否启用片级多线程（需要码流本身分片）。
+     */
+    void setDecoderThreading(int threadCount, bool frameThreading, bool sliceThreading);
+    /**
+     * @brief 设置呈现尺寸（显示视图的物理像素大小），可在播放中随时调用。
+     *
+     * 解码线程在颜色转换时直接把帧缩小到能放进该尺寸的大小（保持宽高比，不放大），
+     * 解码器支持 lowres 时还会在下一个关键帧处切换到合适的低分辨率解码。
+     * 传入空尺寸表示不缩小。
+     */
+    void setTargetSize(int width, int height);
+    // 为true时始终输出原始分辨率（录制时使用），忽略呈现尺寸
+    void setFullResolution(bool enabled);
+    /**
+     * @brief 独立打开文件，以原始分辨率解码指定时间点的一帧（BGR24）。
+     *
+     * 不使用播放中的解码线程，适合保存当前帧等一次性操作。
+     * @return 目标时间点处（或之后最近）的帧；失败时返回空 Mat。
+     */
+    static cv::Mat decodeFrameAt(const QString &filePath, qint64 ms);
+
+    /**
+     * @brief 设置遥测记录对象（任意线程），传入nullptr表示停止记录；它必须比解码器活得更久。
+     *
+     * 解码线程记录解码和颜色转换耗时、解码帧数，效果线程记录各效果的耗时。
+     */
+    void setTelemetry(VideoTelemetry *sink) { telemetry.store(sink, std::memory_order_release); }
+    // 把各级队列深度和缓冲池占用写入遥测仪表（任意线程，通常在遥测采样时由主线程调用）
+    void sampleTelemetry() const;
+
+signals:
+    // 当 seek 操作在解码线程中完成后发射，通知主线程可以进行下一步操作（如重建音频设备）。
+    void seekFinished();
+
+protected:
+    // 解复用线程的主函数
+    void run() override;
+
+private:
+    // --- 数据结构 ---
+    struct VideoFrame {
+        cv::Mat frame;
+        qint64 pts = 0; // 视频帧的显示时间戳 (Presentation Timestamp)，单位：毫秒
+        int serial = 0; // 产生该帧时的跳转序号，用于丢弃跳转前的旧帧
+    };
+
+    // --- 各线程的主循环 ---
+    void demuxLoop();
+    void videoDecodeLoop();
+    void effectLoop();
+    void audioDecodeLoop();
+
+    // [解复用线程] 执行一次跳转：优先使用关键帧索引定位
+    void seekTo(qint64 ms);
+    // [视频解码线程] 跳转命中 GOP 缓存时输出缓存的画面，返回是否命中
+    bool serveCachedSegment(int frameSerial);
+    // [视频解码线程] 到达跳转目标帧时记录跳转耗时
+    void recordSeekLatency(int discardedFrames);
+    // 打开指定流的解码器，threaded 为true时应用多线程配置，lowres 为解码缩小级别
+    bool openCodec(int streamIndex, AVCodecContext** codecCtx, bool threaded, int lowres = 0);
+    // 根据呈现尺寸计算输出帧的尺寸
+    cv::Size outputSize() const;
+    // 根据输出尺寸选择解码器的 lowres 级别（解码器不支持时为0）
+    int desiredLowres() const;
+    // 将数据放入环形缓冲区，缓冲区满时等待消费者腾出空间（或被停止/跳转打断）。
+    template <typename T>
+    bool pushWhenReady(SpscRingBuffer<T> &ring, T &&item);
+    // 从帧缓冲池取出一块BGR24缓冲，池已满时等待播放端释放旧帧（或被停止/跳转打断）。
+    cv::Mat acquireFrameBuffer(int rows, int cols, int frameSerial);
+    // 判断某个序号产生的数据是否已经作废（停止或发生了新的跳转）
+    bool isStale(int itemSerial) const;
+    // [解码线程] 在流控条件变量上等待，直到 ready() 返回true
+    template <typename Ready>
+    void waitUntil(Ready ready);
+    // 唤醒在流控条件变量上等待的线程；force 为false时没有线程等待就直接返回
+    void wakeWaitingThreads(bool force);
+    // [解复用线程] 报告打开结果，唤醒 waitForOpened()
+    void reportOpenResult(bool success, const QString &error = QString());
+
+    // --- 线程控制与状态变量 ---
+    QString sourcePath; // 当前解码的文件路径
+    // [关键变量] 线程停止标志。主线程以 release 语义置为true，各线程以 acquire 语义检测到后退出。
+    std::atomic<bool> stopped{false};
+    // [关键变量] 跳转请求时间点（毫秒）。主线程设置此值（非-1），解复用线程以 exchange 取走后执行av_seek_frame。
+    std::atomic<qint64> seekRequest{-1};
+    // [关键变量] 跳转序号。每完成一次跳转递增一次，消费者据此识别过期数据。
+    std::atomic<int> serial{0};
+    // [关键变量] 当前序号对应的跳转目标（毫秒），解码线程丢弃早于它的输出；未跳转时为-1。
+    std::atomic<qint64> seekTargetMs{-1};
+    // 跳转请求发出的时刻（steady_clock 纳秒）与最近一次跳转的耗时
+    std::atomic<qint64> seekStartNs{0};
+    std::atomic<qint64> lastSeekLatencyMs{-1};
+    // 跳转时是否填充 GOP 缓存：主线程随 seekRequest 一起写入前者，解复用线程执行跳转时转存到后者供解码线程读取
+    std::atomic<bool> seekFillRequest{false};
+    std::atomic<bool> seekFillGop{false};
+
+    // --- 打开握手 ---
+    enum class OpenState { Pending, Ready, Failed };
+    mutable QMutex openMutex;
+    QWaitCondition openCondition;
+    OpenState openState = OpenState::Pending;
+    QString openError; // 打开失败的原因
+
+    // --- 流控 ---
+    QMutex flowMutex;
+    QWaitCondition flowCondition;
+    // 正在 flowCondition 上等待的线程数，消费者据此决定是否需要加锁唤醒
+    std::atomic<int> waitingThreads{0};
+
+    // --- 输出分辨率 ---
+    // 呈现尺寸，由主线程写入、视频解码线程读取（两者各自原子，短暂不一致无害）
+    std::atomic<int> targetWidth{0};
+    std::atomic<int> targetHeight{0};
+    std::atomic<bool> fullResolution{false};
+    // 跳帧方式（SkipMode），由主线程写入、解复用线程和视频解码线程读取
+    std::atomic<int> frameSkipMode{DecodeAllFrames};
+    int sourceWidth = 0;  // 视频流的原始宽度
+    int sourceHeight = 0; // 视频流的原始高度
+
+    // --- 解码多线程配置 ---
+    int decoderThreadCount = 0;
+    bool frameThreadingEnabled = true;
+    bool sliceThreadingEnabled = true;
+
+    // --- FFmpeg 上下文（仅在 run() 执行期间有效） ---
+    AVFormatContext* formatCtx = nullptr;
+    AVCodecContext* videoCodecCtx = nullptr;
+    AVCodecContext* audioCodecCtx = nullptr;
+    int videoStreamIndex = -1;
+    int audioStreamIndex = -1;
+
+    // --- 关键帧索引（后台建立） ---
+    KeyframeIndex keyframeIndex;
+
+    // --- 已解码 GOP 缓存 ---
+    DecodedGopCache gopCache;
+    // 跳转命中缓存时，解复用线程把查到的画面交给视频解码线程（由 cachedSegmentMutex 保护）
+    QMutex cachedSegmentMutex;
+    int cachedSegmentSerial = -1; // 这些画面所属的跳转序号，-1 表示没有
+    std::vector<DecodedGopCache::Frame> cachedSegment;
+
+    // --- 数据包队列（解复用线程 -> 解码线程） ---
+    PacketQueue videoPackets;
+    PacketQueue audioPackets;
+
+    // --- 无锁数据缓冲区（解码线程 -> 播放端） ---
+    // [关键变量] 视频帧环形缓冲区。视频解码线程作为生产者，效果线程作为消费者。
+    SpscRingBuffer<VideoFrame> videoRing;
+    // [关键变量] 待显示帧环形缓冲区（已应用效果）。效果线程作为生产者，主线程作为消费者。
+    // 容量很小，效果参数的修改只需经过几帧就能显示出来。
+    SpscRingBuffer<VideoFrame> presentRing;
+    // [关键变量] PCM 环形缓冲区。音频解码线程作为生产者，AudioPullDevice 作为消费者。
+    // 存储空间预分配，跳转时由消费者按序号丢弃旧数据。
+    PcmRingBuffer audioRing;
+    std::atomic<bool> audioOutputEnabled{true};
+    // [关键变量] 视频帧缓冲池。按字节数限额，sws_scale 直接写入其中的缓冲，
+    // 播放端释放帧后缓冲自动回收复用，稳定播放时每帧不再分配内存。
+    FrameBufferPool framePool;
+    // [关键变量] 视频效果处理阶段，参数块以原子方式替换。
+    VideoEffectStage effectStage;
+    // 播放端发布的主时钟：时钟值（毫秒，-1 表示不丢帧）、发布时刻（纳秒）和播放速率（千分之一）
+    std::atomic<qint64> presentationClockMs{-1};
+    std::atomic<qint64> presentationClockNs{0};
+    std::atomic<int> presentationRatePermille{1000};
+    std::atomic<qint64> lateDroppedFrames{0};
+    // 帧观察回调，以 std::atomic_load/std::atomic_store 读写
+    std::shared_ptr<const FrameTap> frameTap;
+    // 音频观察回调，读写方式同上
+    std::shared_ptr<const AudioTap> audioTap;
+
+    // 遥测记录对象，可为nullptr；预取的解码器在闲置和播放之间切换时随时替换
+    std::atomic<VideoTelemetry*> telemetry{nullptr};
+
+    // --- 视频元数据 ---
+    double videoFPS = 0.0; // 视频的帧率
+    qint64 durationMs = 0; // 视频总时长（毫秒）
+};
+
+#endif // VIDEODECODER_H
@@ -0,0 +1,150 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+// =============================================================================
+// File: videoeffectstage.cpp
+//
+// Description:
+// VideoEffectStage 类的实现文件。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include "videoeffectstage.h"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <chrono>
+
+// 每个条带至少包含的行数
+static const int minBandRows = 32;
+
+static int64_t steadyNowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief VideoEffectStage 构造函数，初始参数为恒等效果。
+ */
+VideoEffectStage::VideoEffectStage()
+{
+    setParams(VideoEffectParams());
+}
+
+/**
+ * @brief 设置新的效果参数并生成查找表。
+ * @param params 新的效果参数。
+ */
+void VideoEffectStage::setParams(const VideoEffectParams &params)
+{
+    auto newTables = std::make_shared<Tables>();
+    newTables->params = params;
+
+    // 1. 亮度/对比度：g(x) = α*f(x) + β，α = 1 + contrast/100，β = brightness
+    newTables->adjustBrightnessContrast = params.brightness != 0 || params.contrast != 0;
+    newTables->brightnessContrastLut.create(1, 256, CV_8U);
+    const double alpha = 1.0 + params.contrast / 100.0;
+    for (int i = 0; i < 256; ++i) {
+        newTables->brightnessContrastLut.at<uchar>(i) = cv::saturate_cast<uchar>(alpha * i + params.brightness);
+    }
+
+    // 2. 饱和度：S * (1 + saturation/100)，超过255截断；色相：(H + hue) 模180
+    newTables->adjustSaturationHue = params.saturation != 0 || params.hue != 0;
+    const double satGain = 1.0 + params.saturation / 100.0;
+    for (int i = 0; i < 256; ++i) {
+        newTables->saturationLut[i] = cv::saturate_cast<uchar>(std::min(i * satGain, 255.0));
+        int h = (i + params.hue) % 180;
+        if (h < 0) h += 180;
+        newTables->hueLut[i] = static_cast<uchar>(h);
+    }
+
+    std::atomic_store(&tables, std::shared_ptr<const Tables>(std::move(newTables)));
+}
+
+/**
+ * @brief 当前的效果参数。
+ */
+VideoEffectParams VideoEffectStage::params() const
+{
+    return std::atomic_load(&tables)->params;
+}
+
+/**
+ * @brief 在BGR24帧上原地应用当前效果。
+ * @param frame 要处理的帧（CV_8UC3）。
+ */
+void VideoEffectStage::apply(cv::Mat &frame, Timings *timings) const
+{
+    const std::shared_ptr<const Tables> current = std::atomic_load(&tables);
+    if (current->params.isIdentity() || frame.empty() || frame.type() != CV_8UC3) return;
+
+    const int bandCount = std::clamp(frame.rows / minBandRows, 1, std::max(1, cv::getNumThreads()));
+    cv::parallel_for_(cv::Range(0, bandCount), [&](const cv::Range &range) {
+        for (int band = range.start; band < range.end; ++band) {
+            const int rowStart = frame.rows * band / bandCount;
+            const int rowEnd = frame.rows * (band + 1) / bandCount;
+            applyToRows(*current, frame, rowStart, rowEnd, timings);
+        }
+    });
+}
+
+/**
+ * @brief 处理一个水平条带。
+ *
+ * 条带足够小，可以留在缓存中依次完成亮度/对比度、HSV 调整和灰度化。
+ */
+void VideoEffectStage::applyToRows(const Tables &tables, cv::Mat &frame, int rowStart, int rowEnd, Timings *timings)
+{
+    cv::Mat rows = frame.rowRange(rowStart, rowEnd);
+    int64_t startNs = timings ? steadyNowNs() : 0;
+    // 累加一个效果从 startNs 到现在的耗时，并把起点移到现在
+    auto lap = [&](Effect effect) {
+        if (!timings) return;
+        const int64_t now = steadyNowNs();
+        timings->cpuNs[effect].fetch_add(now - startNs, std::memory_order_relaxed);
+        startNs = now;
+    };
+
+    if (tables.adjustBrightnessContrast) {
+        cv::LUT(rows, tables.brightnessContrastLut, rows);
+        lap(BrightnessContrast);
+    }
+
+    if (tables.adjustSaturationHue) {
+        cv::Mat hsv;
+        cv::cvtColor(rows, hsv, cv::COLOR_BGR2HSV);
+        for (int y = 0; y < hsv.rows; ++y) {
+            uchar *pixel = hsv.ptr<uchar>(y);
+            for (int x = 0; x < hsv.cols; ++x, pixel += 3) {
+                pixel[0] = tables.hueLut[pixel[0]];
+                pixel[1] = tables.saturationLut[pixel[1]];
+            }
+        }
+        cv::cvtColor(hsv, rows, cv::COLOR_HSV2BGR);
+        lap(SaturationHue);
+    }
+
+    if (tables.params.grayscale) {
+        cv::Mat gray;
+        cv::cvtColor(rows, gray, cv::COLOR_BGR2GRAY);
+        cv::cvtColor(gray, rows, cv::COLOR_GRAY2BGR);
+        lap(Grayscale);
+    }
+}
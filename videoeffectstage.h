@@ -0,0 +1,122 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+#ifndef VIDEOEFFECTSTAGE_H
+#define VIDEOEFFECTSTAGE_H
+
+// =============================================================================
+// File: videoeffectstage.h
+//
+// Description:
+// 该文件定义了 VideoEffectParams 结构体和 VideoEffectStage 类，
+// 在 cv::Mat 上原地执行视频的颜色调整与灰度效果。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include <opencv2/core.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+/**
+ * @struct VideoEffectParams
+ * @brief 视频效果参数（取值范围与图像调色功能一致）。
+ */
+struct VideoEffectParams {
+    int brightness = 0; // 亮度 (-100 to 100)
+    int contrast = 0;   // 对比度 (-100 to 100)
+    int saturation = 0; // 饱和度 (-100 to 100)
+    int hue = 0;        // 色相偏移 (-180 to 180)
+    bool grayscale = false;
+
+    bool isIdentity() const { return brightness == 0 && contrast == 0 && saturation == 0 && hue == 0 && !grayscale; }
+};
+
+/**
+ * @class VideoEffectStage
+ * @brief 视频效果处理阶段：在BGR24帧上原地应用颜色调整和灰度效果。
+ *
+ * [效果语义]
+ * 与 ImageProcessor::adjustColor 相同：先做亮度/对比度的线性变换，
+ * 再在HSV空间中调整饱和度（增益后截断到255）和色相（模180循环），最后可选灰度化。
+ * 区别在于全部在 cv::Mat 上完成，没有 QImage 往返和整帧拷贝：
+ * 亮度/对比度、饱和度、色相都预先计算成查找表，图像按水平条带由
+ * cv::parallel_for_ 并行处理，每个条带在缓存中一次完成全部效果。
+ *
+ * [线程约定]
+ * setParams() 可在任意线程（通常是主线程）调用，它生成新的查找表并以原子方式替换
+ * 参数块的指针；apply() 在开始时取一次指针，因此一帧之内参数不会被改到一半。
+ */
+class VideoEffectStage
+{
+public:
+    // 各个效果，用于分别统计耗时
+    enum Effect { BrightnessContrast, SaturationHue, Grayscale, EffectCount };
+
+    /**
+     * @struct Timings
+     * @brief 各效果在所有条带上累计的CPU耗时（纳秒），条带并行累加。
+     */
+    struct Timings {
+        std::atomic<int64_t> cpuNs[EffectCount] = {};
+    };
+
+    VideoEffectStage();
+
+    /**
+     * @brief 设置新的效果参数（任意线程）。
+     */
+    void setParams(const VideoEffectParams &params);
+
+    /**
+     * @brief 当前的效果参数（任意线程）。
+     */
+    VideoEffectParams params() const;
+
+    /**
+     * @brief 在BGR24帧上原地应用当前效果。参数为恒等时立即返回。
+     * @param frame 要处理的帧（CV_8UC3），会被直接修改。
+     * @param timings [out] 不为nullptr时累加各效果的耗时（调用者负责清零）。
+     */
+    void apply(cv::Mat &frame, Timings *timings = nullptr) const;
+
+private:
+    /**
+     * @struct Tables
+     * @brief 不可变的参数块：参数及由其生成的查找表。
+     */
+    struct Tables {
+        VideoEffectParams params;
+        bool adjustBrightnessContrast = false;
+        bool adjustSaturationHue = false;
+        cv::Mat brightnessContrastLut; // 1x256 CV_8U
+        uchar saturationLut[256];      // S 通道映射
+        uchar hueLut[256];             // H 通道映射（0~179 有效）
+    };
+
+    // 处理一个水平条带 [rowStart, rowEnd)
+    static void applyToRows(const Tables &tables, cv::Mat &frame, int rowStart, int rowEnd, Timings *timings);
+
+    // 当前参数块，以 std::atomic_load/std::atomic_store 读写
+    std::shared_ptr<const Tables> tables;
+};
+
+#endif // VIDEOEFFECTSTAGE_H
@@ -0,0 +1,421 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+// =============================================================================
+// File: videoexporter.cpp
+//
+// Description:
+// VideoExporter 类的实现文件。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include "videoexporter.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <algorithm>
+#include <vector>
+#include <opencv2/imgproc.hpp>
+#include <dlib/opencv.h>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libswresample/swresample.h>
+#include <libswscale/swscale.h>
+}
+
+// 人脸检测所用小图的最大宽度（像素）
+static const int faceDetectionWidth = 640;
+// 进度报告的最小间隔（毫秒）
+static const qint64 progressIntervalMs = 250;
+
+/**
+ * @brief VideoExporter 构造函数。
+ */
+VideoExporter::VideoExporter(QObject *parent)
+    : QThread(parent)
+{
+}
+
+/**
+ * @brief VideoExporter 析构函数，取消并等待导出线程。
+ */
+VideoExporter::~VideoExporter()
+{
+    cancel();
+    wait();
+}
+
+/**
+ * @brief 在后台线程中依次导出文件。
+ */
+void VideoExporter::exportFiles(const QStringList &inputs, const QString &outputDir, const Options &options)
+{
+    if (isRunning()) return;
+    inputFiles = inputs;
+    outputDirectory = outputDir;
+    exportOptions = options;
+    effectStage.setParams(options.effects);
+    cancelled.store(false, std::memory_order_relaxed);
+    start();
+}
+
+/**
+ * @brief 取消导出，唤醒所有等待中的线程。
+ */
+void VideoExporter::cancel()
+{
+    cancelled.store(true, std::memory_order_relaxed);
+    QMutexLocker locker(&mutex);
+    jobAvailable.wakeAll();
+    jobSpace.wakeAll();
+    resultAvailable.wakeAll();
+    resultSpace.wakeAll();
+}
+
+/**
+ * @brief 某个输入文件对应的输出路径。
+ */
+QString VideoExporter::outputPathFor(const QString &input, const QString &outputDir, VideoRecorder::Preset preset)
+{
+    const QFileInfo info(input);
+    return QDir(outputDir).filePath(QString("%1_export.%2").arg(info.completeBaseName(), VideoRecorder::presetExtension(preset)));
+}
+
+/**
+ * @brief 导出线程主函数：依次导出每个文件。
+ */
+void VideoExporter::run()
+{
+    for (int i = 0; i < inputFiles.size() && !wasCancelled(); ++i) {
+        currentFileIndex = i;
+        const QString output = outputPathFor(inputFiles[i], outputDirectory, exportOptions.preset);
+        QString message;
+        const bool success = exportFile(inputFiles[i], output, message);
+        emit fileExported(inputFiles[i], output, success, message);
+    }
+}
+
+/**
+ * @brief [导出线程] 导出一个文件。
+ */
+bool VideoExporter::exportFile(const QString &input, const QString &output, QString &message)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // 1. 打开输入文件和解码器
+    AVFormatContext *formatCtx = nullptr;
+    if (avformat_open_input(&formatCtx, input.toLocal8Bit().constData(), nullptr, nullptr) != 0) {
+        message = "无法打开文件。"; return false;
+    }
+    if (avformat_find_stream_info(formatCtx, nullptr) < 0) {
+        avformat_close_input(&formatCtx); message = "无法读取流信息。"; return false;
+    }
+    const int videoIndex = av_find_best_stream(formatCtx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    const int audioIndex = av_find_best_stream(formatCtx, AVMEDIA_TYPE_AUDIO, -1, videoIndex, nullptr, 0);
+    if (videoIndex < 0) {
+        avformat_close_input(&formatCtx); message = "文件中没有视频流。"; return false;
+    }
+    for (unsigned i = 0; i < formatCtx->nb_streams; ++i) {
+        if (static_cast<int>(i) != videoIndex && static_cast<int>(i) != audioIndex) formatCtx->streams[i]->discard = AVDISCARD_ALL;
+    }
+
+    auto openCodec = [&](int streamIndex, bool threaded) -> AVCodecContext * {
+        AVStream *stream = formatCtx->streams[streamIndex];
+        const AVCodec *codec = avcodec_find_decoder(stream->codecpar->codec_id);
+        AVCodecContext *ctx = codec ? avcodec_alloc_context3(codec) : nullptr;
+        if (!ctx) return nullptr;
+        avcodec_parameters_to_context(ctx, stream->codecpar);
+        ctx->pkt_timebase = stream->time_base;
+        if (threaded) {
+            // 离线导出不在乎解码延迟，帧级和片级多线程同时启用以获得最大吞吐量
+            ctx->thread_count = 0;
+            ctx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+        }
+        if (avcodec_open2(ctx, codec, nullptr) < 0) avcodec_free_context(&ctx);
+        return ctx;
+    };
+    AVCodecContext *videoCtx = openCodec(videoIndex, true);
+    AVCodecContext *audioCtx = audioIndex >= 0 ? openCodec(audioIndex, false) : nullptr;
+    if (!videoCtx) {
+        avcodec_free_context(&audioCtx); avformat_close_input(&formatCtx);
+        message = "无法打开视频解码器。"; return false;
+    }
+
+    AVStream *videoStream = formatCtx->streams[videoIndex];
+    const double fps = av_q2d(av_guess_frame_rate(formatCtx, videoStream, nullptr));
+    currentDurationMs = formatCtx->duration != AV_NOPTS_VALUE ? formatCtx->duration / 1000 : 0;
+
+    SwrContext *swrCtx = nullptr;
+    if (audioCtx) {
+        AVChannelLayout stereo = AV_CHANNEL_LAYOUT_STEREO;
+        swr_alloc_set_opts2(&swrCtx, &stereo, AV_SAMPLE_FMT_S16, 48000,
+                            &audioCtx->ch_layout, audioCtx->sample_fmt, audioCtx->sample_rate, 0, nullptr);
+        if (!swrCtx || swr_init(swrCtx) < 0) {
+            swr_free(&swrCtx);
+            avcodec_free_context(&audioCtx); // 音频无法重采样时只导出画面
+        }
+    }
+
+    // 2. 打开编码器（阻塞模式：编码跟不上时让流水线等待，而不是丢帧）
+    VideoRecorder recorder;
+    recorder.setBlocking(true);
+    if (!recorder.startRecording(output, cv::Size(videoCtx->width, videoCtx->height), fps, exportOptions.preset, audioCtx != nullptr)) {
+        message = recorder.errorString();
+        swr_free(&swrCtx); avcodec_free_context(&audioCtx); avcodec_free_context(&videoCtx); avformat_close_input(&formatCtx);
+        return false;
+    }
+
+    // 3. 启动效果线程和写出线程
+    const int workerCount = exportOptions.workerCount > 0 ? exportOptions.workerCount : std::max(1, QThread::idealThreadCount() - 1);
+    {
+        QMutexLocker locker(&mutex);
+        jobs.clear();
+        reorder.clear();
+        jobCount = 0;
+        nextWriteSeq = 0;
+        inputFinished = false;
+        maxQueuedJobs = workerCount * 2;
+        reorderWindow = workerCount * 4;
+    }
+    framesWritten.store(0, std::memory_order_relaxed);
+    std::vector<QThread *> workers;
+    for (int i = 0; i < workerCount; ++i) {
+        workers.push_back(QThread::create([this] { effectWorker(); }));
+        workers.back()->start();
+    }
+    QThread *writer = QThread::create([this, &recorder] { writerLoop(&recorder); });
+    writer->start();
+
+    // 4. 解复用与解码
+    AVPacket *packet = av_packet_alloc();
+    AVFrame *frame = av_frame_alloc();
+    SwsContext *swsCtx = nullptr;
+    const AVRational videoTimeBase = videoStream->time_base;
+
+    auto receiveVideoFrames = [&]() {
+        while (!wasCancelled() && avcodec_receive_frame(videoCtx, frame) == 0) {
+            swsCtx = sws_getCachedContext(swsCtx, frame->width, frame->height, static_cast<AVPixelFormat>(frame->format),
+                                          frame->width, frame->height, AV_PIX_FMT_BGR24, SWS_BILINEAR, nullptr, nullptr, nullptr);
+            if (!swsCtx) { av_frame_unref(frame); continue; }
+            Job job;
+            job.frame.create(frame->height, frame->width, CV_8UC3);
+            uint8_t *dest[] = { job.frame.data };
+            int destLinesize[] = { static_cast<int>(job.frame.step) };
+            sws_scale(swsCtx, frame->data, frame->linesize, 0, frame->height, dest, destLinesize);
+            const int64_t pts = frame->best_effort_timestamp;
+            job.pts = pts != AV_NOPTS_VALUE ? av_rescale_q(pts, videoTimeBase, AVRational{1, 1000})
+                                            : qRound64(jobCount * 1000.0 / (fps > 0 ? fps : 25.0));
+            av_frame_unref(frame);
+            if (!pushJob(std::move(job))) return;
+        }
+    };
+    auto receiveAudioFrames = [&]() {
+        while (!wasCancelled() && avcodec_receive_frame(audioCtx, frame) == 0) {
+            const int capacity = swr_get_out_samples(swrCtx, frame->nb_samples);
+            QByteArray pcm(capacity * 4, Qt::Uninitialized);
+            uint8_t *out[] = { reinterpret_cast<uint8_t *>(pcm.data()) };
+            const int converted = swr_convert(swrCtx, out, capacity, const_cast<const uint8_t **>(frame->extended_data), frame->nb_samples);
+            av_frame_unref(frame);
+            if (converted <= 0) continue;
+            pcm.resize(converted * 4);
+            recorder.pushAudio(pcm);
+        }
+    };
+    auto decode = [&](AVCodecContext *ctx, const AVPacket *pkt, auto &&receive) {
+        int result = avcodec_send_packet(ctx, pkt);
+        if (result == AVERROR(EAGAIN)) {
+            receive();
+            result = avcodec_send_packet(ctx, pkt);
+        }
+        receive();
+    };
+
+    while (!wasCancelled() && av_read_frame(formatCtx, packet) >= 0) {
+        if (packet->stream_index == videoIndex) decode(videoCtx, packet, receiveVideoFrames);
+        else if (audioCtx && packet->stream_index == audioIndex) decode(audioCtx, packet, receiveAudioFrames);
+        av_packet_unref(packet);
+    }
+    if (!wasCancelled()) {
+        // 冲刷解码器中缓存的帧
+        decode(videoCtx, nullptr, receiveVideoFrames);
+        if (audioCtx) decode(audioCtx, nullptr, receiveAudioFrames);
+    }
+
+    // 5. 结束流水线
+    {
+        QMutexLocker locker(&mutex);
+        inputFinished = true;
+        jobAvailable.wakeAll();
+        resultAvailable.wakeAll();
+    }
+    for (QThread *worker : workers) {
+        worker->wait();
+        delete worker;
+    }
+    writer->wait();
+    delete writer;
+    recorder.stopRecording();
+
+    av_frame_free(&frame);
+    av_packet_free(&packet);
+    sws_freeContext(swsCtx);
+    swr_free(&swrCtx);
+    avcodec_free_context(&audioCtx);
+    avcodec_free_context(&videoCtx);
+    avformat_close_input(&formatCtx);
+
+    if (wasCancelled()) {
+        QFile::remove(output);
+        message = "已取消。";
+        return false;
+    }
+    const qint64 frames = framesWritten.load(std::memory_order_relaxed);
+    const double seconds = std::max<qint64>(1, timer.elapsed()) / 1000.0;
+    message = QString("%1 帧，用时 %2 秒，平均 %3 fps").arg(frames).arg(seconds, 0, 'f', 1).arg(frames / seconds, 0, 'f', 1);
+    qDebug() << "导出完成:" << output << message;
+    return true;
+}
+
+/**
+ * @brief [导出线程] 把解码好的帧放入任务队列。
+ */
+bool VideoExporter::pushJob(Job &&job)
+{
+    QMutexLocker locker(&mutex);
+    while (!wasCancelled() && static_cast<int>(jobs.size()) >= maxQueuedJobs) {
+        jobSpace.wait(&mutex);
+    }
+    if (wasCancelled()) return false;
+    job.seq = jobCount++;
+    jobs.push_back(std::move(job));
+    jobAvailable.wakeOne();
+    return true;
+}
+
+/**
+ * @brief [效果线程] 取帧、应用效果，放入重组缓冲区。
+ *
+ * 任务按序号先进先出地被取走，所以持有“下一个待写序号”的线程一定不会在窗口处等待。
+ */
+void VideoExporter::effectWorker()
+{
+    // dlib 检测器不是线程安全的，每个线程持有自己的副本
+    dlib::frontal_face_detector detector;
+    if (exportOptions.drawFaces) detector = dlib::get_frontal_face_detector();
+
+    while (true) {
+        Job job;
+        {
+            QMutexLocker locker(&mutex);
+            while (!wasCancelled() && jobs.empty() && !inputFinished) {
+                jobAvailable.wait(&mutex);
+            }
+            if (wasCancelled() || jobs.empty()) return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+            jobSpace.wakeOne();
+        }
+
+        effectStage.apply(job.frame);
+        if (exportOptions.drawFaces) drawFaceBoxes(job.frame, detector);
+
+        QMutexLocker locker(&mutex);
+        while (!wasCancelled() && job.seq >= nextWriteSeq + reorderWindow) {
+            resultSpace.wait(&mutex);
+        }
+        if (wasCancelled()) return;
+        reorder.emplace(job.seq, std::move(job));
+        resultAvailable.wakeAll();
+    }
+}
+
+/**
+ * @brief [写出线程] 按序号从重组缓冲区取帧交给编码器，并报告进度。
+ */
+void VideoExporter::writerLoop(VideoRecorder *recorder)
+{
+    QElapsedTimer timer;
+    timer.start();
+    qint64 lastReportMs = -progressIntervalMs;
+    qint64 firstPts = -1;
+
+    while (true) {
+        Job job;
+        {
+            QMutexLocker locker(&mutex);
+            auto ready = [&] { return reorder.count(nextWriteSeq) > 0; };
+            while (!wasCancelled() && !ready() && !(inputFinished && nextWriteSeq >= jobCount)) {
+                resultAvailable.wait(&mutex);
+            }
+            if (wasCancelled() || !ready()) return;
+            auto it = reorder.find(nextWriteSeq);
+            job = std::move(it->second);
+            reorder.erase(it);
+            ++nextWriteSeq;
+            resultSpace.wakeAll();
+        }
+
+        if (!recorder->pushVideoFrame(job.frame, job.pts)) return;
+        const qint64 frames = framesWritten.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (firstPts < 0) firstPts = job.pts;
+
+        const qint64 elapsedMs = timer.elapsed();
+        if (elapsedMs - lastReportMs >= progressIntervalMs) {
+            lastReportMs = elapsedMs;
+            const qint64 mediaMs = job.pts - firstPts;
+            const double fraction = currentDurationMs > 0 ? std::clamp(static_cast<double>(mediaMs) / currentDurationMs, 0.0, 1.0) : 0.0;
+            const double fps = elapsedMs > 0 ? frames * 1000.0 / elapsedMs : 0.0;
+            // 按已处理的媒体时长与耗时之比估算剩余时间
+            const qint64 etaMs = (mediaMs > 0 && currentDurationMs > 0)
+                                     ? qRound64(static_cast<double>(currentDurationMs - mediaMs) * elapsedMs / mediaMs) : -1;
+            emit progress(currentFileIndex, inputFiles.size(), fraction, fps, std::max<qint64>(-1, etaMs));
+        }
+    }
+}
+
+/**
+ * @brief 在帧上画出检测到的人脸框。
+ *
+ * 与播放时一致，在缩小的灰度图上检测，再把人脸框换算回原始帧坐标。
+ */
+void VideoExporter::drawFaceBoxes(cv::Mat &frame, dlib::frontal_face_detector &detector)
+{
+    const double scale = frame.cols > faceDetectionWidth ? static_cast<double>(faceDetectionWidth) / frame.cols : 1.0;
+    cv::Mat small, gray;
+    if (scale < 1.0) cv::resize(frame, small, cv::Size(), scale, scale, cv::INTER_AREA);
+    else small = frame;
+    cv::cvtColor(small, gray, cv::COLOR_BGR2GRAY);
+    try {
+        dlib::cv_image<unsigned char> image(gray);
+        for (const dlib::rectangle &face : detector(image)) {
+            const cv::Rect rect(cvRound(face.left() / scale), cvRound(face.top() / scale),
+                                cvRound(face.width() / scale), cvRound(face.height() / scale));
+            cv::rectangle(frame, rect, cv::Scalar(0, 255, 0), 2);
+        }
+    } catch (const std::exception &e) {
+        qWarning() << "dlib face detection failed:" << e.what();
+    }
+}
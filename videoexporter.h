@@ -0,0 +1,165 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+#ifndef VIDEOEXPORTER_H
+#define VIDEOEXPORTER_H
+
+// =============================================================================
+// File: videoexporter.h
+//
+// Description:
+// 该文件定义了 VideoExporter 类，把视频效果离线批量应用到整个文件并编码输出，
+// 不受音频时钟和显示节奏的限制，速度只取决于CPU。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QStringList>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <opencv2/core.hpp>
+#include <dlib/image_processing/frontal_face_detector.h>
+#include "videoeffectstage.h"
+#include "videorecorder.h"
+
+/**
+ * @class VideoExporter
+ * @brief 离线视频导出器：解复用 → 多线程解码 → 并行逐帧效果 → 按序重组 → 编码。
+ *
+ * [流水线]
+ * 1. 导出线程 (run) 依次处理每个文件：解复用，视频用 FFmpeg 帧级/片级多线程解码并转为BGR24，
+ *    每帧带上递增的序号放入有界的任务队列；音频解码后直接交给编码器。
+ * 2. 若干效果工作线程从任务队列取帧，应用 VideoEffectStage 的颜色效果，
+ *    需要时检测人脸并画框，完成的帧放入按序号排序的重组缓冲区。
+ * 3. 写出线程按序号从重组缓冲区取帧，交给阻塞模式的 VideoRecorder 编码，不丢帧。
+ *
+ * 重组缓冲区以窗口限额：序号超出“下一个待写序号 + 窗口”的帧要等待，
+ * 持有下一个待写帧的线程永远不会被挡住，因此不会死锁，内存也有上限。
+ *
+ * [使用]
+ * 不依赖任何界面控件，可以在没有窗口的程序中直接使用：
+ * 调用 exportFiles() 后通过 progress/fileExported 信号和 QThread::finished 获取结果，cancel() 可随时取消。
+ */
+class VideoExporter : public QThread
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @struct Options
+     * @brief 导出参数。
+     */
+    struct Options {
+        VideoEffectParams effects;                              // 颜色效果
+        bool drawFaces = false;                                 // 是否画人脸框
+        VideoRecorder::Preset preset = VideoRecorder::VeryFast; // 编码预设
+        int workerCount = 0;                                    // 效果线程数，0 表示按CPU核心数
+    };
+
+    explicit VideoExporter(QObject *parent = nullptr);
+    ~VideoExporter();
+
+    /**
+     * @brief 在后台线程中依次导出文件。正在导出时调用无效。
+     * @param inputs 输入视频文件路径列表。
+     * @param outputDir 输出目录。
+     * @param options 导出参数。
+     */
+    void exportFiles(const QStringList &inputs, const QString &outputDir, const Options &options);
+
+    /**
+     * @brief 取消导出。正在写的文件会被删除。
+     */
+    void cancel();
+    bool wasCancelled() const { return cancelled.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 某个输入文件对应的输出路径：<输出目录>/<文件名>_export.<扩展名>。
+     */
+    static QString outputPathFor(const QString &input, const QString &outputDir, VideoRecorder::Preset preset);
+
+signals:
+    /**
+     * @brief 导出进度，约每250毫秒报告一次。
+     * @param fileIndex 当前文件的序号（从0开始）。
+     * @param fileCount 文件总数。
+     * @param fraction 当前文件已完成的比例 (0~1)。
+     * @param fps 当前文件的平均处理速度（帧/秒）。
+     * @param etaMs 当前文件预计的剩余时间（毫秒），未知时为-1。
+     */
+    void progress(int fileIndex, int fileCount, double fraction, double fps, qint64 etaMs);
+    // 一个文件导出完成（或失败、被取消）
+    void fileExported(const QString &input, const QString &output, bool success, const QString &message);
+
+protected:
+    // 导出线程的主函数
+    void run() override;
+
+private:
+    struct Job {
+        qint64 seq = 0;
+        qint64 pts = 0;
+        cv::Mat frame;
+    };
+
+    // [导出线程] 导出一个文件
+    bool exportFile(const QString &input, const QString &output, QString &message);
+    // [导出线程] 把解码好的帧放入任务队列，队列满时等待；取消时返回false
+    bool pushJob(Job &&job);
+    // [效果线程] 主函数
+    void effectWorker();
+    // [写出线程] 主函数：按序号取帧交给编码器
+    void writerLoop(VideoRecorder *recorder);
+    // 在帧上画出检测到的人脸框（在缩小的灰度图上检测）
+    static void drawFaceBoxes(cv::Mat &frame, dlib::frontal_face_detector &detector);
+
+    // --- 导出参数（启动前设置） ---
+    QStringList inputFiles;
+    QString outputDirectory;
+    Options exportOptions;
+    VideoEffectStage effectStage;
+
+    // --- 当前文件的流水线状态（由 mutex 保护） ---
+    QMutex mutex;
+    QWaitCondition jobAvailable;    // 任务队列非空或输入结束
+    QWaitCondition jobSpace;        // 任务队列有空位
+    QWaitCondition resultAvailable; // 重组缓冲区收到新帧
+    QWaitCondition resultSpace;     // 下一个待写序号前进
+    std::deque<Job> jobs;
+    std::map<qint64, Job> reorder;  // 重组缓冲区，按序号排序
+    qint64 jobCount = 0;            // 已产生的帧数（下一个序号）
+    qint64 nextWriteSeq = 0;        // 下一个要写出的序号
+    bool inputFinished = false;
+    int maxQueuedJobs = 8;
+    int reorderWindow = 16;
+
+    // --- 进度 ---
+    int currentFileIndex = 0;
+    qint64 currentDurationMs = 0;
+    std::atomic<qint64> framesWritten{0};
+
+    std::atomic<bool> cancelled{false};
+};
+
+#endif // VIDEOEXPORTER_H
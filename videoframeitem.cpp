@@ -0,0 +1,73 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+// =============================================================================
+// File: videoframeitem.cpp
+//
+// Description:
+// VideoFrameItem 类的实现文件。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include "videoframeitem.h"
+#include <QPainter>
+
+/**
+ * @brief VideoFrameItem 构造函数。
+ */
+VideoFrameItem::VideoFrameItem(QGraphicsItem *parent)
+    : QGraphicsItem(parent)
+{
+    // 帧每次都整体更换，缓存只会多一次拷贝
+    setCacheMode(QGraphicsItem::NoCache);
+}
+
+/**
+ * @brief 更换显示的帧，只在分辨率变化时改变几何尺寸。
+ */
+bool VideoFrameItem::setImage(const QImage &image)
+{
+    const bool resized = image.size() != frame.size();
+    if (resized) prepareGeometryChange();
+    frame = image;
+    update();
+    return resized;
+}
+
+/**
+ * @brief 返回该项的边界矩形（帧的像素尺寸）。
+ */
+QRectF VideoFrameItem::boundingRect() const
+{
+    return QRectF(QPointF(0, 0), frame.size());
+}
+
+/**
+ * @brief 直接把帧画到视图上，缩放由视图变换完成。
+ */
+void VideoFrameItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    Q_UNUSED(option);
+    Q_UNUSED(widget);
+    if (frame.isNull()) return;
+    painter->setRenderHint(QPainter::SmoothPixmapTransform);
+    painter->drawImage(boundingRect(), frame);
+}
@@ -0,0 +1,66 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+#ifndef VIDEOFRAMEITEM_H
+#define VIDEOFRAMEITEM_H
+
+// =============================================================================
+// File: videoframeitem.h
+//
+// Description:
+// 该文件定义了 VideoFrameItem 类，在视频场景中直接绘制视频帧的图形项。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include <QGraphicsItem>
+#include <QImage>
+
+/**
+ * @class VideoFrameItem
+ * @brief 视频帧图形项：直接绘制 QImage，不经过 QPixmap。
+ *
+ * 播放时传入的 QImage 由 ImageConverter::wrapMat() 包装帧缓冲池中的 BGR 缓冲
+ * (Format_BGR888)，没有通道交换和像素拷贝；paint() 直接把它画到视图上。
+ * 与 QGraphicsPixmapItem 相比省掉了 QImage → QPixmap 的整帧转换。
+ * 只有帧的分辨率改变时 setImage() 才改变几何尺寸并返回true，
+ * 调用者只需在这时（以及视图尺寸改变时）重新计算缩放，而不是每一帧都 fitInView。
+ */
+class VideoFrameItem : public QGraphicsItem
+{
+public:
+    explicit VideoFrameItem(QGraphicsItem *parent = nullptr);
+
+    /**
+     * @brief 更换显示的帧。
+     * @param image 新的帧，图形项持有它的引用直到下一帧到来。
+     * @return 分辨率发生变化时返回true。
+     */
+    bool setImage(const QImage &image);
+    const QImage &image() const { return frame; }
+
+    QRectF boundingRect() const override;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = nullptr) override;
+
+private:
+    QImage frame; // 当前帧
+};
+
+#endif // VIDEOFRAMEITEM_H
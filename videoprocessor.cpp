@@ -21,21 +21,21 @@
 // File: videoprocessor.cpp
 //
 // Description:
-// VideoProcessor 和 VideoDecoder 类的实现文件。这是整个视频播放功能
+// VideoProcessor 类的实现文件。这是整个视频播放功能
 // 的核心，采用了典型的“生产者-消费者”多线程模型。
 //
 // [架构概览]
-// 1. VideoDecoder (生产者): 运行在一个独立的后台线程。它使用FFmpeg库
-//    来解码视频文件，将解码出的视频帧(cv::Mat)和音频块(QByteArray)
-//    分别放入两个线程安全的队列中。
+// 1. VideoDecoder (生产者, 见 videodecoder.cpp): 运行在独立的后台线程中。
+//    它使用FFmpeg库解复用并解码视频文件，将解码出的视频帧(cv::Mat)和
+//    PCM 音频分别放入单生产者/单消费者的无锁环形缓冲区中。
 // 2. VideoProcessor (消费者/控制器): 运行在主GUI线程。它负责：
 //    a. 响应用户的UI操作（播放、暂停、跳转等）。
 //    b. 创建和管理VideoDecoder线程。
-//    c. 创建一个QTimer作为“播放心跳”，定时从VideoDecoder的队列中取出数据。
-//    d. 使用QAudioSink播放音频。
-//    e. 以音频播放的进度为基准（音频时钟），从视频队列中取出最匹配的
-//       一帧进行显示，从而实现音视频同步。
-//    f. 在显示前，对视频帧应用各种视觉效果。
+//    c. 由 PresentationScheduler 按帧的显示时刻驱动刷新，从VideoDecoder的缓冲区中取出数据。
+//    d. 使用QAudioSink播放音频：AudioSink 以拉取模式经 AudioPullDevice 直接读取PCM环形缓冲区。
+//    e. 以音频播放的进度为主时钟（变速时为墙上时钟），从视频缓冲区中取出最匹配的
+//       一帧进行显示，从而实现音视频同步；来不及显示的帧被丢弃并计数。
+//    f. 把效果控件的参数交给解码器的效果线程，视频效果在那里并行处理。
 //
 // Author: g64
 // Date: 2025-07-25
@@ -44,7 +44,6 @@
 #include "videoprocessor.h"
 #include "ui_mainwindow.h"
 #include "imageconverter.h"
-#include "imageprocessor.h"
 #include <QStringListModel>
 #include <QFileDialog>
 #include <QMessageBox>
@@ -52,287 +51,149 @@
 #include <QTemporaryFile>
 #include <QAudioDevice>
 #include <QMediaDevices>
+#include <QScreen>
+#include <QEvent>
+#include <QApplication>
+#include <QFileInfo>
+#include <QStatusBar>
+#include <QProgressDialog>
+#include <QElapsedTimer>
 #include <QTimer>
 #include <algorithm> // For std::sort
 
-// 包含 FFmpeg C语言头文件
-extern "C" {
-#include <libavformat/avformat.h>
-#include <libavcodec/avcodec.h>
-#include <libswresample/swresample.h>
-#include <libavutil/imgutils.h>
-#include <libswscale/swscale.h>
-#include <libavutil/opt.h>
-}
-
 // =============================================================================
-// VideoDecoder Implementation (生产者线程)
+// VideoProcessor Implementation (消费者/控制器)
 // =============================================================================
 
 /**
- * @brief VideoDecoder 构造函数。
- */
-VideoDecoder::VideoDecoder(QObject* parent) : QThread(parent) {}
-
-/**
- * @brief VideoDecoder 析构函数。
- *
- * 确保线程在对象销毁前被安全地停止和等待。这是一个良好实践，
- * 可以防止悬挂线程或资源泄漏。
+ * @brief 按播放速率选择解码的跳帧方式：4倍速跳过不被参考的帧，8倍速以上只解码关键帧。
  */
-VideoDecoder::~VideoDecoder() {
-    stop(); // 设置停止标志
-    wait(); // 等待run()函数执行完毕
+static VideoDecoder::SkipMode skipModeForRate(qreal rate)
+{
+    if (rate >= 8.0) return VideoDecoder::KeyframesOnly;
+    if (rate >= 4.0) return VideoDecoder::SkipNonReference;
+    return VideoDecoder::DecodeAllFrames;
 }
 
-/**
- * @brief 启动解码过程。
- * @param filePath 要解码的视频文件路径。
- * @return 如果视频成功打开并获取到时长信息，则返回true。
- */
-bool VideoDecoder::startDecoding(const QString &filePath) {
-    // 如果上一个解码线程还在运行，先停止并等待它结束
-    if (isRunning()) {
-        stop();
-        wait();
-    }
-    // 设置新的文件路径和状态
-    sourcePath = filePath;
-    stopped = false;
-    seekRequest = -1;
-    // 启动新线程，Qt会自动调用run()方法
-    start();
-    // 短暂等待，以确保FFmpeg有时间打开文件并获取时长。
-    // 这是一个简单的同步机制，让调用者可以立即知道文件是否有效。
-    msleep(200);
-    return durationMs > 0;
+VideoProcessor::VideoProcessor(Ui::MainWindow *ui, QObject *parent)
+    : QObject(parent), ui(ui)
+{
+    videoListModel = new QStringListModel(this);
+    ui->videoListView->setModel(videoListModel);
+    ui->speedComboBox->addItems({"0.5x", "1.0x", "1.5x", "2.0x", "4.0x", "8.0x", "16.0x"});
+    ui->speedComboBox->setCurrentIndex(1);
+    ui->filterComboBox->addItems({"无", "模糊", "锐化"});
+    thumbnailTrack = new ThumbnailTrack(this);
+    faceAnalyzer = new FaceAnalyzer(this);
+    recorder = new VideoRecorder(this);
+    exporter = new VideoExporter(this);
+    scheduler = new PresentationScheduler(this);
+    audioDevice = new AudioPullDevice(this);
+    telemetry = new VideoTelemetry(this);
+    stillFrameTimer = new QTimer(this);
+    stillFrameTimer->setInterval(5);
+    connect(stillFrameTimer, &QTimer::timeout, this, &VideoProcessor::presentStillFrame);
+    prefetcher = new DecoderPrefetcher(this);
+    // 播放列表变化后，相邻的视频可能也变了
+    connect(videoListModel, &QAbstractItemModel::dataChanged, this, [this]() { if (decoderThread) prefetchNeighbours(); });
+    connect(videoListModel, &QAbstractItemModel::rowsRemoved, this, [this]() { if (decoderThread) prefetchNeighbours(); });
+    connect(telemetry, &VideoTelemetry::sampling, this, [this]() {
+        if (decoderThread) decoderThread->sampleTelemetry();
+        telemetry->setGauge(VideoTelemetry::AvDriftMs, lastAvDriftMs);
+    });
+    connect(scheduler, &PresentationScheduler::tick, this, &VideoProcessor::updateDisplay);
+    connect(scheduler, &PresentationScheduler::statsUpdated, this, [this](qint64 presented, qint64 dropped, qint64 late) {
+        ui->timeLabel->setToolTip(QString("已显示 %1 帧，丢弃 %2 帧，迟到 %3 帧").arg(presented).arg(dropped).arg(late));
+    });
+    ui->recordPresetComboBox->addItems(VideoRecorder::presetNames());
+    ui->recordPresetComboBox->setCurrentIndex(VideoRecorder::VeryFast);
+    connect(recorder, &VideoRecorder::statsUpdated, this, [this](qint64 encoded, qint64 dropped, qint64 late) {
+        if (!recorder->isRecording()) return;
+        ui->statusbar->showMessage(QString("录制中：已编码 %1 帧，丢弃 %2 帧，迟到 %3 帧").arg(encoded).arg(dropped).arg(late));
+    });
+    ui->controlBar->setEnabled(false);
+    ui->videoEffectsToolBox->setEnabled(false);
+    ui->videoView->viewport()->installEventFilter(this);
+    connect(ui->videoBrightnessSlider, &QSlider::valueChanged, this, &VideoProcessor::updateEffectParams);
+    connect(ui->videoContrastSlider, &QSlider::valueChanged, this, &VideoProcessor::updateEffectParams);
+    connect(ui->videoSaturationSlider, &QSlider::valueChanged, this, &VideoProcessor::updateEffectParams);
+    connect(ui->videoHueSlider, &QSlider::valueChanged, this, &VideoProcessor::updateEffectParams);
+    connect(ui->grayscaleCheckBox, &QCheckBox::toggled, this, &VideoProcessor::updateEffectParams);
+    connect(ui->faceDetectCheckBox, &QCheckBox::toggled, this, &VideoProcessor::updateFaceAnalysis);
 }
 
-/**
- * @brief 请求停止解码线程。
- *
- * 这是一个线程安全的异步停止请求。它只设置标志位，
- * run()循环会在下一次迭代时检查这个标志并自行退出。
- */
-void VideoDecoder::stop() {
-    stopped = true;
+VideoProcessor::~VideoProcessor() {
+    stopCurrentVideo();
 }
 
 /**
- * @brief 请求跳转到指定时间点。
- *
- * 这是一个线程安全的异步跳转请求。它只设置请求的时间点，
- * run()循环会在下一次迭代时检查到并执行实际的跳转操作。
- * @param ms 目标时间点（毫秒）。
+ * @brief 事件过滤器：视频视图尺寸变化时更新解码输出尺寸。
  */
-void VideoDecoder::seek(qint64 ms) {
-    seekRequest = ms;
+bool VideoProcessor::eventFilter(QObject *watched, QEvent *event) {
+    if (watched == ui->videoView->viewport() && event->type() == QEvent::Resize) {
+        updateDecoderTargetSize();
+    }
+    return QObject::eventFilter(watched, event);
 }
 
 /**
- * @brief 从视频队列中获取与当前音频时间戳最匹配的视频帧。
+ * @brief 把视频视图的物理像素尺寸设为解码线程的呈现尺寸。
  *
- * 这是实现音视频同步的关键部分。它以音频播放进度为基准，
- * 从视频队列中找到时间上最接近的一帧。
- * @param audio_pts 当前音频播放的时间戳（毫秒）。
- * @return 匹配的视频帧 (cv::Mat)。
+ * 帧最终会被 fitInView 缩放到视图大小，解码线程直接输出这个尺寸，
+ * 4K 视频在小窗口中播放时颜色转换、特效处理和上传的开销都随之成倍下降。
  */
-cv::Mat VideoDecoder::getVideoFrame(qint64 audio_pts) {
-    QMutexLocker locker(&mutex); // 锁定互斥锁，保护队列访问
-    cv::Mat frame;
-    // 循环丢弃所有时间戳小于等于当前音频时间戳的“过时”视频帧。
-    // 这确保了视频不会落后于音频。
-    while (!videoQueue.isEmpty() && videoQueue.head().pts <= audio_pts) {
-        frame = videoQueue.dequeue().frame; // 取出帧
-        // 优化：如果取出当前帧后，下一帧的时间戳已经超前于音频，
-        // 那么当前帧就是最完美的匹配，无需再继续寻找。
-        if (!videoQueue.isEmpty() && videoQueue.head().pts > audio_pts) break;
-    }
-    return frame; // 返回找到的最佳匹配帧，或者最后一帧
+void VideoProcessor::updateDecoderTargetSize() {
+    if (!decoderThread) return;
+    const QSize size = viewTargetSize();
+    decoderThread->setTargetSize(size.width(), size.height());
 }
 
 /**
- * @brief 从音频队列中获取一个音频块。
- * @return 音频数据块 (QByteArray)。
+ * @brief 视频视图的物理像素尺寸。
  */
-QByteArray VideoDecoder::getAudioChunk() {
-    QMutexLocker locker(&mutex); // 锁定互斥锁，保护队列访问
-    if (audioQueue.isEmpty()) return QByteArray();
-    return audioQueue.dequeue();
+QSize VideoProcessor::viewTargetSize() const {
+    const QWidget *viewport = ui->videoView->viewport();
+    const qreal ratio = viewport->devicePixelRatioF();
+    return QSize(qRound(viewport->width() * ratio), qRound(viewport->height() * ratio));
 }
 
 /**
- * @brief 解码线程的主函数。这是在新线程中执行的所有代码。
- *
- * 使用 FFmpeg 库循环读取、解码音视频包，并存入队列。
+ * @brief 预热播放列表中当前项的后一项和前一项，其余闲置的解码器被释放。
  */
-void VideoDecoder::run() {
-    // --- 1. 初始化 FFmpeg ---
-    AVFormatContext* formatCtx = nullptr;
-    // 打开输入文件并读取头信息
-    if (avformat_open_input(&formatCtx, sourcePath.toLocal8Bit().constData(), nullptr, nullptr) != 0) {
-        qWarning() << "FFmpeg: 无法打开文件" << sourcePath; return;
-    }
-    // 查找流信息
-    if (avformat_find_stream_info(formatCtx, nullptr) < 0) {
-        qWarning() << "FFmpeg: 无法找到流信息"; avformat_close_input(&formatCtx); return;
-    }
-    // 获取视频总时长（毫秒）
-    durationMs = formatCtx->duration / (AV_TIME_BASE / 1000);
-
-    // --- 2. 查找并打开音视频解码器 ---
-    int videoStreamIndex = av_find_best_stream(formatCtx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
-    int audioStreamIndex = av_find_best_stream(formatCtx, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
-    if (videoStreamIndex < 0 || audioStreamIndex < 0) {
-        qWarning() << "FFmpeg: 无法同时找到视频流和音频流。"; avformat_close_input(&formatCtx); return;
-    }
-
-    // a. 准备视频解码器
-    AVCodecParameters* videoCodecParams = formatCtx->streams[videoStreamIndex]->codecpar;
-    const AVCodec* videoCodec = avcodec_find_decoder(videoCodecParams->codec_id);
-    AVCodecContext* videoCodecCtx = avcodec_alloc_context3(videoCodec);
-    avcodec_parameters_to_context(videoCodecCtx, videoCodecParams);
-    if (avcodec_open2(videoCodecCtx, videoCodec, nullptr) < 0) { qWarning() << "FFmpeg: 无法打开视频解码器"; avformat_close_input(&formatCtx); return; }
-    videoFPS = av_q2d(formatCtx->streams[videoStreamIndex]->r_frame_rate);
-    if (videoFPS <= 0) videoFPS = 25; // 提供一个备用FPS
-
-    // b. 准备音频解码器
-    AVCodecParameters* audioCodecParams = formatCtx->streams[audioStreamIndex]->codecpar;
-    const AVCodec* audioCodec = avcodec_find_decoder(audioCodecParams->codec_id);
-    AVCodecContext* audioCodecCtx = avcodec_alloc_context3(audioCodec);
-    avcodec_parameters_to_context(audioCodecCtx, audioCodecParams);
-    if(avcodec_open2(audioCodecCtx, audioCodec, nullptr) < 0){ qWarning() << "FFmpeg: 无法打开音频解码器"; avformat_close_input(&formatCtx); return; }
-
-    // --- 3. 设置格式转换器 ---
-    // a. 音频重采样：将源音频格式转换为Qt AudioSink支持的格式（立体声, 16位有符号整数, 48kHz）
-    SwrContext* swrCtx = nullptr;
-    AVChannelLayout out_ch_layout = AV_CHANNEL_LAYOUT_STEREO;
-    swr_alloc_set_opts2(&swrCtx, &out_ch_layout, AV_SAMPLE_FMT_S16, 48000, &audioCodecCtx->ch_layout, audioCodecCtx->sample_fmt, audioCodecCtx->sample_rate, 0, nullptr);
-    swr_init(swrCtx);
-    // b. 视频缩放/格式转换：将源视频像素格式转换为OpenCV Mat支持的BGR24格式
-    SwsContext* swsCtx = sws_getContext(videoCodecCtx->width, videoCodecCtx->height, videoCodecCtx->pix_fmt, videoCodecCtx->width, videoCodecCtx->height, AV_PIX_FMT_BGR24, SWS_BILINEAR, nullptr, nullptr, nullptr);
-
-    // 分配用于循环的数据包和帧
-    AVPacket* packet = av_packet_alloc();
-    AVFrame* frame = av_frame_alloc();
-
-    // --- 4. 主解码循环 ---
-    while (!stopped) {
-        // a. 处理跳转请求
-        if (seekRequest != -1) {
-            // 将毫秒时间转换为FFmpeg内部的时间基（timestamp）
-            qint64 seek_target_ts = seekRequest * formatCtx->streams[videoStreamIndex]->time_base.den / (1000 * formatCtx->streams[videoStreamIndex]->time_base.num);
-            // 执行跳转
-            av_seek_frame(formatCtx, -1, seek_target_ts, AVSEEK_FLAG_BACKWARD);
-            // 清空解码器内部的缓冲区
-            avcodec_flush_buffers(videoCodecCtx);
-            avcodec_flush_buffers(audioCodecCtx);
-            // 清空我们自己的队列
-            mutex.lock();
-            videoQueue.clear(); audioQueue.clear();
-            seekRequest = -1; // 重置请求
-            mutex.unlock();
-            // 通知主线程跳转已完成
-            emit seekFinished();
-        }
-
-        // b. 控制队列大小 (背压)，防止队列过大消耗过多内存
-        if (videoQueue.size() > 100 || audioQueue.size() > 200) { msleep(10); continue; }
-
-        // c. 从文件中读取一个数据包 (packet)
-        if (av_read_frame(formatCtx, packet) < 0) { stopped = true; break; } // 文件读完或出错
-
-        // d. 解码视频包
-        if (packet->stream_index == videoStreamIndex) {
-            if (avcodec_send_packet(videoCodecCtx, packet) == 0) {
-                while (avcodec_receive_frame(videoCodecCtx, frame) == 0) {
-                    cv::Mat cvFrame(videoCodecCtx->height, videoCodecCtx->width, CV_8UC3);
-                    uint8_t* dest[] = { cvFrame.data };
-                    int dest_linesize[] = { (int)cvFrame.step };
-                    // 转换像素格式
-                    sws_scale(swsCtx, frame->data, frame->linesize, 0, videoCodecCtx->height, dest, dest_linesize);
-                    VideoFrame vf;
-                    vf.frame = cvFrame.clone();
-                    // 计算以毫秒为单位的显示时间戳
-                    vf.pts = frame->pts * 1000 * av_q2d(formatCtx->streams[videoStreamIndex]->time_base);
-                    QMutexLocker locker(&mutex);
-                    videoQueue.enqueue(vf);
-                }
-            }
-            // e. 解码音频包
-        } else if (packet->stream_index == audioStreamIndex) {
-            if (avcodec_send_packet(audioCodecCtx, packet) == 0) {
-                while (avcodec_receive_frame(audioCodecCtx, frame) == 0) {
-                    uint8_t* resampled_data = nullptr;
-                    // 计算重采样后需要的缓冲区大小
-                    int out_samples = av_rescale_rnd(swr_get_delay(swrCtx, frame->sample_rate) + frame->nb_samples, 48000, frame->sample_rate, AV_ROUND_UP);
-                    av_samples_alloc(&resampled_data, NULL, 2, out_samples, AV_SAMPLE_FMT_S16, 0);
-                    // 执行重采样
-                    out_samples = swr_convert(swrCtx, &resampled_data, out_samples, (const uint8_t**)frame->data, frame->nb_samples);
-                    int data_size = out_samples * 2 * 2; // 采样数 * 通道数 * 采样大小(16bit=2bytes)
-                    QByteArray audioData((char*)resampled_data, data_size);
-                    av_freep(&resampled_data);
-                    QMutexLocker locker(&mutex);
-                    audioQueue.enqueue(audioData);
-                }
+void VideoProcessor::prefetchNeighbours() {
+    QStringList paths;
+    if (currentIndex.isValid()) {
+        const int row = currentIndex.row();
+        for (int neighbour : {row + 1, row - 1}) {
+            if (neighbour >= 0 && neighbour < videoListModel->rowCount()) {
+                paths << videoListModel->index(neighbour, 0).data(Qt::DisplayRole).toString();
             }
         }
-        av_packet_unref(packet); // 释放数据包，准备下一次循环
     }
-
-    // --- 5. 清理所有FFmpeg资源 ---
-    av_packet_free(&packet); av_frame_free(&frame); sws_freeContext(swsCtx); swr_free(&swrCtx);
-    avcodec_free_context(&videoCodecCtx); avcodec_free_context(&audioCodecCtx); avformat_close_input(&formatCtx);
-    qDebug() << "解码线程已结束。";
-}
-
-
-// =============================================================================
-// VideoProcessor Implementation (消费者/控制器)
-// =============================================================================
-
-VideoProcessor::VideoProcessor(Ui::MainWindow *ui, QObject *parent)
-    : QObject(parent), ui(ui)
-{
-    videoListModel = new QStringListModel(this);
-    ui->videoListView->setModel(videoListModel);
-    ui->speedComboBox->addItems({"0.5x", "1.0x", "1.5x", "2.0x"});
-    ui->speedComboBox->setCurrentIndex(1);
-    ui->filterComboBox->addItems({"无", "模糊", "锐化"});
-    loadFaceDetector();
-    ui->controlBar->setEnabled(false);
-    ui->videoEffectsToolBox->setEnabled(false);
-}
-
-VideoProcessor::~VideoProcessor() {
-    stopCurrentVideo();
+    prefetcher->prefetch(paths, viewTargetSize());
 }
 
 void VideoProcessor::stopCurrentVideo() {
-    if (displayTimer) {
-        displayTimer->stop();
-        delete displayTimer; displayTimer = nullptr;
-    }
-    if (decoderThread) {
-        decoderThread->stop();
-        decoderThread->wait(1000); // 等待最多1秒
-        delete decoderThread; decoderThread = nullptr;
-    }
+    stopRecording();
+    stillFrameTimer->stop();
+    loopStartMs = loopEndMs = -1;
+    updateLoopButton();
+    scheduler->stop();
+    telemetry->stop();
+    thumbnailTrack->clear();
+    // 先停止 AudioSink，它不会再从解码器拉取数据之后才能销毁解码器
     if (audioSink) {
-        disconnect(audioSink, &QAudioSink::stateChanged, this, &VideoProcessor::handleAudioStateChange);
         audioSink->stop();
         delete audioSink; audioSink = nullptr;
-        audioDevice = nullptr;
     }
-}
-
-void VideoProcessor::loadFaceDetector() {
-    try {
-        faceDetector = dlib::get_frontal_face_detector();
-        qDebug() << "dlib frontal face detector loaded successfully.";
-    } catch (const std::exception& e) {
-        qWarning() << "Failed to load dlib face detector:" << e.what();
+    audioDevice->setSource(nullptr);
+    if (decoderThread) {
+        // 解码器交还给预取池：跳回开头闲置，之后仍是相邻项时直接复用，否则在后台停止销毁
+        disconnect(decoderThread, nullptr, this, nullptr);
+        prefetcher->recycle(decoderThread);
+        decoderThread = nullptr;
     }
+    faceAnalyzer->stopAnalysis();
 }
 
 void VideoProcessor::addVideos() {
@@ -360,27 +221,42 @@ void VideoProcessor::playVideoAtIndex(const QModelIndex &index)
     stopCurrentVideo(); // 播放新视频前，先停止并清理上一个
     QString filePath = videoListModel->data(index, Qt::DisplayRole).toString();
 
-    decoderThread = new VideoDecoder(this);
+    // 相邻的视频已在后台打开并解码好开头几帧，取出即可播放；否则新建一个开始打开
+    decoderThread = prefetcher->take(filePath);
     connect(decoderThread, &VideoDecoder::seekFinished, this, &VideoProcessor::onSeekFinished);
-
-    if (!decoderThread->startDecoding(filePath)) {
-        QMessageBox::critical(qobject_cast<QWidget*>(parent()), "错误", "无法打开或解析视频文件。");
+    updateDecoderTargetSize();
+    updateEffectParams();
+    updateFaceAnalysis();
+    decoderThread->setAudioOutputEnabled(scheduler->rate() == 1.0);
+    decoderThread->setSkipMode(skipModeForRate(scheduler->rate()));
+    decoderThread->setTelemetry(telemetry);
+    currentFilePath = filePath;
+    currentIndex = index;
+    currentFramePts = 0;
+    audioClockBaseMs = 0;
+    lastLateDroppedFrames = 0;
+    lastAvDriftMs = 0;
+
+    if (!decoderThread->waitForOpened()) {
+        QMessageBox::critical(qobject_cast<QWidget*>(parent()), "错误", "无法打开或解析视频文件。\n" + decoderThread->errorString());
         stopCurrentVideo(); return;
     }
 
     videoDurationMs = decoderThread->getDurationMs();
     double fps = decoderThread->getFPS();
+    // 后台生成关键帧缩略图，供拖动进度条时即时预览
+    thumbnailTrack->build(filePath, videoDurationMs);
 
     // 设置音频输出格式
     audioFormat.setSampleRate(48000);
     audioFormat.setChannelCount(2);
     audioFormat.setSampleFormat(QAudioFormat::Int16);
-    recreateAudioSink(); // 创建音频播放实例
+    openAudioOutput(); // 创建音频播放实例
 
-    // 创建并启动显示定时器
-    displayTimer = new QTimer(this);
-    connect(displayTimer, &QTimer::timeout, this, &VideoProcessor::updateDisplay);
-    displayTimer->start(1000.0 / fps);
+    // 启动呈现调度，刷新频率不超过视频视图所在屏幕的刷新率
+    if (const QScreen *screen = ui->videoView->screen()) scheduler->setDisplayRefreshRate(screen->refreshRate());
+    scheduler->start(fps);
+    telemetry->start();
 
     // 更新状态
     isVideoPlaying = true;
@@ -388,16 +264,20 @@ void VideoProcessor::playVideoAtIndex(const QModelIndex &index)
     ui->controlBar->setEnabled(true);
     ui->videoEffectsToolBox->setEnabled(true);
     updatePlayPauseButton(true);
+
+    // 当前视频开始播放之后再在后台预热相邻的视频
+    prefetchNeighbours();
 }
 
 void VideoProcessor::togglePlayPause() {
     if (!decoderThread || isSeeking) return; // 跳转时不允许操作
     isVideoPlaying = !isVideoPlaying;
     if (isVideoPlaying) {
-        displayTimer->start();
-        if(audioSink) audioSink->resume();
+        scheduler->resume();
+        if (audioSink && scheduler->rate() == 1.0) audioSink->resume();
     } else {
-        displayTimer->stop();
+        scheduler->pause();
+        decoderThread->setPresentationClock(-1, scheduler->rate()); // 暂停时时钟不走，效果线程不应丢帧
         if(audioSink) audioSink->suspend();
     }
     updatePlayPauseButton(isVideoPlaying);
@@ -406,25 +286,48 @@ void VideoProcessor::togglePlayPause() {
 void VideoProcessor::updateDisplay() {
     if (!decoderThread || !isVideoPlaying || isSeeking) return;
 
-    // [音视频同步-步骤1] 填充音频缓冲区
-    while(audioDevice && audioSink && audioSink->state() != QAudio::StoppedState && audioSink->bytesFree() > 0) {
-        QByteArray audioData = decoderThread->getAudioChunk();
-        if (audioData.isEmpty()) break;
-        audioDevice->write(audioData);
+    // [音视频同步-步骤1] 更新主时钟，并发布给效果线程。音频由 AudioSink 按自己的节奏从 AudioPullDevice 拉取，
+    // 这里只读取它的播放进度；变速播放时音频静音，解码线程直接丢弃解码出的音频
+    const bool audioMaster = scheduler->rate() == 1.0 && audioSink && audioSink->state() != QAudio::StoppedState;
+    const qint64 audioPositionUs = audioMaster ? audioClockBaseMs * 1000 + audioSink->processedUSecs() : -1;
+    if (audioMaster) scheduler->updateAudioClock(audioPositionUs / 1000);
+    else scheduler->useWallClock();
+    telemetry->record(VideoTelemetry::PresentLatency, scheduler->tickLatencyUs());
+    const qint64 clock = scheduler->clockMs();
+    // A-B 循环：到达 B 点后回到 A 点。A 点所在的 GOP 上一轮已经解码过，通常直接从 GOP 缓存取帧
+    if (loopEndMs > loopStartMs && clock >= loopEndMs) {
+        seekFromPlayback(loopStartMs);
+        return;
+    }
+    decoderThread->setPresentationClock(clock, scheduler->rate());
+
+    // [音视频同步-步骤2] 获取不晚于时钟的最新一帧，被它取代的帧计为丢弃
+    int skippedFrames = 0;
+    const qint64 lateDropped = decoderThread->getLateDroppedFrames();
+    cv::Mat frame = decoderThread->getVideoFrame(clock, &currentFramePts, &skippedFrames);
+    scheduler->framesDropped(skippedFrames + lateDropped - lastLateDroppedFrames);
+    telemetry->count(VideoTelemetry::DroppedFrames, skippedFrames + lateDropped - lastLateDroppedFrames);
+    lastLateDroppedFrames = lateDropped;
+
+    // [音视频同步-步骤3] 处理并显示
+    if (!frame.empty()) {
+        scheduler->framePresented(currentFramePts, clock);
+        telemetry->count(VideoTelemetry::PresentedFrames);
+        if (audioPositionUs >= 0) {
+            const qint64 driftUs = currentFramePts * 1000 - audioPositionUs;
+            telemetry->record(VideoTelemetry::AvDrift, qAbs(driftUs));
+            lastAvDriftMs = driftUs / 1000;
+        }
+        cv::Mat processedFrame = applyEffects(frame);
+        // 录制队列已满时这一帧被丢弃并计数，编码线程跟不上也不会拖慢播放
+        if (recorder->isRecording()) recorder->pushVideoFrame(processedFrame, currentFramePts);
+        currentImage = ImageConverter::wrapMat(processedFrame);
+        emit frameReady(currentImage);
+        emit progressUpdated(QString("%1 / %2").arg(formatTime(clock)).arg(formatTime(videoDurationMs)), clock, videoDurationMs);
     }
 
-    // [音视频同步-步骤2] 获取音频时钟
-    qint64 audioPts = audioSink ? (audioSink->processedUSecs() / 1000) : 0;
-
-    // [音视频同步-步骤3] 获取对应的视频帧
-    cv::Mat frame = decoderThread->getVideoFrame(audioPts);
-    if (frame.empty()) return;
-
-    // [音视频同步-步骤4] 处理并显示
-    cv::Mat processedFrame = applyEffects(frame);
-    currentPixmap = QPixmap::fromImage(ImageConverter::matToQImage(processedFrame));
-    emit frameReady(currentPixmap);
-    emit progressUpdated(QString("%1 / %2").arg(formatTime(audioPts)).arg(formatTime(videoDurationMs)), audioPts, videoDurationMs);
+    // [音视频同步-步骤4] 按下一帧的显示时刻安排下一次刷新
+    scheduler->scheduleNext(decoderThread->nextFramePts());
 }
 
 void VideoProcessor::onSliderPressed() {
@@ -432,7 +335,8 @@ void VideoProcessor::onSliderPressed() {
     // [跳转流程-步骤1]
     wasPlayingBeforeSeek = isVideoPlaying;
     if (isVideoPlaying) {
-        displayTimer->stop();
+        scheduler->pause();
+        decoderThread->setPresentationClock(-1, scheduler->rate());
         if(audioSink) audioSink->suspend();
     }
 }
@@ -440,66 +344,143 @@ void VideoProcessor::onSliderPressed() {
 void VideoProcessor::seek(int position) {
     if (!decoderThread) return;
     emit progressUpdated(QString("%1 / %2").arg(formatTime(position)).arg(formatTime(videoDurationMs)), position, videoDurationMs);
+    // 拖动过程中只显示最近的关键帧缩略图，不打扰解码线程；松开后再执行精确跳转
+    const QImage thumbnail = thumbnailTrack->thumbnailAt(position);
+    if (!thumbnail.isNull()) emit frameReady(thumbnail);
 }
 
 void VideoProcessor::stopSeeking() {
     if (!decoderThread) return;
+    requestSeek(ui->videoSlider->value(), false);
+}
+
+/**
+ * @brief 请求解码线程跳转，跳转完成后由 onSeekFinished() 恢复播放或显示目标帧。
+ * @param ms 目标时间点（毫秒）。
+ * @param fillGopCache 是否把预解码帧也存入 GOP 缓存（逐帧后退时）。
+ */
+void VideoProcessor::requestSeek(qint64 ms, bool fillGopCache) {
     // [跳转流程-步骤2]
     isSeeking = true;
-    qDebug() << "Seek requested to:" << ui->videoSlider->value() << "ms. Notifying decoder thread.";
-    decoderThread->seek(ui->videoSlider->value());
+    audioClockBaseMs = ms;
+    scheduler->resetClock(audioClockBaseMs);
+    faceAnalyzer->reset();
+    qDebug() << "Seek requested to:" << ms << "ms. Notifying decoder thread.";
+    decoderThread->seek(ms, fillGopCache);
 }
 
-void VideoProcessor::onSeekFinished() {
-    // [跳转流程-步骤3]
-    qDebug() << "Decoder has finished seek. Now stopping audio sink...";
-    if (audioSink) {
-        audioSink->stop();
+/**
+ * @brief 暂停后逐帧前进或后退。
+ *
+ * 逐帧后退时解码线程把从关键帧起的预解码帧一并存入 GOP 缓存，
+ * 继续后退时直接从缓存取帧，不必每一步都从关键帧重新解码。
+ * @param frames 步数，负数为后退。
+ */
+void VideoProcessor::stepFrames(int frames) {
+    if (!decoderThread || isSeeking) return;
+    if (isVideoPlaying) togglePlayPause();
+    const double fps = decoderThread->getFPS();
+    const qint64 frameMs = fps > 0 ? std::max<qint64>(1, qRound64(1000.0 / fps)) : 40;
+    const qint64 target = std::clamp<qint64>(currentFramePts + frames * frameMs, 0, std::max<qint64>(0, videoDurationMs));
+    wasPlayingBeforeSeek = false;
+    ui->videoSlider->setValue(static_cast<int>(target));
+    requestSeek(target, frames < 0);
+}
+
+void VideoProcessor::stepBackward() {
+    stepFrames(-1);
+}
+
+void VideoProcessor::stepForward() {
+    stepFrames(1);
+}
+
+/**
+ * @brief 依次设置 A 点、B 点，第三次取消 A-B 循环。
+ */
+void VideoProcessor::toggleLoop() {
+    if (!decoderThread) return;
+    if (loopStartMs < 0) {
+        loopStartMs = currentFramePts;
+    } else if (loopEndMs < 0) {
+        // B 点不在 A 点之后时改为重新设置 A 点
+        if (currentFramePts > loopStartMs) loopEndMs = currentFramePts;
+        else loopStartMs = currentFramePts;
+    } else {
+        loopStartMs = loopEndMs = -1;
     }
+    updateLoopButton();
 }
 
-void VideoProcessor::handleAudioStateChange(QAudio::State state) {
-    qDebug() << "Audio state changed to:" << state;
-    // [跳转流程-步骤4]
-    if (isSeeking && state == QAudio::StoppedState) {
-        qDebug() << "Audio sink confirmed stopped. Forcing recreation.";
-        recreateAudioSink();
+/**
+ * @brief 按 A-B 循环的状态更新按钮文字。
+ */
+void VideoProcessor::updateLoopButton() {
+    if (loopStartMs < 0) ui->loopButton->setText("A-B 循环");
+    else if (loopEndMs < 0) ui->loopButton->setText(QString("设置 B 点 (A %1)").arg(formatTime(loopStartMs)));
+    else ui->loopButton->setText(QString("取消循环 (%1-%2)").arg(formatTime(loopStartMs)).arg(formatTime(loopEndMs)));
+}
+
+/**
+ * @brief 暂停中跳转后，等到目标帧解码（或从缓存取出）再显示。
+ *
+ * 跳转完成的通知只说明解复用线程已经重新定位，目标帧还需要一点时间才会进入待显示缓冲区，
+ * 因此由定时器短暂轮询，超时后放弃。
+ */
+void VideoProcessor::presentStillFrame() {
+    const qint64 nextPts = decoderThread && !isVideoPlaying ? decoderThread->nextFramePts() : -1;
+    if (nextPts < 0) {
+        if (!decoderThread || isVideoPlaying || ++stillFramePolls >= maxStillFramePolls) stillFrameTimer->stop();
+        return;
     }
+    stillFrameTimer->stop();
+    cv::Mat frame = decoderThread->getVideoFrame(nextPts, &currentFramePts);
+    if (frame.empty()) return;
+    cv::Mat processedFrame = applyEffects(frame);
+    currentImage = ImageConverter::wrapMat(processedFrame);
+    emit frameReady(currentImage);
+    emit progressUpdated(QString("%1 / %2").arg(formatTime(currentFramePts)).arg(formatTime(videoDurationMs)), currentFramePts, videoDurationMs);
 }
 
-void VideoProcessor::recreateAudioSink() {
-    // [跳转流程-步骤5]
-    qDebug() << "Recreating AudioSink instance...";
-    if (audioSink) {
-        disconnect(audioSink, &QAudioSink::stateChanged, this, &VideoProcessor::handleAudioStateChange);
-        delete audioSink;
-        audioSink = nullptr;
+void VideoProcessor::onSeekFinished() {
+    // 取自预取池的解码器可能还有一次交还时发出的回到开头的跳转，它与播放端无关
+    if (!isSeeking) return;
+    // [跳转流程-步骤3] 解码线程已切换到新序号，拉取设备从此只会读到跳转后的音频。
+    // 重启 AudioSink 丢弃它内部缓冲中的旧样本，播放进度从0重新计时；不再销毁重建
+    restartAudioOutput(wasPlayingBeforeSeek);
+
+    // [跳转流程-步骤4]
+    if (wasPlayingBeforeSeek) {
+        scheduler->resume();
+    } else {
+        stillFramePolls = 0;
+        stillFrameTimer->start();
     }
-    const QAudioDevice &defaultAudioDevice = QMediaDevices::defaultAudioOutput();
-    if (defaultAudioDevice.isNull()) { qCritical() << "Cannot recreate audio sink, no default device found."; isSeeking = false; return; }
+    updatePlayPauseButton(wasPlayingBeforeSeek);
+    isSeeking = false;
+}
 
+/**
+ * @brief 为当前视频创建 AudioSink，以拉取模式从 AudioPullDevice 读取解码器的音频。
+ */
+void VideoProcessor::openAudioOutput() {
+    const QAudioDevice &defaultAudioDevice = QMediaDevices::defaultAudioOutput();
+    if (defaultAudioDevice.isNull()) { qCritical() << "Cannot create audio sink, no default device found."; return; }
     audioSink = new QAudioSink(defaultAudioDevice, audioFormat, this);
-    connect(audioSink, &QAudioSink::stateChanged, this, &VideoProcessor::handleAudioStateChange);
-    audioDevice = audioSink->start();
-    if (!audioDevice) { qCritical() << "Recreated audio sink FAILED to start. Error:" << audioSink->error(); isSeeking = false; return; }
-    qDebug() << "Recreated audio sink started successfully.";
-
-    // [跳转流程-步骤6]
-    if (isSeeking) {
-        if (wasPlayingBeforeSeek) {
-            if(audioSink) audioSink->resume();
-            if(displayTimer) displayTimer->start();
-        } else {
-            cv::Mat frame = decoderThread->getVideoFrame(ui->videoSlider->value());
-            if (!frame.empty()) {
-                cv::Mat processedFrame = applyEffects(frame);
-                currentPixmap = QPixmap::fromImage(ImageConverter::matToQImage(processedFrame));
-                emit frameReady(currentPixmap);
-            }
-        }
-        updatePlayPauseButton(wasPlayingBeforeSeek);
-        isSeeking = false;
-    }
+    audioDevice->setSource(decoderThread);
+    restartAudioOutput(scheduler->rate() == 1.0);
+}
+
+/**
+ * @brief 重新开始音频输出：丢弃 AudioSink 中已缓冲的样本，processedUSecs 从0计时。
+ * @param playing 为false时启动后立即挂起（暂停中或变速播放时）。
+ */
+void VideoProcessor::restartAudioOutput(bool playing) {
+    if (!audioSink) return;
+    audioSink->stop();
+    audioSink->start(audioDevice);
+    if (audioSink->error() != QAudio::NoError) { qCritical() << "Audio sink FAILED to start. Error:" << audioSink->error(); return; }
+    if (!playing || scheduler->rate() != 1.0) audioSink->suspend();
 }
 
 void VideoProcessor::setSpeed(int index) {
@@ -509,54 +490,226 @@ void VideoProcessor::setSpeed(int index) {
     case 1: rate = 1.0; break;
     case 2: rate = 1.5; break;
     case 3: rate = 2.0; break;
+    case 4: rate = 4.0; break;
+    case 5: rate = 8.0; break;
+    case 6: rate = 16.0; break;
     }
-    if(displayTimer && decoderThread && decoderThread->getFPS() > 0) {
-        displayTimer->setInterval(1000.0 / (decoderThread->getFPS() * rate));
+    // 速率只改变主时钟的走速，刷新节奏随之按帧的显示时刻自动调整
+    const bool wasVariableSpeed = scheduler->rate() != 1.0;
+    scheduler->setRate(rate);
+    // 变速播放时音频静音：挂起 AudioSink，解码线程丢弃解码出的音频，免得环形缓冲区塞满后拖住解复用
+    if (decoderThread) decoderThread->setAudioOutputEnabled(rate == 1.0);
+    // 高倍速时逐帧解码既跟不上也看不清，改为跳过不被参考的帧或只解码关键帧
+    if (decoderThread) decoderThread->setSkipMode(skipModeForRate(rate));
+    if (audioSink && rate != 1.0) audioSink->suspend();
+    if (decoderThread && !isSeeking && wasVariableSpeed && rate == 1.0) resyncAudio();
+}
+
+/**
+ * @brief 变速播放期间音频被丢弃，回到原速时跳转到当前位置，让音频从这里重新开始。
+ */
+void VideoProcessor::resyncAudio() {
+    seekFromPlayback(scheduler->clockMs());
+}
+
+/**
+ * @brief 播放中跳转到指定位置，跳转完成后继续播放（A-B 循环回到 A 点时也使用）。
+ */
+void VideoProcessor::seekFromPlayback(qint64 position) {
+    wasPlayingBeforeSeek = isVideoPlaying;
+    if (isVideoPlaying) {
+        scheduler->pause();
+        if (audioSink) audioSink->suspend();
     }
+    ui->videoSlider->setValue(position);
+    requestSeek(position, false);
 }
 
 void VideoProcessor::saveCurrentFrame() {
-    if (currentPixmap.isNull()) {
+    if (currentImage.isNull()) {
         QMessageBox::warning(qobject_cast<QWidget*>(parent()), "无内容", "没有可保存的视频帧。");
         return;
     }
     QString fileName = QFileDialog::getSaveFileName(qobject_cast<QWidget*>(parent()), "保存当前帧", "", "PNG Image (*.png)");
-    if (!fileName.isEmpty()) {
-        currentPixmap.save(fileName);
+    if (fileName.isEmpty()) return;
+    // 播放时的帧已按视图尺寸缩小，保存时重新以原始分辨率解码同一时间点的帧
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    cv::Mat fullFrame = VideoDecoder::decodeFrameAt(currentFilePath, currentFramePts);
+    QApplication::restoreOverrideCursor();
+    if (fullFrame.empty()) {
+        currentImage.save(fileName);
+        return;
     }
+    if (decoderThread) decoderThread->applyEffects(fullFrame);
+    ImageConverter::matToQImage(applyEffects(fullFrame)).save(fileName);
 }
 
+/**
+ * @brief 开始或停止录制处理后的播放画面（含音频）。
+ *
+ * 录制期间解码器输出原始分辨率，显示时再由视图缩放；
+ * 帧和音频在显示/播放的同时交给 VideoRecorder 的编码线程。
+ */
 void VideoProcessor::toggleRecording() {
-    QMessageBox::information(qobject_cast<QWidget*>(parent()), "待实现", "录制功能将在下一步中实现。");
-    ui->recordButton->setChecked(false);
-}
+    if (recorder->isRecording()) {
+        stopRecording();
+        return;
+    }
+    if (!decoderThread) {
+        QMessageBox::warning(qobject_cast<QWidget*>(parent()), "无内容", "没有正在播放的视频。");
+        ui->recordButton->setChecked(false);
+        return;
+    }
+    const auto preset = static_cast<VideoRecorder::Preset>(ui->recordPresetComboBox->currentIndex());
+    const QString extension = VideoRecorder::presetExtension(preset);
+    QString fileName = QFileDialog::getSaveFileName(qobject_cast<QWidget*>(parent()), "录制视频", "", QString("Video (*.%1)").arg(extension));
+    if (fileName.isEmpty()) {
+        ui->recordButton->setChecked(false);
+        return;
+    }
+    if (QFileInfo(fileName).suffix().isEmpty()) fileName += "." + extension;
 
-cv::Mat VideoProcessor::applyEffects(const cv::Mat &frame) {
-    cv::Mat result = frame.clone();
-    int b = ui->videoBrightnessSlider->value(); int c = ui->videoContrastSlider->value();
-    int s = ui->videoSaturationSlider->value(); int h = ui->videoHueSlider->value();
-
-    if (b != 0 || c != 0 || s != 0 || h != 0) {
-        QImage tempQImg = ImageConverter::matToQImage(result);
-        tempQImg = ImageProcessor::adjustColor(tempQImg, b, c, s, h);
-        result = ImageConverter::qImageToMat(tempQImg);
-        if (result.channels() == 4) cv::cvtColor(result, result, cv::COLOR_BGRA2BGR);
+    decoderThread->setFullResolution(true);
+    if (!recorder->startRecording(fileName, decoderThread->getSourceSize(), decoderThread->getFPS(), preset, audioSink != nullptr)) {
+        decoderThread->setFullResolution(false);
+        QMessageBox::critical(qobject_cast<QWidget*>(parent()), "错误", "无法开始录制。\n" + recorder->errorString());
+        ui->recordButton->setChecked(false);
+        return;
     }
-    if (ui->grayscaleCheckBox->isChecked()) {
-        cv::cvtColor(result, result, cv::COLOR_BGR2GRAY);
-        cv::cvtColor(result, result, cv::COLOR_GRAY2BGR);
+    // 交给 AudioSink 的音频同时送入录制器
+    if (audioSink) decoderThread->setAudioTap([this](const char *data, qint64 size) { recorder->pushAudio(QByteArray(data, size)); });
+    ui->recordButton->setText("停止录制");
+    ui->recordPresetComboBox->setEnabled(false);
+}
+
+/**
+ * @brief 用当前的效果设置离线导出播放列表中的全部视频。
+ *
+ * 导出在 VideoExporter 的后台线程中进行，与播放互不影响；
+ * 进度对话框显示当前文件、处理速度和预计剩余时间，可随时取消。
+ */
+void VideoProcessor::exportPlaylist() {
+    QWidget *window = qobject_cast<QWidget*>(parent());
+    const QStringList files = videoListModel->stringList();
+    if (files.isEmpty()) {
+        QMessageBox::warning(window, "无内容", "播放列表为空。");
+        return;
     }
+    if (exporter->isRunning()) return;
+    const QString outputDir = QFileDialog::getExistingDirectory(window, "选择导出目录");
+    if (outputDir.isEmpty()) return;
+
+    VideoExporter::Options options;
+    options.effects = currentEffectParams();
+    options.drawFaces = ui->faceDetectCheckBox->isChecked();
+    options.preset = static_cast<VideoRecorder::Preset>(ui->recordPresetComboBox->currentIndex());
+
+    auto *dialog = new QProgressDialog("正在准备导出...", "取消", 0, 1000, window);
+    dialog->setWindowTitle("批量导出");
+    dialog->setWindowModality(Qt::WindowModal);
+    dialog->setMinimumDuration(0);
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+    auto *results = new QStringList;
+
+    connect(dialog, &QProgressDialog::canceled, exporter, &VideoExporter::cancel);
+    connect(exporter, &VideoExporter::progress, dialog, [dialog, files](int fileIndex, int fileCount, double fraction, double fps, qint64 etaMs) {
+        dialog->setValue(qRound((fileIndex + fraction) * 1000.0 / fileCount));
+        const QString eta = etaMs >= 0 ? QString("，剩余约 %1 秒").arg((etaMs + 999) / 1000) : QString();
+        dialog->setLabelText(QString("正在导出 %1/%2：%3\n速度 %4 fps%5")
+                                 .arg(fileIndex + 1).arg(fileCount).arg(QFileInfo(files[fileIndex]).fileName())
+                                 .arg(fps, 0, 'f', 1).arg(eta));
+    });
+    connect(exporter, &VideoExporter::fileExported, dialog, [results](const QString &input, const QString &, bool success, const QString &message) {
+        results->append(QString("%1 %2：%3").arg(success ? "✔" : "✘", QFileInfo(input).fileName(), message));
+    });
+    connect(exporter, &QThread::finished, dialog, [this, dialog, results, window]() {
+        disconnect(exporter, nullptr, dialog, nullptr);
+        dialog->close();
+        if (!exporter->wasCancelled()) QMessageBox::information(window, "导出完成", results->join("\n"));
+        delete results;
+    });
+
+    exporter->exportFiles(files, outputDir, options);
+}
+
+/**
+ * @brief 停止录制：等待编码线程写完文件，并报告丢弃和迟到的帧数。
+ */
+void VideoProcessor::stopRecording() {
+    if (!recorder->isRecording()) return;
+    if (decoderThread) decoderThread->setAudioTap(nullptr);
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    recorder->stopRecording();
+    QApplication::restoreOverrideCursor();
+    if (decoderThread) decoderThread->setFullResolution(false);
+    ui->recordButton->setChecked(false);
+    ui->recordButton->setText("开始录制");
+    ui->recordPresetComboBox->setEnabled(true);
+    ui->statusbar->showMessage(QString("录制完成：编码 %1 帧，丢弃 %2 帧，迟到 %3 帧")
+                               .arg(recorder->encodedFrames()).arg(recorder->droppedFrames()).arg(recorder->lateFrames()), 10000);
+}
+
+/**
+ * @brief 把效果控件的当前值打包为参数块交给解码器的效果线程。
+ *
+ * 颜色调整和灰度效果已移到 VideoEffectStage 中，在效果线程里原地处理；
+ * 主线程只在控件变化时生成一次参数块，不再在每一帧读取控件。
+ */
+void VideoProcessor::updateEffectParams() {
+    if (!decoderThread) return;
+    decoderThread->setEffectParams(currentEffectParams());
+}
+
+/**
+ * @brief 效果控件的当前值。
+ */
+VideoEffectParams VideoProcessor::currentEffectParams() const {
+    VideoEffectParams params;
+    params.brightness = ui->videoBrightnessSlider->value();
+    params.contrast = ui->videoContrastSlider->value();
+    params.saturation = ui->videoSaturationSlider->value();
+    params.hue = ui->videoHueSlider->value();
+    params.grayscale = ui->grayscaleCheckBox->isChecked();
+    return params;
+}
+
+/**
+ * @brief 根据“人脸检测”复选框启停后台人脸分析。
+ *
+ * 开启时解码器的效果线程把每一帧交给 FaceAnalyzer（只在该线程中缩小为灰度小图），
+ * 检测和跟踪都在后台完成，主线程不再运行 dlib 检测器。
+ */
+void VideoProcessor::updateFaceAnalysis() {
+    if (!decoderThread) return;
     if (ui->faceDetectCheckBox->isChecked()) {
-        try {
-            dlib::cv_image<dlib::bgr_pixel> dlib_img(result);
-            std::vector<dlib::rectangle> faces = faceDetector(dlib_img);
-            for (const auto& face : faces) {
-                cv::Rect rect(face.left(), face.top(), face.width(), face.height());
-                cv::rectangle(result, rect, cv::Scalar(0, 255, 0), 2);
-            }
-        } catch (const std::exception& e) {
-            qWarning() << "dlib face detection failed:" << e.what();
+        faceAnalyzer->startAnalysis();
+        FaceAnalyzer *analyzer = faceAnalyzer;
+        decoderThread->setFrameTap([analyzer](const cv::Mat &frame, qint64 pts) { analyzer->submitFrame(frame, pts); });
+    } else {
+        decoderThread->setFrameTap(nullptr);
+        faceAnalyzer->stopAnalysis();
+    }
+}
+
+/**
+ * @brief 在帧上绘制与其时间戳匹配的人脸框。
+ *
+ * 分析结果按分析时的帧尺寸记录，绘制到其他尺寸的帧（例如保存的原始分辨率帧）上时按比例缩放。
+ */
+cv::Mat VideoProcessor::applyEffects(const cv::Mat &frame) {
+    cv::Mat result = frame;
+    FaceAnalyzer::Result faces;
+    if (ui->faceDetectCheckBox->isChecked() && faceAnalyzer->resultAt(currentFramePts, faces) && !faces.faces.empty()) {
+        QElapsedTimer overlayTimer;
+        overlayTimer.start();
+        result = frame.clone(); // 人脸框画在副本上，不修改解码器缓冲池中的帧
+        const double sx = static_cast<double>(result.cols) / faces.frameSize.width;
+        const double sy = static_cast<double>(result.rows) / faces.frameSize.height;
+        for (const cv::Rect &face : faces.faces) {
+            cv::Rect rect(cvRound(face.x * sx), cvRound(face.y * sy), cvRound(face.width * sx), cvRound(face.height * sy));
+            cv::rectangle(result, rect, cv::Scalar(0, 255, 0), 2);
         }
+        telemetry->record(VideoTelemetry::FaceOverlayTime, overlayTimer.nsecsElapsed() / 1000);
     }
     return result;
 }
@@ -24,91 +24,34 @@
 // File: videoprocessor.h
 //
 // Description:
-// 该文件定义了 VideoProcessor 和 VideoDecoder 类，它们共同负责视频的
-// 解码、播放控制和效果处理。VideoDecoder 在后台线程中解码音视频，
-// VideoProcessor 则作为主线程的控制器，连接UI和解码器。
+// 该文件定义了 VideoProcessor 类，负责视频的播放控制和效果处理。
+// 它作为主线程的控制器，连接UI和在后台线程中解码音视频的 VideoDecoder。
 //
 // Author: g64
 // Date: 2025-07-25
 // =============================================================================
 
 #include <QObject>
-#include <QPixmap>
-#include <QThread>
-#include <QQueue>
-#include <QMutex>
+#include <QImage>
 #include <QAudioSink>
+#include "videodecoder.h"
+#include "thumbnailtrack.h"
+#include "faceanalyzer.h"
+#include "videorecorder.h"
+#include "videoexporter.h"
+#include "presentationscheduler.h"
+#include "audiopulldevice.h"
+#include "videotelemetry.h"
+#include "decoderprefetcher.h"
+#include <QPersistentModelIndex>
 #include <opencv2/opencv.hpp>
-#include <dlib/image_processing/frontal_face_detector.h>
-#include <dlib/opencv.h>
 
 // --- 前置声明 ---
 class QStringListModel;
-class QModelIndex;
-class QIODevice;
 class QTimer;
+class QModelIndex;
 namespace Ui { class MainWindow; }
 
-/**
- * @class VideoDecoder
- * @brief 在后台线程中解码音视频文件的类。
- *
- * [控制流程]
- * 1. 由主线程的 VideoProcessor 创建实例。
- * 2. 调用 startDecoding() 启动新线程并执行 run()。
- * 3. run() 方法中循环使用FFmpeg解码音视频，并将解码后的数据块放入两个线程安全的队列中。
- * 4. 主线程通过 getVideoFrame() 和 getAudioChunk() 从队列中取出数据。
- * 5. 通过 stop() 和 seek() 方法响应主线程的控制。
- */
-class VideoDecoder : public QThread {
-    Q_OBJECT
-public:
-    explicit VideoDecoder(QObject* parent = nullptr);
-    ~VideoDecoder();
-
-    bool startDecoding(const QString& filePath);
-    void stop();
-    void seek(qint64 ms);
-    cv::Mat getVideoFrame(qint64 audio_pts);
-    QByteArray getAudioChunk();
-    double getFPS() const { return videoFPS; }
-    qint64 getDurationMs() const { return durationMs; }
-
-signals:
-    // 当 seek 操作在解码线程中完成后发射，通知主线程可以进行下一步操作（如重建音频设备）。
-    void seekFinished();
-
-protected:
-    void run() override;
-
-private:
-    // --- 线程控制与状态变量 ---
-    QString sourcePath; // 当前解码的文件路径
-    // [关键变量] 线程停止标志。volatile 关键字确保多线程间的可见性。主线程设为true，run()循环会检测到并退出。
-    volatile bool stopped = false;
-    // [关键变量] 跳转请求时间点（毫秒）。主线程设置此值（非-1），run()循环检测到后会执行av_seek_frame。
-    qint64 seekRequest = -1;
-
-    // --- 数据结构 ---
-    struct VideoFrame {
-        cv::Mat frame;
-        qint64 pts; // 视频帧的显示时间戳 (Presentation Timestamp)，单位：毫秒
-    };
-
-    // --- 线程安全的数据缓冲区 ---
-    // [关键变量] 视频帧队列。解码线程作为生产者，主线程作为消费者。
-    QQueue<VideoFrame> videoQueue;
-    // [关键变量] 音频块队列。解码线程作为生产者，主线程作为消费者。
-    QQueue<QByteArray> audioQueue;
-    // [关键变量] 互斥锁，用于保护对 videoQueue 和 audioQueue 的访问，确保线程安全。
-    QMutex mutex;
-
-    // --- 视频元数据 ---
-    double videoFPS = 0.0; // 视频的帧率
-    qint64 durationMs = 0; // 视频总时长（毫秒）
-};
-
-
 /**
  * @class VideoProcessor
  * @brief 视频处理和播放的中心控制器（状态机）。
@@ -116,9 +59,10 @@ private:
  * [控制流程]
  * 1. 在主线程中创建，并与UI元素关联。
  * 2. 响应用户操作（如点击播放、拖动滑块），管理播放列表。
- * 3. 创建并控制 VideoDecoder 线程。
- * 4. 创建 QTimer (displayTimer) 作为播放“心跳”，定时触发 updateDisplay()。
- * 5. 创建 QAudioSink 用于播放音频。
+ * 3. 从 DecoderPrefetcher 取出 VideoDecoder 线程并控制它，切换视频时交还而不是销毁；
+ *    播放列表中当前项的前后两项始终在后台预热，切换过去几乎不需要等待。
+ * 4. 由 PresentationScheduler 按每一帧的显示时刻触发 updateDisplay()，并提供主时钟。
+ * 5. 创建 QAudioSink 以拉取模式从 AudioPullDevice 读取音频，跳转时只重启它，不再重建。
  * 6. 在 updateDisplay() 中，实现音视频同步，应用效果，并通过信号更新UI。
  */
 class VideoProcessor : public QObject
@@ -129,6 +73,13 @@ public:
     explicit VideoProcessor(Ui::MainWindow *ui, QObject *parent = nullptr);
     ~VideoProcessor();
 
+    // 播放流水线的遥测数据，供遥测面板显示
+    VideoTelemetry *getTelemetry() const { return telemetry; }
+
+protected:
+    // 监听视频视图的尺寸变化，把新的呈现尺寸告诉解码线程
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
 public slots:
     // --- UI交互槽函数 ---
     void addVideos();
@@ -141,36 +92,61 @@ public slots:
     void setSpeed(int index);
     void saveCurrentFrame();
     void toggleRecording();
+    void exportPlaylist();
+    // 逐帧后退/前进（会先暂停）
+    void stepBackward();
+    void stepForward();
+    // 依次设置 A 点、B 点，第三次取消 A-B 循环
+    void toggleLoop();
 
 private slots:
     // --- 内部逻辑槽函数 ---
     void updateDisplay();
     void onSeekFinished();
-    void handleAudioStateChange(QAudio::State state);
-    void recreateAudioSink();
+    void updateEffectParams();
+    void updateFaceAnalysis();
+    void presentStillFrame();
 
 signals:
     // --- 向外（MainWindow）通知的信号 ---
     void videoOpened(bool success, int totalDurationMs, double fps);
-    void frameReady(const QPixmap &frame);
+    void frameReady(const QImage &frame);
     void progressUpdated(const QString &timeString, int position, int duration);
 
 private:
     // --- 辅助方法 ---
     cv::Mat applyEffects(const cv::Mat& frame);
     void updatePlayPauseButton(bool isPlaying);
-    void loadFaceDetector();
     QString formatTime(qint64 ms);
     void stopCurrentVideo();
+    void stopRecording();
+    void updateDecoderTargetSize();
+    // 视频视图的物理像素尺寸，即解码输出的呈现尺寸
+    QSize viewTargetSize() const;
+    // 预热播放列表中当前项的前后两项
+    void prefetchNeighbours();
+    void resyncAudio();
+    void seekFromPlayback(qint64 position);
+    void requestSeek(qint64 ms, bool fillGopCache);
+    void stepFrames(int frames);
+    void updateLoopButton();
+    void openAudioOutput();
+    void restartAudioOutput(bool playing);
+    VideoEffectParams currentEffectParams() const;
 
     // --- 核心组件 ---
     Ui::MainWindow *ui; // 指向UI对象，用于直接操作UI控件
     QStringListModel *videoListModel; // 视频播放列表的数据模型
     VideoDecoder* decoderThread = nullptr; // 指向后台解码线程的指针
-    QTimer* displayTimer = nullptr; // 主播放定时器，驱动UI刷新
+    DecoderPrefetcher* prefetcher = nullptr; // 相邻视频的解码器预取池，也负责回收用过的解码器
+    ThumbnailTrack* thumbnailTrack = nullptr; // 拖动进度条时显示的关键帧缩略图轨道
+    FaceAnalyzer* faceAnalyzer = nullptr; // 后台人脸检测与跟踪
+    PresentationScheduler* scheduler = nullptr; // 呈现调度器：主时钟、刷新时刻与丢帧统计
+    VideoTelemetry* telemetry = nullptr; // 播放流水线的遥测数据
     QAudioSink* audioSink = nullptr; // Qt的音频播放组件
-    QIODevice* audioDevice = nullptr; // 从AudioSink获取的用于写入音频数据的设备
+    AudioPullDevice* audioDevice = nullptr; // AudioSink 从中拉取解码器的 PCM 数据
     QAudioFormat audioFormat; // 音频播放的格式
+    QTimer* stillFrameTimer = nullptr; // 暂停中跳转后轮询目标帧
 
     // --- 状态管理变量 ---
     // [关键变量] 标记当前是否处于播放状态。
@@ -181,13 +157,24 @@ private:
     bool isSeeking = false;
 
     // --- 数据变量 ---
-    QPixmap currentPixmap; // 当前准备显示的视频帧
+    QImage currentImage; // 当前准备显示的视频帧（共享帧缓冲，不拷贝像素）
+    QString currentFilePath; // 当前播放的视频文件路径
+    QPersistentModelIndex currentIndex; // 当前播放的视频在播放列表中的位置
+    qint64 currentFramePts = 0; // 当前显示帧的时间戳（毫秒），保存原始分辨率帧时使用
     qint64 videoDurationMs = 0; // 当前视频的总时长
-
-    // --- 特效与录制 ---
-    dlib::frontal_face_detector faceDetector; // dlib人脸检测器
-    cv::VideoWriter videoWriter; // OpenCV视频写入器（用于录制）
-    bool isRecording = false; // 标记是否正在录制
+    // [关键变量] 音频时钟的起点（毫秒）。跳转后重启的 AudioSink 从0开始计时，
+    // 而解码线程输出的音频正好从跳转目标开始，两者相加即为当前播放位置。
+    qint64 audioClockBaseMs = 0;
+    qint64 lastLateDroppedFrames = 0; // 上一次刷新时效果线程累计丢弃的帧数
+    qint64 lastAvDriftMs = 0; // 最近一次显示的帧相对音频播放位置的偏差
+    int stillFramePolls = 0; // 本次轮询目标帧的次数
+    static const int maxStillFramePolls = 200; // 轮询上限（约1秒）
+    qint64 loopStartMs = -1; // A-B 循环的 A 点，-1 表示未设置
+    qint64 loopEndMs = -1;   // A-B 循环的 B 点
+
+    // --- 录制 ---
+    VideoRecorder* recorder = nullptr; // 录制处理后的画面和音频，独立线程编码
+    VideoExporter* exporter = nullptr; // 离线批量导出播放列表
 };
 
 #endif // VIDEOPROCESSOR_H
@@ -0,0 +1,474 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+// =============================================================================
+// File: videorecorder.cpp
+//
+// Description:
+// VideoRecorder 类的实现文件。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include "videorecorder.h"
+#include <QDebug>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/audio_fifo.h>
+#include <libavutil/opt.h>
+#include <libswresample/swresample.h>
+#include <libswscale/swscale.h>
+}
+
+// 输入队列的限额：视频帧数、视频字节数、音频字节数（约2秒）
+static const int maxQueuedVideoFrames = 16;
+static const size_t maxQueuedVideoBytes = 64u * 1024 * 1024;
+static const qint64 maxQueuedAudioBytes = 48000 * 4 * 2;
+// 音频格式：48kHz 立体声
+static const int audioSampleRate = 48000;
+
+/**
+ * @brief 将FFmpeg错误码转换为可读的字符串。
+ */
+static QString ffmpegErrorString(int errnum)
+{
+    char buffer[AV_ERROR_MAX_STRING_SIZE] = {};
+    av_strerror(errnum, buffer, sizeof(buffer));
+    return QString::fromUtf8(buffer);
+}
+
+/**
+ * @brief 单调时钟的当前时刻（纳秒）。
+ */
+static qint64 steadyNowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief VideoRecorder 构造函数。
+ */
+VideoRecorder::VideoRecorder(QObject *parent)
+    : QThread(parent)
+{
+}
+
+/**
+ * @brief VideoRecorder 析构函数，正在录制时先正常结束文件。
+ */
+VideoRecorder::~VideoRecorder()
+{
+    stopRecording();
+}
+
+/**
+ * @brief 预设在界面上的名称。
+ */
+QStringList VideoRecorder::presetNames()
+{
+    return { "极速 (x264 ultrafast)", "快速 (x264 veryfast)", "均衡 (x264 medium)", "无损 (FFV1)" };
+}
+
+/**
+ * @brief 预设推荐的文件扩展名。
+ */
+QString VideoRecorder::presetExtension(Preset preset)
+{
+    return preset == Lossless ? "mkv" : "mp4";
+}
+
+/**
+ * @brief 打开输出文件和编码器并启动编码线程。
+ */
+bool VideoRecorder::startRecording(const QString &filePath, cv::Size frameSize, double fps, Preset preset, bool withAudio)
+{
+    stopRecording();
+    lastError.clear();
+    encodedCount.store(0, std::memory_order_relaxed);
+    droppedCount.store(0, std::memory_order_relaxed);
+    lateCount.store(0, std::memory_order_relaxed);
+    firstPts = -1;
+    ptsOffset = 0;
+    lastOutputPts = -1;
+    audioSamplesWritten = 0;
+    // yuv420p 要求宽高为偶数
+    outputSize = cv::Size(std::max(2, frameSize.width & ~1), std::max(2, frameSize.height & ~1));
+    frameDurationMs = fps > 0 ? std::max<qint64>(1, qRound64(1000.0 / fps)) : 40;
+
+    const QByteArray path = filePath.toLocal8Bit();
+    int result = avformat_alloc_output_context2(&formatCtx, nullptr, nullptr, path.constData());
+    if (result < 0 || !formatCtx) {
+        lastError = QString("无法识别输出格式：%1").arg(ffmpegErrorString(result));
+        closeOutput(); return false;
+    }
+    if (!openVideoEncoder(preset, fps) || (withAudio && !openAudioEncoder())) {
+        closeOutput(); return false;
+    }
+    if (!(formatCtx->oformat->flags & AVFMT_NOFILE)) {
+        result = avio_open(&formatCtx->pb, path.constData(), AVIO_FLAG_WRITE);
+        if (result < 0) {
+            lastError = QString("无法创建文件 %1：%2").arg(filePath, ffmpegErrorString(result));
+            closeOutput(); return false;
+        }
+    }
+    result = avformat_write_header(formatCtx, nullptr);
+    if (result < 0) {
+        lastError = QString("无法写入文件头：%1").arg(ffmpegErrorString(result));
+        closeOutput(); return false;
+    }
+    packet = av_packet_alloc();
+
+    {
+        QMutexLocker locker(&mutex);
+        queue.clear();
+        queuedVideoFrames = 0;
+        queuedVideoBytes = 0;
+        queuedAudioBytes = 0;
+        stopRequested = false;
+    }
+    start();
+    return true;
+}
+
+/**
+ * @brief 打开视频编码器。无损预设使用 FFV1，其余使用 libx264；
+ *        FFmpeg 未编译 libx264 时退回内置的 MPEG-4 编码器。
+ */
+bool VideoRecorder::openVideoEncoder(Preset preset, double fps)
+{
+    const AVCodec *codec = nullptr;
+    if (preset == Lossless) {
+        codec = avcodec_find_encoder(AV_CODEC_ID_FFV1);
+    } else {
+        codec = avcodec_find_encoder_by_name("libx264");
+        if (!codec) {
+            qWarning() << "libx264 不可用，录制改用 MPEG-4 编码器。";
+            codec = avcodec_find_encoder(AV_CODEC_ID_MPEG4);
+        }
+    }
+    if (!codec) { lastError = "找不到可用的视频编码器。"; return false; }
+
+    videoCodecCtx = avcodec_alloc_context3(codec);
+    if (!videoCodecCtx) { lastError = "无法分配视频编码器。"; return false; }
+    videoCodecCtx->width = outputSize.width;
+    videoCodecCtx->height = outputSize.height;
+    videoCodecCtx->time_base = AVRational{1, 1000}; // 时间戳直接使用毫秒
+    videoCodecCtx->framerate = av_d2q(fps > 0 ? fps : 25.0, 100000);
+    videoCodecCtx->gop_size = std::max(1, qRound(fps > 0 ? fps * 2 : 50));
+    videoCodecCtx->pix_fmt = codec->id == AV_CODEC_ID_FFV1 ? AV_PIX_FMT_BGR0 : AV_PIX_FMT_YUV420P;
+    videoCodecCtx->thread_count = 0;
+    if (codec->id == AV_CODEC_ID_H264) {
+        static const char *const x264Presets[] = { "ultrafast", "veryfast", "medium" };
+        av_opt_set(videoCodecCtx->priv_data, "preset", x264Presets[preset], 0);
+        av_opt_set(videoCodecCtx->priv_data, "crf", "20", 0);
+    } else if (codec->id == AV_CODEC_ID_MPEG4) {
+        videoCodecCtx->bit_rate = static_cast<int64_t>(outputSize.area()) * 4; // 1080p 约 8 Mbps
+    }
+    if (formatCtx->oformat->flags & AVFMT_GLOBALHEADER) videoCodecCtx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+    int result = avcodec_open2(videoCodecCtx, codec, nullptr);
+    if (result < 0) {
+        lastError = QString("无法打开视频编码器 %1：%2").arg(codec->name, ffmpegErrorString(result));
+        return false;
+    }
+    videoStream = avformat_new_stream(formatCtx, nullptr);
+    if (!videoStream || avcodec_parameters_from_context(videoStream->codecpar, videoCodecCtx) < 0) {
+        lastError = "无法创建视频流。"; return false;
+    }
+    videoStream->time_base = videoCodecCtx->time_base;
+
+    videoFrame = av_frame_alloc();
+    videoFrame->format = videoCodecCtx->pix_fmt;
+    videoFrame->width = videoCodecCtx->width;
+    videoFrame->height = videoCodecCtx->height;
+    if (av_frame_get_buffer(videoFrame, 0) < 0) { lastError = "无法分配视频帧。"; return false; }
+    return true;
+}
+
+/**
+ * @brief 打开 AAC 音频编码器和 S16 → FLTP 的重采样器。
+ */
+bool VideoRecorder::openAudioEncoder()
+{
+    const AVCodec *codec = avcodec_find_encoder(AV_CODEC_ID_AAC);
+    if (!codec) { lastError = "找不到 AAC 音频编码器。"; return false; }
+    audioCodecCtx = avcodec_alloc_context3(codec);
+    if (!audioCodecCtx) { lastError = "无法分配音频编码器。"; return false; }
+
+    AVChannelLayout stereo = AV_CHANNEL_LAYOUT_STEREO;
+    av_channel_layout_copy(&audioCodecCtx->ch_layout, &stereo);
+    audioCodecCtx->sample_rate = audioSampleRate;
+    audioCodecCtx->sample_fmt = AV_SAMPLE_FMT_FLTP;
+    audioCodecCtx->bit_rate = 160000;
+    audioCodecCtx->time_base = AVRational{1, audioSampleRate};
+    if (formatCtx->oformat->flags & AVFMT_GLOBALHEADER) audioCodecCtx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+    int result = avcodec_open2(audioCodecCtx, codec, nullptr);
+    if (result < 0) {
+        lastError = QString("无法打开音频编码器：%1").arg(ffmpegErrorString(result));
+        return false;
+    }
+    audioStream = avformat_new_stream(formatCtx, nullptr);
+    if (!audioStream || avcodec_parameters_from_context(audioStream->codecpar, audioCodecCtx) < 0) {
+        lastError = "无法创建音频流。"; return false;
+    }
+    audioStream->time_base = audioCodecCtx->time_base;
+
+    swr_alloc_set_opts2(&swrCtx, &audioCodecCtx->ch_layout, AV_SAMPLE_FMT_FLTP, audioSampleRate,
+                        &stereo, AV_SAMPLE_FMT_S16, audioSampleRate, 0, nullptr);
+    if (!swrCtx || swr_init(swrCtx) < 0) { lastError = "无法初始化音频重采样器。"; return false; }
+    audioFifo = av_audio_fifo_alloc(AV_SAMPLE_FMT_FLTP, 2, audioCodecCtx->frame_size > 0 ? audioCodecCtx->frame_size * 4 : 4096);
+    if (!audioFifo) { lastError = "无法分配音频缓冲。"; return false; }
+    return true;
+}
+
+/**
+ * @brief 请求停止并等待编码线程写完文件。
+ */
+void VideoRecorder::stopRecording()
+{
+    {
+        QMutexLocker locker(&mutex);
+        stopRequested = true;
+        itemAvailable.wakeAll();
+        spaceAvailable.wakeAll();
+    }
+    wait();
+    // 启动失败或线程已结束时释放可能残留的资源
+    closeOutput();
+}
+
+/**
+ * @brief 推入一帧处理后的画面。
+ *
+ * 队列中已有帧时才检查字节限额，单帧超过限额的超大分辨率视频也能录制。
+ */
+bool VideoRecorder::pushVideoFrame(const cv::Mat &frame, qint64 pts)
+{
+    if (frame.empty() || frame.type() != CV_8UC3) return false;
+    const size_t bytes = frame.total() * frame.elemSize();
+    QMutexLocker locker(&mutex);
+    auto isFull = [&] {
+        return queuedVideoFrames >= maxQueuedVideoFrames || (queuedVideoFrames > 0 && queuedVideoBytes + bytes > maxQueuedVideoBytes);
+    };
+    while (blockWhenFull && !stopRequested && isFull()) {
+        spaceAvailable.wait(&mutex);
+    }
+    if (stopRequested || !isRunning()) return false;
+    if (isFull()) {
+        droppedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    Item item;
+    item.frame = frame;
+    item.pts = pts;
+    item.queuedNs = steadyNowNs();
+    queue.push_back(std::move(item));
+    ++queuedVideoFrames;
+    queuedVideoBytes += bytes;
+    itemAvailable.wakeOne();
+    return true;
+}
+
+/**
+ * @brief 推入一段音频。
+ */
+void VideoRecorder::pushAudio(const QByteArray &pcm)
+{
+    if (pcm.isEmpty()) return;
+    QMutexLocker locker(&mutex);
+    auto isFull = [&] { return queuedAudioBytes > 0 && queuedAudioBytes + pcm.size() > maxQueuedAudioBytes; };
+    while (blockWhenFull && !stopRequested && isFull()) {
+        spaceAvailable.wait(&mutex);
+    }
+    if (stopRequested || !isRunning() || !audioCodecCtx) return;
+    if (isFull()) return;
+    Item item;
+    item.isAudio = true;
+    item.pcm = pcm;
+    queue.push_back(std::move(item));
+    queuedAudioBytes += pcm.size();
+    itemAvailable.wakeOne();
+}
+
+/**
+ * @brief 编码线程主函数。
+ */
+void VideoRecorder::run()
+{
+    qint64 lastReportNs = steadyNowNs();
+    while (true) {
+        Item item;
+        {
+            QMutexLocker locker(&mutex);
+            while (!stopRequested && queue.empty()) {
+                itemAvailable.wait(&mutex);
+            }
+            if (queue.empty()) break; // 已请求停止且队列已清空
+            item = std::move(queue.front());
+            queue.pop_front();
+            if (item.isAudio) {
+                queuedAudioBytes -= item.pcm.size();
+            } else {
+                --queuedVideoFrames;
+                queuedVideoBytes -= item.frame.total() * item.frame.elemSize();
+            }
+            spaceAvailable.wakeAll();
+        }
+
+        if (item.isAudio) encodeAudio(item.pcm);
+        else encodeVideo(item);
+
+        const qint64 now = steadyNowNs();
+        if (now - lastReportNs >= 1000000000LL) {
+            lastReportNs = now;
+            emit statsUpdated(encodedFrames(), droppedFrames(), lateFrames());
+        }
+    }
+
+    // 冲刷编码器中缓存的帧并写入文件尾
+    if (audioCodecCtx) {
+        flushAudioFifo(true);
+        sendFrame(audioCodecCtx, audioStream, nullptr);
+    }
+    sendFrame(videoCodecCtx, videoStream, nullptr);
+    const int result = av_write_trailer(formatCtx);
+    if (result < 0) qWarning() << "录制文件尾写入失败:" << ffmpegErrorString(result);
+    emit statsUpdated(encodedFrames(), droppedFrames(), lateFrames());
+    qDebug() << "录制结束: 编码" << encodedFrames() << "帧，丢弃" << droppedFrames() << "帧，迟到" << lateFrames() << "帧";
+}
+
+/**
+ * @brief [编码线程] 转换并编码一帧视频。
+ */
+void VideoRecorder::encodeVideo(const Item &item)
+{
+    if (steadyNowNs() - item.queuedNs > 2 * frameDurationMs * 1000000LL) {
+        lateCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // 输出时间戳：相对录制开始的毫秒数；倒退或大幅跳变（跳转）时折叠为一帧间隔
+    if (firstPts < 0) firstPts = item.pts;
+    qint64 outputPts = item.pts - firstPts + ptsOffset;
+    if (lastOutputPts >= 0 && (outputPts <= lastOutputPts || outputPts - lastOutputPts > 1000)) {
+        const qint64 expected = lastOutputPts + frameDurationMs;
+        ptsOffset += expected - outputPts;
+        outputPts = expected;
+    }
+    lastOutputPts = outputPts;
+
+    swsCtx = sws_getCachedContext(swsCtx, item.frame.cols, item.frame.rows, AV_PIX_FMT_BGR24,
+                                  outputSize.width, outputSize.height, videoCodecCtx->pix_fmt,
+                                  SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (!swsCtx || av_frame_make_writable(videoFrame) < 0) return;
+    const uint8_t *src[] = { item.frame.data };
+    const int srcLinesize[] = { static_cast<int>(item.frame.step) };
+    sws_scale(swsCtx, src, srcLinesize, 0, item.frame.rows, videoFrame->data, videoFrame->linesize);
+    videoFrame->pts = outputPts;
+    sendFrame(videoCodecCtx, videoStream, videoFrame);
+    encodedCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief [编码线程] 把 S16 交错音频转换为 FLTP 后放入 FIFO，凑满一帧就编码。
+ */
+void VideoRecorder::encodeAudio(const QByteArray &pcm)
+{
+    const int inSamples = pcm.size() / 4; // 立体声 S16，每个样本4字节
+    if (inSamples <= 0) return;
+    const int outCapacity = swr_get_out_samples(swrCtx, inSamples);
+    std::vector<float> left(outCapacity), right(outCapacity);
+    uint8_t *out[] = { reinterpret_cast<uint8_t *>(left.data()), reinterpret_cast<uint8_t *>(right.data()) };
+    const uint8_t *in[] = { reinterpret_cast<const uint8_t *>(pcm.constData()) };
+    const int converted = swr_convert(swrCtx, out, outCapacity, in, inSamples);
+    if (converted <= 0) return;
+    av_audio_fifo_write(audioFifo, reinterpret_cast<void **>(out), converted);
+    flushAudioFifo(false);
+}
+
+/**
+ * @brief [编码线程] 从 FIFO 中取出完整的音频帧送入编码器。
+ * @param final 为true时把不足一帧的剩余样本也作为最后一帧送出。
+ */
+void VideoRecorder::flushAudioFifo(bool final)
+{
+    const int frameSize = audioCodecCtx->frame_size > 0 ? audioCodecCtx->frame_size : 1024;
+    while (av_audio_fifo_size(audioFifo) >= frameSize || (final && av_audio_fifo_size(audioFifo) > 0)) {
+        const int samples = std::min(frameSize, av_audio_fifo_size(audioFifo));
+        AVFrame *frame = av_frame_alloc();
+        frame->nb_samples = samples;
+        frame->format = audioCodecCtx->sample_fmt;
+        frame->sample_rate = audioCodecCtx->sample_rate;
+        av_channel_layout_copy(&frame->ch_layout, &audioCodecCtx->ch_layout);
+        if (av_frame_get_buffer(frame, 0) < 0) { av_frame_free(&frame); return; }
+        av_audio_fifo_read(audioFifo, reinterpret_cast<void **>(frame->data), samples);
+        frame->pts = audioSamplesWritten;
+        audioSamplesWritten += samples;
+        sendFrame(audioCodecCtx, audioStream, frame);
+        av_frame_free(&frame);
+    }
+}
+
+/**
+ * @brief [编码线程] 把一帧送入编码器并写出所有可用的数据包。
+ */
+void VideoRecorder::sendFrame(AVCodecContext *codecCtx, AVStream *stream, AVFrame *frame)
+{
+    int result = avcodec_send_frame(codecCtx, frame);
+    if (result < 0 && result != AVERROR_EOF) {
+        qWarning() << "编码失败:" << ffmpegErrorString(result);
+        return;
+    }
+    while (avcodec_receive_packet(codecCtx, packet) == 0) {
+        av_packet_rescale_ts(packet, codecCtx->time_base, stream->time_base);
+        packet->stream_index = stream->index;
+        result = av_interleaved_write_frame(formatCtx, packet);
+        if (result < 0) qWarning() << "写入数据包失败:" << ffmpegErrorString(result);
+    }
+}
+
+/**
+ * @brief 释放所有编码与输出资源。
+ */
+void VideoRecorder::closeOutput()
+{
+    if (formatCtx && formatCtx->pb && !(formatCtx->oformat->flags & AVFMT_NOFILE)) avio_closep(&formatCtx->pb);
+    avformat_free_context(formatCtx);
+    formatCtx = nullptr;
+    videoStream = audioStream = nullptr;
+    avcodec_free_context(&videoCodecCtx);
+    avcodec_free_context(&audioCodecCtx);
+    av_frame_free(&videoFrame);
+    av_packet_free(&packet);
+    sws_freeContext(swsCtx);
+    swsCtx = nullptr;
+    swr_free(&swrCtx);
+    if (audioFifo) { av_audio_fifo_free(audioFifo); audioFifo = nullptr; }
+    QMutexLocker locker(&mutex);
+    queue.clear();
+    queuedVideoFrames = 0;
+    queuedVideoBytes = 0;
+    queuedAudioBytes = 0;
+}
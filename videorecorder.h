@@ -0,0 +1,202 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+#ifndef VIDEORECORDER_H
+#define VIDEORECORDER_H
+
+// =============================================================================
+// File: videorecorder.h
+//
+// Description:
+// 该文件定义了 VideoRecorder 类，在独立的编码线程中把播放时处理后的画面和音频
+// 用 libavcodec 编码并写入视频文件。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <atomic>
+#include <deque>
+#include <opencv2/core.hpp>
+
+// --- 前置声明 ---
+struct AVFormatContext;
+struct AVCodecContext;
+struct AVStream;
+struct AVFrame;
+struct AVPacket;
+struct SwsContext;
+struct SwrContext;
+struct AVAudioFifo;
+
+/**
+ * @class VideoRecorder
+ * @brief 播放录制器：有界队列 + 独立编码线程。
+ *
+ * [数据流]
+ * 主线程在显示每一帧时调用 pushVideoFrame()；AudioSink 拉取音频时（在它的线程中）调用 pushAudio()。
+ * 两者都只把数据放入有界队列后立即返回，从不等待：
+ * 视频帧直接引用帧缓冲池中的缓冲（不拷贝），队列按帧数和字节数双重限额，
+ * 超出时丢弃该帧并计数，编码跟不上时既不会阻塞播放，也不会占满缓冲池而拖住解码线程。
+ * 编码线程取出数据，用 sws_scale 转为编码器的像素格式，经 libx264/FFV1 编码，
+ * 音频经 swresample 转为 AAC 所需的格式后编码，二者交织写入文件。
+ *
+ * [时间戳]
+ * 视频使用帧自身的时间戳（相对于录制开始），跳转造成的时间戳跳变会被折叠成连续的一帧间隔；
+ * 音频按写入的样本数连续计时。
+ *
+ * [统计]
+ * droppedFrames：队列已满而被丢弃的帧；lateFrames：在队列中等待超过两个帧间隔才开始编码的帧。
+ * 二者持续偏高说明所选的预设对当前分辨率太慢。
+ */
+class VideoRecorder : public QThread
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @enum Preset
+     * @brief 编码速度预设。
+     */
+    enum Preset {
+        UltraFast = 0, // libx264 ultrafast，CPU占用最低
+        VeryFast,      // libx264 veryfast
+        Medium,        // libx264 medium，压缩率最高
+        Lossless       // FFV1 无损（Matroska 容器）
+    };
+
+    explicit VideoRecorder(QObject *parent = nullptr);
+    ~VideoRecorder();
+
+    // 预设在界面上的名称，顺序与 Preset 一致
+    static QStringList presetNames();
+    // 预设推荐的文件扩展名（不含点）
+    static QString presetExtension(Preset preset);
+
+    /**
+     * @brief 打开输出文件和编码器并启动编码线程。
+     * @param filePath 输出文件路径，容器格式由扩展名决定。
+     * @param frameSize 输出分辨率，之后推入的帧尺寸不同时会被缩放到该尺寸。
+     * @param fps 标称帧率。
+     * @param preset 编码速度预设。
+     * @param withAudio 是否录制音频（48kHz 立体声 S16 输入）。
+     * @return 成功返回true；失败时可通过 errorString() 获取原因。
+     */
+    bool startRecording(const QString &filePath, cv::Size frameSize, double fps, Preset preset, bool withAudio);
+
+    /**
+     * @brief 请求停止：编码完队列中剩余的数据，冲刷编码器并写入文件尾，然后等待线程结束。
+     */
+    void stopRecording();
+
+    /**
+     * @brief 设置队列满时的行为（在 startRecording() 之前调用）。
+     * @param blocking 为false（默认，实时录制）时丢弃并计数；为true（离线导出）时等待空位，不丢帧。
+     */
+    void setBlocking(bool blocking) { blockWhenFull = blocking; }
+
+    bool isRecording() const { return isRunning(); }
+    QString errorString() const { return lastError; }
+
+    /**
+     * @brief 推入一帧处理后的画面（BGR24）。非阻塞模式下从不等待。
+     * @param frame 要录制的帧，调用后不得再修改其像素。
+     * @param pts 帧的时间戳（毫秒）。
+     * @return 帧被接受时返回true；队列已满（非阻塞模式）或已停止时返回false。
+     */
+    bool pushVideoFrame(const cv::Mat &frame, qint64 pts);
+
+    /**
+     * @brief 推入一段音频（48kHz 立体声 S16 交错）。非阻塞模式下队列已满时丢弃。
+     */
+    void pushAudio(const QByteArray &pcm);
+
+    qint64 encodedFrames() const { return encodedCount.load(std::memory_order_relaxed); }
+    qint64 droppedFrames() const { return droppedCount.load(std::memory_order_relaxed); }
+    qint64 lateFrames() const { return lateCount.load(std::memory_order_relaxed); }
+
+signals:
+    // 编码线程每秒报告一次统计数据
+    void statsUpdated(qint64 encoded, qint64 dropped, qint64 late);
+
+protected:
+    // 编码线程的主函数
+    void run() override;
+
+private:
+    struct Item {
+        bool isAudio = false;
+        cv::Mat frame;
+        qint64 pts = 0;
+        qint64 queuedNs = 0; // 入队时刻，用于统计迟到帧
+        QByteArray pcm;
+    };
+
+    bool openVideoEncoder(Preset preset, double fps);
+    bool openAudioEncoder();
+    void encodeVideo(const Item &item);
+    void encodeAudio(const QByteArray &pcm);
+    void flushAudioFifo(bool final);
+    // 把一帧送入编码器（frame 为空表示冲刷），并写出所有可用的数据包
+    void sendFrame(AVCodecContext *codecCtx, AVStream *stream, AVFrame *frame);
+    void closeOutput();
+
+    // --- 输入队列（由 mutex 保护） ---
+    QMutex mutex;
+    QWaitCondition itemAvailable;
+    QWaitCondition spaceAvailable; // 阻塞模式下推入方等待空位
+    std::deque<Item> queue;
+    int queuedVideoFrames = 0;
+    size_t queuedVideoBytes = 0; // 队列中的帧大多引用帧缓冲池的缓冲，按字节限额避免耗尽缓冲池
+    qint64 queuedAudioBytes = 0;
+    bool stopRequested = false;
+    bool blockWhenFull = false;
+
+    // --- 编码状态（启动前由调用线程设置，之后只在编码线程中访问） ---
+    AVFormatContext *formatCtx = nullptr;
+    AVCodecContext *videoCodecCtx = nullptr;
+    AVCodecContext *audioCodecCtx = nullptr;
+    AVStream *videoStream = nullptr;
+    AVStream *audioStream = nullptr;
+    AVFrame *videoFrame = nullptr;
+    AVPacket *packet = nullptr;
+    SwsContext *swsCtx = nullptr;
+    SwrContext *swrCtx = nullptr;
+    AVAudioFifo *audioFifo = nullptr;
+    cv::Size outputSize;
+    qint64 frameDurationMs = 40;
+    qint64 firstPts = -1;     // 第一帧的时间戳
+    qint64 ptsOffset = 0;     // 折叠时间戳跳变的偏移量
+    qint64 lastOutputPts = -1;
+    qint64 audioSamplesWritten = 0;
+    QString lastError;
+
+    // --- 统计 ---
+    std::atomic<qint64> encodedCount{0};
+    std::atomic<qint64> droppedCount{0};
+    std::atomic<qint64> lateCount{0};
+};
+
+#endif // VIDEORECORDER_H
@@ -0,0 +1,268 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+// =============================================================================
+// File: videotelemetry.cpp
+//
+// Description:
+// VideoTelemetry 类的实现文件。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include "videotelemetry.h"
+#include <QFile>
+#include <QStringList>
+#include <QTextStream>
+#include <QTimer>
+#include <algorithm>
+
+// 历史记录保存的秒数
+static const size_t maxSnapshots = 3600;
+
+/**
+ * @brief 值所在的桶：floor(log2(value))，0 和 1 都在桶 0。
+ */
+static int bucketOf(qint64 value)
+{
+    int bucket = 0;
+    while (value > 1) {
+        value >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+/**
+ * @brief VideoTelemetry 构造函数。
+ */
+VideoTelemetry::VideoTelemetry(QObject *parent)
+    : QObject(parent)
+{
+    qRegisterMetaType<VideoTelemetry::Snapshot>();
+    timer = new QTimer(this);
+    timer->setInterval(1000);
+    connect(timer, &QTimer::timeout, this, &VideoTelemetry::aggregate);
+}
+
+/**
+ * @brief 开始按秒汇总。之前累计的数据和历史记录都被丢弃。
+ */
+void VideoTelemetry::start()
+{
+    for (AtomicHistogram &histogram : histograms) drain(histogram);
+    for (std::atomic<qint64> &counter : counters) counter.store(0, std::memory_order_relaxed);
+    snapshots.clear();
+    elapsed.start();
+    timer->start();
+}
+
+/**
+ * @brief 停止汇总，历史记录保留以便导出。
+ */
+void VideoTelemetry::stop()
+{
+    timer->stop();
+}
+
+/**
+ * @brief 记录一个直方图样本（任意线程）。
+ */
+void VideoTelemetry::record(Histogram histogram, qint64 value)
+{
+    AtomicHistogram &h = histograms[histogram];
+    value = std::max<qint64>(value, 0);
+    h.buckets[std::min(bucketOf(value), bucketCount - 1)].fetch_add(1, std::memory_order_relaxed);
+    h.count.fetch_add(1, std::memory_order_relaxed);
+    h.sum.fetch_add(value, std::memory_order_relaxed);
+    qint64 currentMax = h.max.load(std::memory_order_relaxed);
+    while (value > currentMax && !h.max.compare_exchange_weak(currentMax, value, std::memory_order_relaxed)) {}
+}
+
+/**
+ * @brief 累加一个计数器（任意线程）。
+ */
+void VideoTelemetry::count(Counter counter, qint64 n)
+{
+    counters[counter].fetch_add(n, std::memory_order_relaxed);
+}
+
+/**
+ * @brief 写入一个仪表的最新值（任意线程）。
+ */
+void VideoTelemetry::setGauge(Gauge gauge, qint64 value)
+{
+    gauges[gauge].store(value, std::memory_order_relaxed);
+}
+
+/**
+ * @brief 取走并清零一个直方图，计算这段时间的统计结果。
+ *
+ * 各个字段分别交换，与并发的 record() 之间可能错开一两个样本，对按秒统计无影响。
+ */
+VideoTelemetry::HistogramStats VideoTelemetry::drain(AtomicHistogram &histogram)
+{
+    HistogramStats stats;
+    qint64 buckets[bucketCount];
+    qint64 total = 0;
+    for (int i = 0; i < bucketCount; ++i) {
+        buckets[i] = histogram.buckets[i].exchange(0, std::memory_order_relaxed);
+        total += buckets[i];
+    }
+    stats.count = histogram.count.exchange(0, std::memory_order_relaxed);
+    const qint64 sum = histogram.sum.exchange(0, std::memory_order_relaxed);
+    stats.max = histogram.max.exchange(0, std::memory_order_relaxed);
+    if (stats.count <= 0 || total <= 0) return HistogramStats();
+    stats.mean = sum / stats.count;
+
+    // 百分位：累计到目标样本所在的桶，取桶的上界（不超过最大值）
+    auto percentile = [&](double fraction) {
+        const qint64 target = std::max<qint64>(1, static_cast<qint64>(fraction * total + 0.5));
+        qint64 seen = 0;
+        for (int i = 0; i < bucketCount; ++i) {
+            seen += buckets[i];
+            if (seen >= target) return std::min(stats.max, (qint64(2) << i) - 1);
+        }
+        return stats.max;
+    };
+    stats.p50 = percentile(0.50);
+    stats.p95 = percentile(0.95);
+    return stats;
+}
+
+/**
+ * @brief [主线程] 汇总一秒的数据。
+ */
+void VideoTelemetry::aggregate()
+{
+    emit sampling();
+    Snapshot snapshot;
+    snapshot.timeMs = elapsed.elapsed();
+    for (int i = 0; i < HistogramCount; ++i) snapshot.histograms[i] = drain(histograms[i]);
+    for (int i = 0; i < CounterCount; ++i) snapshot.counters[i] = counters[i].exchange(0, std::memory_order_relaxed);
+    for (int i = 0; i < GaugeCount; ++i) snapshot.gauges[i] = gauges[i].load(std::memory_order_relaxed);
+    snapshots.push_back(snapshot);
+    while (snapshots.size() > maxSnapshots) snapshots.pop_front();
+    emit snapshotReady(snapshot);
+}
+
+/**
+ * @brief 把历史记录导出为 CSV。
+ */
+bool VideoTelemetry::exportCsv(const QString &filePath, QString *error) const
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    QTextStream out(&file);
+
+    // 表头：时间、计数器、仪表，然后每个直方图五列
+    QStringList header{"time_ms"};
+    for (int i = 0; i < CounterCount; ++i) header << QString("%1_per_s").arg(counterKey(static_cast<Counter>(i)));
+    for (int i = 0; i < GaugeCount; ++i) header << gaugeKey(static_cast<Gauge>(i));
+    for (int i = 0; i < HistogramCount; ++i) {
+        const QString key = histogramKey(static_cast<Histogram>(i));
+        header << key + "_count" << key + "_mean_us" << key + "_p50_us" << key + "_p95_us" << key + "_max_us";
+    }
+    out << header.join(',') << '\n';
+
+    for (const Snapshot &snapshot : snapshots) {
+        QStringList row{QString::number(snapshot.timeMs)};
+        for (qint64 value : snapshot.counters) row << QString::number(value);
+        for (qint64 value : snapshot.gauges) row << QString::number(value);
+        for (const HistogramStats &stats : snapshot.histograms) {
+            row << QString::number(stats.count) << QString::number(stats.mean) << QString::number(stats.p50)
+                << QString::number(stats.p95) << QString::number(stats.max);
+        }
+        out << row.join(',') << '\n';
+    }
+    out.flush();
+    if (file.error() != QFileDevice::NoError) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+QString VideoTelemetry::histogramLabel(Histogram histogram)
+{
+    switch (histogram) {
+    case DecodeTime: return "解码耗时";
+    case ScaleTime: return "颜色转换耗时";
+    case BrightnessContrastTime: return "亮度/对比度耗时";
+    case SaturationHueTime: return "饱和度/色相耗时";
+    case GrayscaleTime: return "灰度耗时";
+    case FaceOverlayTime: return "人脸框绘制耗时";
+    case PresentLatency: return "呈现延迟";
+    case AvDrift: return "音画偏差";
+    default: return QString();
+    }
+}
+
+QString VideoTelemetry::counterLabel(Counter counter)
+{
+    switch (counter) {
+    case DecodedFrames: return "解码帧率";
+    case PresentedFrames: return "显示帧率";
+    case DroppedFrames: return "丢帧/秒";
+    default: return QString();
+    }
+}
+
+QString VideoTelemetry::gaugeLabel(Gauge gauge)
+{
+    switch (gauge) {
+    case VideoPacketQueue: return "视频包队列";
+    case AudioPacketQueue: return "音频包队列";
+    case VideoFrameQueue: return "待处理帧";
+    case PresentQueue: return "待显示帧";
+    case AudioBufferMs: return "音频缓冲 (ms)";
+    case AvDriftMs: return "音画偏差 (ms)";
+    case PoolBytes: return "缓冲池占用 (字节)";
+    case PoolBuffersInUse: return "缓冲池使用中";
+    case PoolUsagePercent: return "缓冲池占限额 (%)";
+    default: return QString();
+    }
+}
+
+const char *VideoTelemetry::histogramKey(Histogram histogram)
+{
+    static const char *const keys[HistogramCount] = {
+        "decode", "scale", "brightness_contrast", "saturation_hue", "grayscale", "face_overlay", "present_latency", "av_drift"
+    };
+    return keys[histogram];
+}
+
+const char *VideoTelemetry::counterKey(Counter counter)
+{
+    static const char *const keys[CounterCount] = { "decoded_frames", "presented_frames", "dropped_frames" };
+    return keys[counter];
+}
+
+const char *VideoTelemetry::gaugeKey(Gauge gauge)
+{
+    static const char *const keys[GaugeCount] = {
+        "video_packet_queue", "audio_packet_queue", "video_frame_queue", "present_queue",
+        "audio_buffer_ms", "av_drift_ms", "pool_bytes", "pool_buffers_in_use", "pool_usage_percent"
+    };
+    return keys[gauge];
+}
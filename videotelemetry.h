@@ -0,0 +1,181 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+#ifndef VIDEOTELEMETRY_H
+#define VIDEOTELEMETRY_H
+
+// =============================================================================
+// File: videotelemetry.h
+//
+// Description:
+// 该文件定义了 VideoTelemetry 类，收集视频播放流水线的实时指标：
+// 队列深度、解码与颜色转换耗时、效果耗时、呈现延迟、音画偏差、丢帧和缓冲池占用。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QString>
+#include <atomic>
+#include <deque>
+
+class QTimer;
+
+/**
+ * @class VideoTelemetry
+ * @brief 视频流水线遥测：无锁记录，按秒汇总。
+ *
+ * [记录]
+ * record()、count()、setGauge() 可在任意线程调用，只做几次 relaxed 原子操作，不加锁、不分配内存：
+ * - 直方图（耗时、延迟）：按 2 的幂分桶（单位微秒），同时累计次数、总和与最大值；
+ * - 计数器（解码帧数、显示帧数、丢帧数）：只增不减；
+ * - 仪表（队列深度、缓冲池占用等）：只保留最新值，由主线程在汇总前采样写入。
+ *
+ * [汇总]
+ * start() 之后每秒在主线程中先发出 sampling() 让使用者写入仪表，
+ * 再以原子交换取走并清零直方图和计数器，生成一份 Snapshot，
+ * 通过 snapshotReady() 发出并保存在历史记录中（最近一小时），可导出为 CSV。
+ * 百分位取所在桶的上界，精度为2倍，足以判断瓶颈在哪一级。
+ */
+class VideoTelemetry : public QObject
+{
+    Q_OBJECT
+
+public:
+    // 直方图（单位：微秒）
+    enum Histogram {
+        DecodeTime,             // 一个视频数据包的解码耗时（送入数据包并取出其输出帧，含等待解码线程）
+        ScaleTime,              // 一帧 sws_scale 颜色转换（含缩放）的耗时
+        BrightnessContrastTime, // 亮度/对比度效果（各条带CPU耗时之和）
+        SaturationHueTime,      // 饱和度/色相效果
+        GrayscaleTime,          // 灰度效果
+        FaceOverlayTime,        // 主线程中绘制人脸框
+        PresentLatency,         // 刷新实际触发时刻晚于预定时刻的时长
+        AvDrift,                // 显示帧与音频播放位置之差的绝对值
+        HistogramCount
+    };
+    // 计数器（每秒的增量）
+    enum Counter {
+        DecodedFrames,   // 解码输出的帧数（即解码帧率）
+        PresentedFrames, // 显示的帧数
+        DroppedFrames,   // 丢弃的帧数
+        CounterCount
+    };
+    // 仪表（采样时的最新值）
+    enum Gauge {
+        VideoPacketQueue, // 视频数据包队列深度
+        AudioPacketQueue, // 音频数据包队列深度
+        VideoFrameQueue,  // 已解码、待处理效果的帧数
+        PresentQueue,     // 已处理效果、待显示的帧数
+        AudioBufferMs,    // PCM 环形缓冲区中的音频时长（毫秒）
+        AvDriftMs,        // 显示帧相对音频播放位置的偏差（毫秒，正值表示画面超前）
+        PoolBytes,        // 帧缓冲池已分配的字节数
+        PoolBuffersInUse, // 帧缓冲池中正在被使用的缓冲个数
+        PoolUsagePercent, // 帧缓冲池占字节限额的百分比
+        GaugeCount
+    };
+
+    /**
+     * @struct HistogramStats
+     * @brief 一个直方图在一秒内的统计结果（单位与记录时相同）。
+     */
+    struct HistogramStats {
+        qint64 count = 0;
+        qint64 mean = 0;
+        qint64 p50 = 0;
+        qint64 p95 = 0;
+        qint64 max = 0;
+    };
+
+    /**
+     * @struct Snapshot
+     * @brief 一秒的汇总结果。
+     */
+    struct Snapshot {
+        qint64 timeMs = 0; // 自 start() 起的时间
+        HistogramStats histograms[HistogramCount];
+        qint64 counters[CounterCount] = {};
+        qint64 gauges[GaugeCount] = {};
+    };
+
+    explicit VideoTelemetry(QObject *parent = nullptr);
+
+    // 开始按秒汇总（清空历史记录）
+    void start();
+    void stop();
+
+    // --- 记录（任意线程，无锁） ---
+    void record(Histogram histogram, qint64 value);
+    void count(Counter counter, qint64 n = 1);
+    void setGauge(Gauge gauge, qint64 value);
+
+    // --- 结果（主线程） ---
+    const std::deque<Snapshot> &history() const { return snapshots; }
+    /**
+     * @brief 把历史记录导出为 CSV，每秒一行。
+     * @param filePath 输出文件路径。
+     * @param error [out] 失败原因，可为nullptr。
+     * @return 成功返回true。
+     */
+    bool exportCsv(const QString &filePath, QString *error = nullptr) const;
+
+    // 指标的显示名称与 CSV 列名
+    static QString histogramLabel(Histogram histogram);
+    static QString counterLabel(Counter counter);
+    static QString gaugeLabel(Gauge gauge);
+    static const char *histogramKey(Histogram histogram);
+    static const char *counterKey(Counter counter);
+    static const char *gaugeKey(Gauge gauge);
+
+signals:
+    // 汇总前发出（主线程），使用者在此调用 setGauge() 写入采样值
+    void sampling();
+    // 每秒一份汇总结果
+    void snapshotReady(const VideoTelemetry::Snapshot &snapshot);
+
+private:
+    // 桶 i 覆盖 [2^i, 2^(i+1))，桶 0 同时包含 0
+    static const int bucketCount = 40;
+
+    struct AtomicHistogram {
+        std::atomic<qint64> buckets[bucketCount] = {};
+        std::atomic<qint64> count{0};
+        std::atomic<qint64> sum{0};
+        std::atomic<qint64> max{0};
+    };
+
+    // [主线程] 汇总一秒的数据
+    void aggregate();
+    // 取走并清零一个直方图
+    static HistogramStats drain(AtomicHistogram &histogram);
+
+    AtomicHistogram histograms[HistogramCount];
+    std::atomic<qint64> counters[CounterCount] = {};
+    std::atomic<qint64> gauges[GaugeCount] = {};
+
+    QTimer *timer = nullptr;
+    QElapsedTimer elapsed;
+    std::deque<Snapshot> snapshots; // 历史记录，最近 maxSnapshots 秒
+};
+
+Q_DECLARE_METATYPE(VideoTelemetry::Snapshot)
+
+#endif // VIDEOTELEMETRY_H
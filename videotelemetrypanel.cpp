@@ -0,0 +1,130 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+// =============================================================================
+// File: videotelemetrypanel.cpp
+//
+// Description:
+// VideoTelemetryPanel 类的实现文件。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include "videotelemetrypanel.h"
+#include <QFileDialog>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QTableWidget>
+#include <QVBoxLayout>
+
+// 表格各部分的起始行：计数器、仪表、直方图依次排列
+static const int counterRow = 0;
+static const int gaugeRow = counterRow + VideoTelemetry::CounterCount;
+static const int histogramRow = gaugeRow + VideoTelemetry::GaugeCount;
+static const int rowCount = histogramRow + VideoTelemetry::HistogramCount;
+
+/**
+ * @brief VideoTelemetryPanel 构造函数，创建表格和导出按钮。
+ */
+VideoTelemetryPanel::VideoTelemetryPanel(VideoTelemetry *telemetry, QWidget *parent)
+    : QWidget(parent), telemetry(telemetry)
+{
+    table = new QTableWidget(rowCount, 6, this);
+    table->setHorizontalHeaderLabels({"指标", "值/平均", "P50", "P95", "最大", "次数"});
+    table->verticalHeader()->setVisible(false);
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->setSelectionMode(QAbstractItemView::NoSelection);
+    table->horizontalHeader()->setSectionResizeMode(0, QHeaderView::ResizeToContents);
+    for (int i = 0; i < VideoTelemetry::CounterCount; ++i)
+        setCell(counterRow + i, 0, VideoTelemetry::counterLabel(static_cast<VideoTelemetry::Counter>(i)));
+    for (int i = 0; i < VideoTelemetry::GaugeCount; ++i)
+        setCell(gaugeRow + i, 0, VideoTelemetry::gaugeLabel(static_cast<VideoTelemetry::Gauge>(i)));
+    for (int i = 0; i < VideoTelemetry::HistogramCount; ++i)
+        setCell(histogramRow + i, 0, VideoTelemetry::histogramLabel(static_cast<VideoTelemetry::Histogram>(i)) + " (µs)");
+
+    statusLabel = new QLabel("等待播放...", this);
+    auto *exportButton = new QPushButton("导出 CSV...", this);
+    connect(exportButton, &QPushButton::clicked, this, &VideoTelemetryPanel::exportCsv);
+
+    auto *bottomLayout = new QHBoxLayout;
+    bottomLayout->addWidget(statusLabel, 1);
+    bottomLayout->addWidget(exportButton);
+    auto *layout = new QVBoxLayout(this);
+    layout->addWidget(table);
+    layout->addLayout(bottomLayout);
+
+    connect(telemetry, &VideoTelemetry::snapshotReady, this, &VideoTelemetryPanel::showSnapshot);
+}
+
+/**
+ * @brief 用新的汇总结果刷新表格。
+ */
+void VideoTelemetryPanel::showSnapshot(const VideoTelemetry::Snapshot &snapshot)
+{
+    if (!isVisible()) return;
+    for (int i = 0; i < VideoTelemetry::CounterCount; ++i)
+        setCell(counterRow + i, 1, QString::number(snapshot.counters[i]));
+    for (int i = 0; i < VideoTelemetry::GaugeCount; ++i)
+        setCell(gaugeRow + i, 1, QString::number(snapshot.gauges[i]));
+    for (int i = 0; i < VideoTelemetry::HistogramCount; ++i) {
+        const VideoTelemetry::HistogramStats &stats = snapshot.histograms[i];
+        const int row = histogramRow + i;
+        setCell(row, 1, QString::number(stats.mean));
+        setCell(row, 2, QString::number(stats.p50));
+        setCell(row, 3, QString::number(stats.p95));
+        setCell(row, 4, QString::number(stats.max));
+        setCell(row, 5, QString::number(stats.count));
+    }
+    statusLabel->setText(QString("第 %1 秒，已记录 %2 秒").arg(snapshot.timeMs / 1000).arg(telemetry->history().size()));
+}
+
+/**
+ * @brief 把历史记录导出为 CSV。
+ */
+void VideoTelemetryPanel::exportCsv()
+{
+    if (telemetry->history().empty()) {
+        QMessageBox::warning(this, "无内容", "还没有遥测数据。");
+        return;
+    }
+    const QString fileName = QFileDialog::getSaveFileName(this, "导出遥测数据", "telemetry.csv", "CSV (*.csv)");
+    if (fileName.isEmpty()) return;
+    QString error;
+    if (!telemetry->exportCsv(fileName, &error)) {
+        QMessageBox::critical(this, "错误", "无法导出遥测数据。\n" + error);
+    }
+}
+
+/**
+ * @brief 设置表格中一个单元格的文本，单元格不存在时创建。
+ */
+void VideoTelemetryPanel::setCell(int row, int column, const QString &text)
+{
+    QTableWidgetItem *item = table->item(row, column);
+    if (!item) {
+        item = new QTableWidgetItem;
+        if (column > 0) item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+        table->setItem(row, column, item);
+    }
+    item->setText(text);
+}
@@ -0,0 +1,70 @@
+// =============================================================================
+//
+// Copyright (C) 2025 g64-cmd
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// =============================================================================
+
+#ifndef VIDEOTELEMETRYPANEL_H
+#define VIDEOTELEMETRYPANEL_H
+
+// =============================================================================
+// File: videotelemetrypanel.h
+//
+// Description:
+// 该文件定义了 VideoTelemetryPanel 类，以表格形式显示视频流水线每秒的遥测数据，
+// 并可把历史记录导出为 CSV。
+//
+// Author: g64
+// Date: 2025-07-25
+// =============================================================================
+
+#include <QWidget>
+#include "videotelemetry.h"
+
+class QTableWidget;
+class QLabel;
+
+/**
+ * @class VideoTelemetryPanel
+ * @brief 视频遥测面板（放在视频页的停靠窗口中）。
+ *
+ * 每收到一份 VideoTelemetry::Snapshot 就刷新表格：计数器和仪表只显示数值，
+ * 直方图显示次数、平均、P50、P95 和最大值（微秒）。面板只读取汇总结果，
+ * 不参与记录，隐藏时也不会增加播放流水线的开销。
+ */
+class VideoTelemetryPanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit VideoTelemetryPanel(VideoTelemetry *telemetry, QWidget *parent = nullptr);
+
+private slots:
+    // 用新的汇总结果刷新表格
+    void showSnapshot(const VideoTelemetry::Snapshot &snapshot);
+    // 把历史记录导出为 CSV
+    void exportCsv();
+
+private:
+    // 设置表格中一个单元格的文本
+    void setCell(int row, int column, const QString &text);
+
+    VideoTelemetry *telemetry;
+    QTableWidget *table;
+    QLabel *statusLabel;
+};
+
+#endif // VIDEOTELEMETRYPANEL_H